@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "pcoconcurrencyanalyzer.h"
+#include "staticconcurrencyanalyzer.h"
+
+// Compares the cost of a section handoff between PcoConcurrencyAnalyzer and
+// StaticConcurrencyAnalyzer. Each thread plays a chain of sections, and the
+// scenario interleaves them round-robin, so that every section is a handoff
+// to another thread.
+//
+// The threads wait for each other before their first section, so that the
+// handoffs are timed from the moment all of them run. The start and the join
+// of the threads are reported apart.
+//
+// Usage: analyzer_bench [nbSections] [nbRuns]
+
+///
+/// \brief Thread playing a chain of sections
+///
+class ChainThread : public ObservableThread
+{
+public:
+    ChainThread(std::string id, int nbSections, std::atomic<size_t> &nbReady, size_t nbThreads) :
+        ObservableThread(std::move(id)), nbSections(nbSections), nbReady(nbReady), nbThreads(nbThreads)
+    {}
+
+    /// Time at which all the threads were running
+    std::chrono::steady_clock::time_point begin;
+
+    /// Time at which the thread ended its scenario
+    std::chrono::steady_clock::time_point end;
+
+private:
+    void run() override
+    {
+        nbReady++;
+        while (nbReady.load() < nbThreads) {
+            std::this_thread::yield();
+        }
+        begin = std::chrono::steady_clock::now();
+        for (int section = 0; section < nbSections; section++) {
+            startSection(section);
+        }
+        endScenario();
+        end = std::chrono::steady_clock::now();
+    }
+
+    int nbSections;
+    std::atomic<size_t> &nbReady;
+    size_t nbThreads;
+};
+
+///
+/// \brief Creates the round-robin scenario of some threads
+/// \param threads The threads
+/// \param nbSections The number of sections of each thread
+/// \return The scenario, of threads.size() * nbSections points
+///
+template<size_t NbThreads>
+static Scenario roundRobin(const std::array<ObservableThread *, NbThreads> &threads, int nbSections)
+{
+    Scenario scenario;
+    for (int section = 0; section < nbSections; section++) {
+        for (auto thread : threads) {
+            scenario.push_back({thread, section});
+        }
+    }
+    return scenario;
+}
+
+///
+/// \brief Plays a scenario once
+/// \param threads The threads, already bound to an analyzer
+/// \param nbReady The counter of the running threads
+/// \param handoffTime Incremented by the time spent in the handoffs
+/// \param overheadTime Incremented by the time spent starting and joining the threads
+///
+template<size_t NbThreads>
+static void play(const std::array<ChainThread *, NbThreads> &threads, std::atomic<size_t> &nbReady,
+                 std::chrono::duration<double, std::nano> &handoffTime,
+                 std::chrono::duration<double, std::nano> &overheadTime)
+{
+    nbReady = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto thread : threads) {
+        thread->start();
+    }
+    for (auto thread : threads) {
+        thread->join();
+    }
+    auto total = std::chrono::steady_clock::now() - start;
+    auto begin = threads[0]->begin;
+    auto end = threads[0]->end;
+    for (auto thread : threads) {
+        begin = std::min(begin, thread->begin);
+        end = std::max(end, thread->end);
+    }
+    handoffTime += end - begin;
+    overheadTime += total - (end - begin);
+}
+
+///
+/// \brief Measures the handoff cost of both analyzers for a number of threads
+/// \param nbSections The number of sections of each thread
+/// \param nbRuns The number of times the scenario is played
+///
+template<size_t NbThreads>
+static void compare(int nbSections, int nbRuns)
+{
+    std::atomic<size_t> nbReady{0};
+    std::vector<std::unique_ptr<ChainThread> > owned;
+    std::array<ChainThread *, NbThreads> chains{};
+    std::array<ObservableThread *, NbThreads> threads{};
+    for (size_t t = 0; t < NbThreads; t++) {
+        owned.emplace_back(std::make_unique<ChainThread>(std::to_string(t), nbSections, nbReady, NbThreads));
+        chains[t] = owned.back().get();
+        threads[t] = chains[t];
+    }
+    Scenario scenario = roundRobin(threads, nbSections);
+    double nbHandoffs = static_cast<double>(scenario.size()) * nbRuns;
+
+    std::chrono::duration<double, std::nano> dynamicTime{0};
+    std::chrono::duration<double, std::nano> dynamicOverhead{0};
+    for (int run = 0; run < nbRuns; run++) {
+        PcoConcurrencyAnalyzer analyzer;
+        analyzer.setScenario(scenario, NbThreads);
+        for (auto thread : threads) {
+            thread->setConcurrencyAnalyzer(&analyzer);
+        }
+        play(chains, nbReady, dynamicTime, dynamicOverhead);
+    }
+
+    std::chrono::duration<double, std::nano> staticTime{0};
+    std::chrono::duration<double, std::nano> staticOverhead{0};
+    for (int run = 0; run < nbRuns; run++) {
+        StaticConcurrencyAnalyzer<NbThreads, NoInvariants, NoTracing> analyzer;
+        analyzer.setScenario(scenario, threads);
+        for (auto thread : threads) {
+            thread->bindAnalyzer(&analyzer);
+        }
+        play(chains, nbReady, staticTime, staticOverhead);
+    }
+
+    std::cout << NbThreads << " threads : PcoConcurrencyAnalyzer " << dynamicTime.count() / nbHandoffs
+              << " ns/handoff, StaticConcurrencyAnalyzer " << staticTime.count() / nbHandoffs << " ns/handoff"
+              << std::endl;
+    std::cout << NbThreads << " threads : start and join, PcoConcurrencyAnalyzer " << dynamicOverhead.count() / nbRuns
+              << " ns/run, StaticConcurrencyAnalyzer " << staticOverhead.count() / nbRuns << " ns/run" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int nbSections = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    int nbRuns = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+    compare<2>(nbSections, nbRuns);
+    compare<4>(nbSections, nbRuns);
+    compare<8>(nbSections, nbRuns);
+
+    return 0;
+}
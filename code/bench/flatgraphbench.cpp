@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+
+#include "flatscenariograph.h"
+
+// Compares the pointer-based ScenarioGraph with its FlatScenarioGraph form,
+// in memory and in traversal speed, on large generated graphs.
+//
+// Usage: flatgraph_bench [nbLayers] [width] [branching] [depth]
+
+///
+/// \brief Creates a layered graph
+/// \param graph The graph to fill
+/// \param nbLayers The number of layers
+/// \param width The number of nodes per layer
+/// \param branching The number of children of each node, in the next layer
+/// \param generator The random generator choosing the children
+/// \return All the nodes, in creation order
+///
+/// The initial node has all the nodes of the first layer as children.
+///
+static std::vector<ScenarioGraphNode *> createLayeredGraph(ScenarioGraph &graph, int nbLayers, int width, int branching,
+                                                           std::mt19937 &generator)
+{
+    std::vector<ScenarioGraphNode *> all;
+    int number = 0;
+    auto root = graph.createNode(nullptr, -1);
+    graph.setInitialNode(root);
+    all.push_back(root);
+    std::vector<ScenarioGraphNode *> previous{root};
+    std::uniform_int_distribution<int> pick(0, width - 1);
+    for (int layer = 0; layer < nbLayers; layer++) {
+        std::vector<ScenarioGraphNode *> nodes;
+        for (int i = 0; i < width; i++) {
+            nodes.push_back(graph.createNode(nullptr, number++));
+            all.push_back(nodes.back());
+        }
+        for (size_t i = 0; i < previous.size(); i++) {
+            // The first child makes every node reachable, the others are random
+            previous[i]->next.push_back(nodes[i % width]);
+            for (int b = 1; b < branching; b++) {
+                previous[i]->next.push_back(nodes[pick(generator)]);
+            }
+        }
+        if (layer == 0) {
+            for (int i = 1; i < width; i++) {
+                root->next.push_back(nodes[i]);
+            }
+        }
+        previous = nodes;
+    }
+    return all;
+}
+
+///
+/// \brief Estimates the memory used by the pointer form of a graph
+/// \param root The initial node
+/// \return An estimation in bytes, counting the allocator and std::set overheads
+///
+static size_t pointerMemoryUsage(ScenarioGraphNode *root)
+{
+    // Each node costs three allocations: the node, its next buffer and the
+    // std::set node holding its unique_ptr
+    const size_t allocationOverhead = 16;
+    const size_t setNodeSize = 32 + sizeof(std::unique_ptr<ScenarioGraphNode>);
+    std::set<ScenarioGraphNode *> visited;
+    std::vector<ScenarioGraphNode *> stack{root};
+    size_t result = 0;
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (!visited.insert(node).second) {
+            continue;
+        }
+        result += sizeof(ScenarioGraphNode) + node->next.capacity() * sizeof(ScenarioGraphNode *) +
+                  setNodeSize + 3 * allocationOverhead;
+        for (auto child : node->next) {
+            stack.push_back(child);
+        }
+    }
+    return result;
+}
+
+/// Counts the paths up to a depth in the pointer form
+static size_t countPaths(const ScenarioGraphNode *node, int depth)
+{
+    if ((depth == 0) || node->next.empty()) {
+        return 1;
+    }
+    size_t result = 0;
+    for (auto child : node->next) {
+        result += countPaths(child, depth - 1);
+    }
+    return result;
+}
+
+/// Counts the paths up to a depth in the flat form
+static size_t countPaths(const FlatScenarioGraph &graph, FlatScenarioGraph::NodeIndex node, int depth)
+{
+    if ((depth == 0) || graph.isLeaf(node)) {
+        return 1;
+    }
+    size_t result = 0;
+    for (auto child = graph.childrenBegin(node); child != graph.childrenEnd(node); child++) {
+        result += countPaths(graph, *child, depth - 1);
+    }
+    return result;
+}
+
+///
+/// \brief Measures the duration of a function
+/// \param function The function to run
+/// \return The duration in milliseconds
+///
+template<typename Function>
+static double measure(Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+    return duration.count();
+}
+
+int main(int argc, char *argv[])
+{
+    int nbLayers = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    int width = (argc > 2) ? std::atoi(argv[2]) : 50;
+    int branching = (argc > 3) ? std::atoi(argv[3]) : 3;
+    int depth = (argc > 4) ? std::atoi(argv[4]) : 12;
+
+    std::mt19937 generator(42);
+    ScenarioGraph graph;
+    auto nodes = createLayeredGraph(graph, nbLayers, width, branching, generator);
+    FlatScenarioGraph flat({graph.getFirstNode()});
+
+    std::cout << "Nodes          : " << flat.nbNodes() << std::endl;
+    std::cout << "Pointer memory : " << pointerMemoryUsage(graph.getFirstNode()) << " bytes (estimated)" << std::endl;
+    std::cout << "Flat memory    : " << flat.memoryUsage() << " bytes" << std::endl;
+
+    // Full sweep over the nodes, reading the section number of their children
+    size_t pointerSum = 0;
+    size_t flatSum = 0;
+    double pointerSweep = measure([&] {
+        for (auto node : nodes) {
+            for (auto child : node->next) {
+                pointerSum += child->number;
+            }
+        }
+    });
+    double flatSweep = measure([&] {
+        for (FlatScenarioGraph::NodeIndex node = 0; node < flat.nbNodes(); node++) {
+            for (auto child = flat.childrenBegin(node); child != flat.childrenEnd(node); child++) {
+                flatSum += flat.getNumber(*child);
+            }
+        }
+    });
+    std::cout << "Sweep          : pointer " << pointerSweep << " ms, flat " << flatSweep << " ms"
+              << (pointerSum == flatSum ? "" : " (MISMATCH)") << std::endl;
+
+    // Depth-first path enumeration, as the builders do
+    size_t pointerPaths = 0;
+    size_t flatPaths = 0;
+    double pointerDfs = measure([&] { pointerPaths = countPaths(graph.getFirstNode(), depth); });
+    double flatDfs = measure([&] { flatPaths = countPaths(flat, flat.getRoot(0), depth); });
+    std::cout << "Paths (" << depth << ")     : pointer " << pointerDfs << " ms, flat " << flatDfs << " ms, "
+              << flatPaths << " paths" << (pointerPaths == flatPaths ? "" : " (MISMATCH)") << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "pcoconcurrencyanalyzer.h"
+#include "scenariobuilder.h"
+#include "scenariofile.h"
+#include "staticscenario.h"
+
+// Repeatable microbenchmarks of the hot paths of the model checker: the
+// generation rate of the scenario builders, the throughput of BufferN,
+// ScenarioGraph::nbScenarios() and the handoff latency of the
+// PcoConcurrencyAnalyzer between two threads.
+//
+// Each benchmark is run a number of times after a warmup run, and each run
+// gives one sample, normalized per item (scenario, element, call or handoff).
+// The mean and the percentiles of the samples are printed, and optionally
+// written as JSON, to be compared between two versions.
+//
+// Usage: modelchecking_bench [--repetitions N] [--filter text] [--json file]
+
+/// The section chain of every thread of the builder benchmarks
+using BenchSections = SectionChain<0, 1, 2, 3>;
+
+/// Number of threads of the builder benchmarks
+constexpr int nbBuilderThreads = 3;
+
+/// Depth of the builder benchmarks, that is all the sections of all the threads
+constexpr int builderDepth = nbBuilderThreads * static_cast<int>(BenchSections::size);
+
+///
+/// \brief Statistics of the samples of a benchmark
+///
+typedef struct {
+    /// Name of the benchmark
+    std::string name;
+    /// Unit of the samples
+    std::string unit;
+    /// Number of items of each run
+    size_t nbItems;
+    /// Number of samples
+    size_t nbSamples;
+    /// Mean of the samples
+    double mean;
+    /// Smallest sample
+    double min;
+    /// Median
+    double p50;
+    /// 90th percentile
+    double p90;
+    /// 99th percentile
+    double p99;
+    /// Largest sample
+    double max;
+} BenchResult;
+
+///
+/// \brief Thread playing a chain of sections
+///
+class ChainThread : public ObservableThread
+{
+public:
+    ChainThread(std::string id, int nbSections) :
+        ObservableThread(std::move(id)), nbSections(nbSections)
+    {
+        scenarioGraph = BenchSections::createGraph(this);
+    }
+
+private:
+    void run() override
+    {
+        for (int section = 0; section < nbSections; section++) {
+            startSection(section);
+        }
+        endScenario();
+    }
+
+    int nbSections;
+};
+
+///
+/// \brief Redirects std::cout to nowhere while alive
+///
+/// Some builders print a character per scenario, which would be measured too.
+///
+class SilentCout
+{
+public:
+    SilentCout() : previous(std::cout.rdbuf(nullptr)) {}
+    ~SilentCout() { std::cout.rdbuf(previous); }
+    SilentCout(const SilentCout &) = delete;
+    SilentCout &operator=(const SilentCout &) = delete;
+
+private:
+    std::streambuf *previous;
+};
+
+///
+/// \brief Gets a percentile of sorted samples, by linear interpolation
+/// \param sorted The samples, sorted
+/// \param p The percentile, between 0 and 100
+/// \return The percentile
+///
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.size() == 1) {
+        return sorted[0];
+    }
+    double rank = p / 100.0 * static_cast<double>(sorted.size() - 1);
+    auto low = static_cast<size_t>(rank);
+    size_t high = std::min(low + 1, sorted.size() - 1);
+    return sorted[low] + (sorted[high] - sorted[low]) * (rank - static_cast<double>(low));
+}
+
+///
+/// \brief The benchmark harness
+///
+class BenchRunner
+{
+public:
+
+    ///
+    /// \brief BenchRunner
+    /// \param nbRepetitions The number of samples of each benchmark
+    /// \param filter Only the benchmarks whose name contains it are run
+    ///
+    BenchRunner(int nbRepetitions, std::string filter) :
+        nbRepetitions(nbRepetitions), filter(std::move(filter)) {}
+
+    ///
+    /// \brief Runs a benchmark
+    /// \param name The name of the benchmark
+    /// \param unit The unit of the samples
+    /// \param nbItems The number of items of a run
+    /// \param body The function running once, returning its duration in nanoseconds, negative on failure
+    ///
+    /// A benchmark whose run fails is reported as failed, and not recorded.
+    ///
+    void run(const std::string &name, const std::string &unit, size_t nbItems, const std::function<double()> &body)
+    {
+        run(name, unit, [&body, nbItems] { return std::make_pair(body(), nbItems); });
+    }
+
+    ///
+    /// \brief Runs a benchmark whose number of items is only known once run
+    /// \param name The name of the benchmark
+    /// \param unit The unit of the samples
+    /// \param body The function running once, returning its duration in nanoseconds, negative on failure,
+    ///             and the number of items it processed
+    ///
+    /// Each sample is the duration of a run divided by its own number of items.
+    ///
+    void run(const std::string &name, const std::string &unit, const std::function<std::pair<double, size_t>()> &body)
+    {
+        if (name.find(filter) == std::string::npos) {
+            return;
+        }
+        // Warmup
+        bool failed = body().first < 0;
+        std::vector<double> samples;
+        size_t nbItems = 0;
+        for (int i = 0; (i < nbRepetitions) && !failed; i++) {
+            auto sample = body();
+            failed = (sample.first < 0) || (sample.second == 0);
+            nbItems = sample.second;
+            samples.push_back(sample.first / static_cast<double>(nbItems));
+        }
+        if (failed) {
+            std::printf("%-36s FAILED\n", name.c_str());
+            std::fflush(stdout);
+            nbFailures++;
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        BenchResult result{name, unit, nbItems, samples.size(), sum / static_cast<double>(samples.size()),
+                           samples.front(), percentile(samples, 50), percentile(samples, 90),
+                           percentile(samples, 99), samples.back()};
+        std::printf("%-36s %10.1f %10.1f %10.1f %10.1f %10.1f  %s\n", name.c_str(), result.mean, result.min,
+                    result.p50, result.p90, result.p99, unit.c_str());
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+
+    /// Gets the number of benchmarks that failed
+    [[nodiscard]] size_t getNbFailures() const { return nbFailures; }
+
+    ///
+    /// \brief Writes the results as JSON
+    /// \param fileName The name of the file
+    /// \return true if the file could be written, false else
+    ///
+    bool writeJson(const std::string &fileName) const
+    {
+        std::ofstream file(fileName);
+        file << "{\n  \"repetitions\": " << nbRepetitions << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &r = results[i];
+            file << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.nbItems
+                 << ", \"samples\": " << r.nbSamples << ", \"mean\": " << r.mean << ", \"min\": " << r.min
+                 << ", \"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+                 << ", \"max\": " << r.max << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+
+    /// Number of samples of each benchmark
+    int nbRepetitions;
+
+    /// Only the benchmarks whose name contains it are run
+    std::string filter;
+
+    /// The results, in order
+    std::vector<BenchResult> results;
+
+    /// Number of benchmarks that failed
+    size_t nbFailures{0};
+};
+
+///
+/// \brief Measures the time to get all the scenarios of a builder
+/// \param create Function creating the uninitialized builder
+/// \param threads The threads
+/// \return The duration, in nanoseconds, including init(), -1 if the builder gave no scenario,
+///         and the number of scenarios given
+///
+static std::pair<double, size_t> generateAll(const std::function<std::unique_ptr<ScenarioBuilderInterface>()> &create,
+                                             const std::vector<std::unique_ptr<ObservableThread> > &threads)
+{
+    SilentCout silent;
+    auto start = std::chrono::steady_clock::now();
+    auto builder = create();
+    builder->init(threads, builderDepth);
+    size_t nb = 0;
+    for (Scenario scenario = builder->getNext(); !scenario.empty(); scenario = builder->getNext()) {
+        nb++;
+    }
+    std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+    return {(nb > 0) ? duration.count() : -1.0, nb};
+}
+
+///
+/// \brief Benchmarks the generation rate of the scenario builders
+/// \param runner The harness
+///
+/// FlowScenarioBuilderIter is experimental and traces its progress, so it is not measured.
+///
+static void benchBuilders(BenchRunner &runner)
+{
+    std::vector<std::unique_ptr<ObservableThread> > threads;
+    for (int t = 0; t < nbBuilderThreads; t++) {
+        threads.emplace_back(std::make_unique<ChainThread>(std::to_string(t), BenchSections::size));
+    }
+    std::vector<Scenario> all;
+    {
+        UnoptimizedScenarioBuilderIter builder;
+        builder.init(threads, builderDepth);
+        for (Scenario scenario = builder.getNext(); !scenario.empty(); scenario = builder.getNext()) {
+            all.push_back(scenario);
+        }
+    }
+    std::string fileName = "modelchecking_bench.scn";
+    {
+        std::vector<ObservableThread *> pointers;
+        for (const auto &thread : threads) {
+            pointers.push_back(thread.get());
+        }
+        ScenarioFileWriter writer;
+        writer.open(fileName, pointers);
+        for (const auto &scenario : all) {
+            writer.write(scenario);
+        }
+        writer.finish();
+    }
+
+    std::vector<std::pair<std::string, std::function<std::unique_ptr<ScenarioBuilderInterface>()> > > builders = {
+        {"builder/Unoptimized", [] { return std::make_unique<UnoptimizedScenarioBuilderIter>(); }},
+        {"builder/Buffer", [] { return std::make_unique<ScenarioBuilderBuffer>(); }},
+        {"builder/PreemptionBounded", [] { return std::make_unique<PreemptionBoundedScenarioBuilderIter>(builderDepth); }},
+        {"builder/StaticChain", [] {
+            return std::make_unique<StaticChainScenarioBuilder<BenchSections, BenchSections, BenchSections>>();
+        }},
+        {"builder/Predefined", [&all] {
+            auto builder = std::make_unique<PredefinedScenarioBuilderIter>();
+            builder->setScenarios(all);
+            return builder;
+        }},
+        {"builder/File", [&fileName] {
+            auto builder = std::make_unique<FileScenarioBuilderIter>();
+            builder->open(fileName);
+            return builder;
+        }},
+        {"builder/Random", [&all] { return std::make_unique<RandomScenarioBuilderIter>(all.size()); }},
+    };
+    for (const auto &builder : builders) {
+        runner.run(builder.first, "ns/scenario", [&] { return generateAll(builder.second, threads); });
+    }
+    std::remove(fileName.c_str());
+}
+
+///
+/// \brief Benchmarks the throughput of BufferN between a producer and a consumer
+/// \param runner The harness
+///
+static void benchBuffer(BenchRunner &runner)
+{
+    constexpr size_t nbElements = 100000;
+    for (unsigned int size : {1U, 10U, 100U}) {
+        runner.run("buffer/size" + std::to_string(size), "ns/element", nbElements, [size] {
+            BufferN<int> buffer(size);
+            auto start = std::chrono::steady_clock::now();
+            std::thread producer([&buffer] {
+                for (size_t i = 0; i < nbElements; i++) {
+                    buffer.put(static_cast<int>(i) + 1);
+                }
+                buffer.finish();
+            });
+            while (buffer.get() != 0) {
+            }
+            producer.join();
+            std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+            return duration.count();
+        });
+    }
+}
+
+///
+/// \brief Benchmarks ScenarioGraph::nbScenarios() on a layered graph
+/// \param runner The harness
+///
+/// Every node of a layer has two children in the next layer, so the number of
+/// paths grows exponentially with the depth while the graph stays small.
+///
+static void benchNbScenarios(BenchRunner &runner)
+{
+    constexpr int width = 4;
+    for (int nbLayers : {16, 32}) {
+        ScenarioGraph graph;
+        auto root = graph.createNode(nullptr, -1);
+        graph.setInitialNode(root);
+        std::vector<ScenarioGraphNode *> previous{root};
+        int number = 0;
+        for (int layer = 0; layer < nbLayers; layer++) {
+            std::vector<ScenarioGraphNode *> nodes;
+            for (int i = 0; i < width; i++) {
+                nodes.push_back(graph.createNode(nullptr, number++));
+            }
+            for (size_t i = 0; i < previous.size(); i++) {
+                previous[i]->next.push_back(nodes[i % width]);
+                previous[i]->next.push_back(nodes[(i + 1) % width]);
+            }
+            previous = nodes;
+        }
+        constexpr size_t nbCalls = 100;
+        runner.run("nbScenarios/layers" + std::to_string(nbLayers), "ns/call", nbCalls, [&graph, nbLayers] {
+            size_t total = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < nbCalls; i++) {
+                total += graph.nbScenarios(nbLayers);
+            }
+            std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+            // Keeps the calls from being optimized out
+            if (total == 1) {
+                std::cout << total << std::endl;
+            }
+            return duration.count();
+        });
+    }
+}
+
+///
+/// \brief Benchmarks the handoff latency of the PcoConcurrencyAnalyzer between two threads
+/// \param runner The harness
+///
+/// The scenario alternates the two threads, so that every section is a handoff.
+///
+static void benchHandoff(BenchRunner &runner)
+{
+    constexpr int nbSections = 1000;
+    ChainThread first("0", nbSections);
+    ChainThread second("1", nbSections);
+    Scenario scenario;
+    for (int section = 0; section < nbSections; section++) {
+        scenario.push_back({&first, section});
+        scenario.push_back({&second, section});
+    }
+    runner.run("analyzer/handoff2", "ns/handoff", scenario.size(), [&] {
+        PcoConcurrencyAnalyzer analyzer;
+        analyzer.setScenario(scenario, 2);
+        first.setConcurrencyAnalyzer(&analyzer);
+        second.setConcurrencyAnalyzer(&analyzer);
+        auto start = std::chrono::steady_clock::now();
+        first.start();
+        second.start();
+        first.join();
+        second.join();
+        std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start;
+        return duration.count();
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    int nbRepetitions = 20;
+    std::string filter;
+    std::string jsonFile;
+    for (int i = 1; i < argc; i++) {
+        if ((std::strcmp(argv[i], "--repetitions") == 0) && (i + 1 < argc)) {
+            nbRepetitions = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((std::strcmp(argv[i], "--filter") == 0) && (i + 1 < argc)) {
+            filter = argv[++i];
+        }
+        else if ((std::strcmp(argv[i], "--json") == 0) && (i + 1 < argc)) {
+            jsonFile = argv[++i];
+        }
+        else {
+            std::cout << "Usage: " << argv[0] << " [--repetitions N] [--filter text] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+
+    BenchRunner runner(nbRepetitions, filter);
+    std::printf("%-36s %10s %10s %10s %10s %10s\n", "benchmark", "mean", "min", "p50", "p90", "p99");
+    benchBuilders(runner);
+    benchBuffer(runner);
+    benchNbScenarios(runner);
+    benchHandoff(runner);
+
+    if (!jsonFile.empty() && !runner.writeJson(jsonFile)) {
+        std::cout << "Could not write " << jsonFile << std::endl;
+        return 1;
+    }
+    if (runner.getNbFailures() > 0) {
+        std::cout << runner.getNbFailures() << " benchmarks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <pcosynchro/pcosemaphore.h>
+
+#include "pcomodelchecker.h"
+#include "staticscenario.h"
+
+// End-to-end throughput of the model checker on parametric models: synthetic
+// models of N threads of K sections, and scaled-up variants of the
+// producer/consumer BufferModel of the tests. Each model is run through
+// PcoModelChecker::run() in a child process, so that its peak RSS is its own,
+// and the driver reports the scenarios per second, the time per handoff and
+// the peak RSS. Each model is run several times, and each metric is the best
+// of the runs, so that the noise of the machine, which only slows the runs
+// down, does not trigger a regression.
+//
+// The results can be stored as a baseline, and compared to a baseline: the
+// driver exits with 1 if a metric regresses beyond the threshold. The baseline
+// committed next to this file, throughput_baseline.txt, is used by default.
+//
+// Usage: throughput_bench [--synthetic N,K,branching,share]... [--buffer P,C]... [--runs N]
+//                         [--baseline file | --no-baseline] [--write-baseline file]
+//                         [--threshold ratio]
+//
+// Without --synthetic nor --buffer, a default set of models is run.
+
+///
+/// \brief Parameters of a synthetic model
+///
+typedef struct {
+    /// Number of threads
+    int nbThreads;
+    /// Number of sections of each thread
+    int nbSections;
+    /// Maximum number of children of a section, 1 for a chain
+    int branching;
+    /// Share of the sections protected by a semaphore, between 0 and 1
+    double protectedShare;
+} SyntheticParameters;
+
+///
+/// \brief Measures of a model run
+///
+typedef struct {
+    /// Number of scenarios run
+    double nbScenarios;
+    /// Number of handoffs, that is of scenario points played
+    double nbHandoffs;
+    /// Duration of the exploration, in seconds
+    double seconds;
+    /// Peak resident set size of the process, in kilobytes
+    double peakRssKb;
+} RunMeasures;
+
+///
+/// \brief Metrics compared to the baseline
+///
+typedef struct {
+    /// Scenarios per second, higher is better
+    double scenariosPerSecond;
+    /// Nanoseconds per handoff, lower is better
+    double nsPerHandoff;
+    /// Peak RSS in kilobytes, lower is better
+    double peakRssKb;
+} ThroughputMetrics;
+
+///
+/// \brief State shared by the threads of a synthetic model
+///
+class SyntheticState
+{
+public:
+    /// Value updated by every section, choosing the branches
+    int value{0};
+    /// Semaphore protecting the protected sections
+    PcoSemaphore mutex{1};
+};
+
+///
+/// \brief Thread of a synthetic model
+///
+/// Its sections are numbered from 1 to K. Section s can be followed by the
+/// sections s + 1 to s + branching, the branch taken depending on the shared
+/// value, so that the interleaving decides which sections are played.
+///
+class SyntheticThread : public ObservableThread
+{
+public:
+    SyntheticThread(std::string id, const SyntheticParameters &parameters, std::shared_ptr<SyntheticState> state) :
+        ObservableThread(std::move(id)), parameters(parameters), state(std::move(state))
+    {
+        scenarioGraph = std::make_unique<ScenarioGraph>();
+        std::vector<ScenarioGraphNode *> nodes{scenarioGraph->createNode(this, -1)};
+        scenarioGraph->setInitialNode(nodes[0]);
+        for (int s = 1; s <= parameters.nbSections; s++) {
+            nodes.push_back(scenarioGraph->createNode(this, s));
+        }
+        for (int s = 0; s < parameters.nbSections; s++) {
+            for (int next = s + 1; next <= std::min(s + parameters.branching, parameters.nbSections); next++) {
+                nodes[s]->next.push_back(nodes[next]);
+            }
+        }
+    }
+
+private:
+    /// Indicates whether a section is protected by the semaphore
+    [[nodiscard]] bool isProtected(int section) const
+    {
+        return std::floor(section * parameters.protectedShare) != std::floor((section - 1) * parameters.protectedShare);
+    }
+
+    void run() override
+    {
+        int section = 0;
+        while (section < parameters.nbSections) {
+            int nbChildren = std::min(parameters.branching, parameters.nbSections - section);
+            section += 1 + (state->value % nbChildren);
+            startSection(section);
+            if (isProtected(section)) {
+                state->mutex.acquire();
+                state->value += section;
+                state->mutex.release();
+            }
+            else {
+                state->value += section;
+            }
+        }
+        endScenario();
+    }
+
+    SyntheticParameters parameters;
+    std::shared_ptr<SyntheticState> state;
+};
+
+///
+/// \brief Synthetic model of N threads of K sections
+///
+class SyntheticModel : public PcoModel
+{
+public:
+    explicit SyntheticModel(const SyntheticParameters &parameters) : parameters(parameters) {}
+
+    void build() override
+    {
+        state = std::make_shared<SyntheticState>();
+        for (int t = 0; t < parameters.nbThreads; t++) {
+            threads.emplace_back(std::make_unique<SyntheticThread>(std::to_string(t), parameters, state));
+        }
+        scenarioBuilder = createScenarioBuilder();
+        scenarioBuilder->init(threads, parameters.nbThreads * parameters.nbSections);
+    }
+
+    void preRun(Scenario &/*scenario*/) override
+    {
+        state->value = 0;
+    }
+
+private:
+    SyntheticParameters parameters;
+    std::shared_ptr<SyntheticState> state;
+};
+
+///
+/// \brief Buffer of a scaled BufferModel, one put() per producer and one get() per consumer
+///
+class ScaledBuffer
+{
+public:
+    explicit ScaledBuffer(int capacity) : waitEmpty(capacity) {}
+
+    void put(int item)
+    {
+        waitEmpty.acquire();
+        mutex.acquire();
+        element = item;
+        mutex.release();
+        waitFull.release();
+    }
+
+    int get()
+    {
+        waitFull.acquire();
+        mutex.acquire();
+        int item = element;
+        mutex.release();
+        waitEmpty.release();
+        return item;
+    }
+
+private:
+    PcoSemaphore mutex{1};
+    PcoSemaphore waitFull{0};
+    PcoSemaphore waitEmpty;
+    int element{0};
+};
+
+///
+/// \brief Producer or consumer of a scaled BufferModel, with the sections 1, 2 and 3
+///
+/// As in the BufferModel, section 2 accesses the buffer and the two others are local.
+///
+class ScaledBufferThread : public ObservableThread
+{
+public:
+    using Sections = SectionChain<1, 2, 3>;
+
+    ScaledBufferThread(std::string id, bool producer, std::shared_ptr<ScaledBuffer> buffer) :
+        ObservableThread(std::move(id)), producer(producer), buffer(std::move(buffer))
+    {
+        scenarioGraph = Sections::createGraph(this);
+    }
+
+    [[nodiscard]] bool isProducer() const { return producer; }
+
+private:
+    void run() override
+    {
+        startSection(1);
+        startSection(2);
+        if (producer) {
+            buffer->put(23);
+        }
+        else {
+            (void) buffer->get();
+        }
+        startSection(3);
+        endScenario();
+    }
+
+    bool producer;
+    std::shared_ptr<ScaledBuffer> buffer;
+};
+
+///
+/// \brief BufferModel with P producers and C consumers
+///
+class ScaledBufferModel : public PcoModel
+{
+public:
+    ScaledBufferModel(int nbProducers, int nbConsumers) : nbProducers(nbProducers), nbConsumers(nbConsumers) {}
+
+    void build() override
+    {
+        auto buffer = std::make_shared<ScaledBuffer>(1);
+        for (int p = 0; p < nbProducers; p++) {
+            threads.emplace_back(std::make_unique<ScaledBufferThread>("P" + std::to_string(p), true, buffer));
+        }
+        for (int c = 0; c < nbConsumers; c++) {
+            threads.emplace_back(std::make_unique<ScaledBufferThread>("C" + std::to_string(c), false, buffer));
+        }
+
+        filter = std::make_shared<SemaphoreFilter>();
+        int waitFull = filter->addCounter("waitFull", 0);
+        int waitEmpty = filter->addCounter("waitEmpty", 1);
+        for (const auto &thread : threads) {
+            auto graph = thread->getScenarioGraph();
+            auto access = graph->findNode(2);
+            if (static_cast<ScaledBufferThread *>(thread.get())->isProducer()) {
+                access->acquire(waitEmpty);
+                access->release(waitFull);
+            }
+            else {
+                access->acquire(waitFull);
+                access->release(waitEmpty);
+            }
+            graph->findNode(1)->local = true;
+            graph->findNode(3)->local = true;
+        }
+
+        int depth = 3 * (nbProducers + nbConsumers);
+        coarsenScenarioGraphs(depth);
+        scenarioBuilder = createScenarioBuilder();
+        scenarioBuilder->init(threads, depth);
+    }
+
+    std::unique_ptr<ScenarioBuilderInterface> createScenarioBuilder() override
+    {
+        auto builder = std::make_unique<ScenarioBuilderBuffer>();
+        builder->setSemaphoreFilter(filter);
+        return builder;
+    }
+
+private:
+    int nbProducers;
+    int nbConsumers;
+    std::shared_ptr<SemaphoreFilter> filter;
+};
+
+///
+/// \brief Runs a model in a child process
+/// \param create Function creating the model, called in the child
+/// \param measures The measures, filled if the run succeeded
+/// \return true if the child ran the model, false else
+///
+static bool runInChild(const std::function<std::unique_ptr<PcoModel>()> &create, RunMeasures &measures)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        // The models and the builders trace every scenario
+        std::cout.rdbuf(nullptr);
+        auto model = create();
+        PcoModelChecker checker;
+        checker.setModel(model.get());
+        checker.run();
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        RunMeasures result{static_cast<double>(checker.getNbScenariosRun()),
+                           static_cast<double>(checker.getNbPointsPlayed()), checker.getRunDuration(),
+                           static_cast<double>(usage.ru_maxrss)};
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t nbRead = read(fds[0], &measures, sizeof(measures));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return (nbRead == sizeof(measures)) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+///
+/// \brief Reads a baseline file
+/// \param fileName The name of the file
+/// \return The metrics of each model, by name
+///
+/// Each line holds a model name, its scenarios per second, its nanoseconds per
+/// handoff and its peak RSS in kilobytes. Lines starting with # are ignored.
+///
+static std::map<std::string, ThroughputMetrics> readBaseline(const std::string &fileName)
+{
+    std::map<std::string, ThroughputMetrics> result;
+    std::ifstream file(fileName);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+        std::istringstream stream(line);
+        std::string name;
+        ThroughputMetrics metrics{};
+        if (stream >> name >> metrics.scenariosPerSecond >> metrics.nsPerHandoff >> metrics.peakRssKb) {
+            result[name] = metrics;
+        }
+    }
+    return result;
+}
+
+///
+/// \brief Runs a model several times and keeps the best value of each metric
+/// \param create Function creating the model, called in the children
+/// \param nbRuns The number of runs
+/// \param nbScenarios The number of scenarios of a run, filled if the runs succeeded
+/// \param metrics The best metrics, filled if the runs succeeded
+/// \return true if every run succeeded, false else
+///
+static bool runBest(const std::function<std::unique_ptr<PcoModel>()> &create, int nbRuns,
+                    double &nbScenarios, ThroughputMetrics &metrics)
+{
+    for (int run = 0; run < nbRuns; run++) {
+        RunMeasures measures{};
+        if (!runInChild(create, measures) || (measures.seconds <= 0) || (measures.nbHandoffs <= 0)) {
+            return false;
+        }
+        nbScenarios = measures.nbScenarios;
+        ThroughputMetrics current{measures.nbScenarios / measures.seconds,
+                                  measures.seconds * 1e9 / measures.nbHandoffs, measures.peakRssKb};
+        if (run == 0) {
+            metrics = current;
+            continue;
+        }
+        metrics.scenariosPerSecond = std::max(metrics.scenariosPerSecond, current.scenariosPerSecond);
+        metrics.nsPerHandoff = std::min(metrics.nsPerHandoff, current.nsPerHandoff);
+        metrics.peakRssKb = std::min(metrics.peakRssKb, current.peakRssKb);
+    }
+    return true;
+}
+
+///
+/// \brief Parses comma separated numbers
+/// \param text The text
+/// \return The numbers
+///
+static std::vector<double> parseList(const std::string &text)
+{
+    std::vector<double> result;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        result.push_back(std::atof(item.c_str()));
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<SyntheticParameters> synthetics;
+    std::vector<std::pair<int, int> > buffers;
+    std::string baselineFile = THROUGHPUT_BASELINE;
+    std::string writeBaselineFile;
+    double threshold = 0.10;
+    int nbRuns = 5;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if ((argument == "--synthetic") && hasValue) {
+            auto values = parseList(argv[++i]);
+            if (values.size() == 4) {
+                synthetics.push_back({static_cast<int>(values[0]), static_cast<int>(values[1]),
+                                      std::max(1, static_cast<int>(values[2])), values[3]});
+                continue;
+            }
+        }
+        else if ((argument == "--buffer") && hasValue) {
+            auto values = parseList(argv[++i]);
+            if (values.size() == 2) {
+                buffers.emplace_back(static_cast<int>(values[0]), static_cast<int>(values[1]));
+                continue;
+            }
+        }
+        else if ((argument == "--baseline") && hasValue) {
+            baselineFile = argv[++i];
+            continue;
+        }
+        else if (argument == "--no-baseline") {
+            baselineFile.clear();
+            continue;
+        }
+        else if ((argument == "--runs") && hasValue) {
+            nbRuns = std::max(1, std::atoi(argv[++i]));
+            continue;
+        }
+        else if ((argument == "--write-baseline") && hasValue) {
+            writeBaselineFile = argv[++i];
+            continue;
+        }
+        else if ((argument == "--threshold") && hasValue) {
+            threshold = std::atof(argv[++i]);
+            continue;
+        }
+        std::cout << "Usage: " << argv[0] << " [--synthetic N,K,branching,share]... [--buffer P,C]... [--runs N]"
+                  << " [--baseline file | --no-baseline] [--write-baseline file] [--threshold ratio]" << std::endl;
+        return 2;
+    }
+    if (synthetics.empty() && buffers.empty()) {
+        synthetics = {{2, 6, 1, 0.0}, {3, 3, 1, 0.5}, {3, 3, 2, 0.25}, {4, 2, 1, 1.0}};
+        buffers = {{3, 3}, {4, 4}};
+    }
+
+    std::vector<std::pair<std::string, std::function<std::unique_ptr<PcoModel>()> > > models;
+    for (const auto &parameters : synthetics) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "synthetic/%dx%d-b%d-p%.2f", parameters.nbThreads, parameters.nbSections,
+                      parameters.branching, parameters.protectedShare);
+        models.emplace_back(name, [parameters] { return std::make_unique<SyntheticModel>(parameters); });
+    }
+    for (const auto &buffer : buffers) {
+        std::string name = "buffer/" + std::to_string(buffer.first) + "p" + std::to_string(buffer.second) + "c";
+        models.emplace_back(name, [buffer] { return std::make_unique<ScaledBufferModel>(buffer.first, buffer.second); });
+    }
+
+    auto baseline = baselineFile.empty() ? std::map<std::string, ThroughputMetrics>() : readBaseline(baselineFile);
+    if (!baselineFile.empty()) {
+        std::printf("Baseline %s : %zu models\n", baselineFile.c_str(), baseline.size());
+    }
+    std::map<std::string, ThroughputMetrics> results;
+    int nbRegressions = 0;
+    std::printf("Best of %d runs\n", nbRuns);
+    std::printf("%-28s %10s %12s %12s %10s\n", "model", "scenarios", "scenarios/s", "ns/handoff", "RSS (kB)");
+    for (const auto &model : models) {
+        double nbScenarios = 0;
+        ThroughputMetrics metrics{};
+        if (!runBest(model.second, nbRuns, nbScenarios, metrics)) {
+            std::printf("%-28s failed\n", model.first.c_str());
+            nbRegressions++;
+            continue;
+        }
+        results[model.first] = metrics;
+        std::printf("%-28s %10.0f %12.1f %12.1f %10.0f\n", model.first.c_str(), nbScenarios,
+                    metrics.scenariosPerSecond, metrics.nsPerHandoff, metrics.peakRssKb);
+
+        auto reference = baseline.find(model.first);
+        if (reference == baseline.end()) {
+            continue;
+        }
+        const auto &base = reference->second;
+        std::vector<std::string> regressions;
+        if (metrics.scenariosPerSecond < base.scenariosPerSecond * (1.0 - threshold)) {
+            regressions.emplace_back("scenarios/s");
+        }
+        if (metrics.nsPerHandoff > base.nsPerHandoff * (1.0 + threshold)) {
+            regressions.emplace_back("ns/handoff");
+        }
+        if (metrics.peakRssKb > base.peakRssKb * (1.0 + threshold)) {
+            regressions.emplace_back("RSS");
+        }
+        std::printf("%-28s %10s %+11.1f%% %+11.1f%% %+9.1f%%", "  vs baseline", "",
+                    100.0 * (metrics.scenariosPerSecond / base.scenariosPerSecond - 1.0),
+                    100.0 * (metrics.nsPerHandoff / base.nsPerHandoff - 1.0),
+                    100.0 * (metrics.peakRssKb / base.peakRssKb - 1.0));
+        for (const auto &regression : regressions) {
+            std::printf("  REGRESSION %s", regression.c_str());
+        }
+        std::printf("\n");
+        nbRegressions += static_cast<int>(regressions.size());
+    }
+
+    if (!writeBaselineFile.empty()) {
+        std::ofstream file(writeBaselineFile);
+        file << "# Best of " << nbRuns << " runs\n";
+        file << "# model scenarios/s ns/handoff peakRssKb\n";
+        for (const auto &result : results) {
+            file << result.first << " " << result.second.scenariosPerSecond << " " << result.second.nsPerHandoff
+                 << " " << result.second.peakRssKb << "\n";
+        }
+    }
+
+    if (nbRegressions > 0) {
+        std::printf("%d regressions beyond %.0f%%\n", nbRegressions, threshold * 100.0);
+        return 1;
+    }
+    return 0;
+}
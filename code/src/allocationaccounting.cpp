@@ -0,0 +1,189 @@
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include <sys/resource.h>
+
+#include "allocationaccounting.h"
+
+
+#ifdef PCO_ALLOCATION_ACCOUNTING
+
+thread_local AllocationSubsystem AllocationScope::current{AllocationSubsystem::Other};
+
+namespace {
+
+///
+/// \brief Counters of a subsystem, updated by any thread
+///
+typedef struct {
+    std::atomic<uint64_t> nbAllocations;
+    std::atomic<uint64_t> nbDeallocations;
+    std::atomic<uint64_t> allocatedBytes;
+    std::atomic<int64_t> liveBytes;
+    std::atomic<int64_t> peakBytes;
+} Counters;
+
+/// The counters, zero-initialized before any allocation as they are static
+std::array<Counters, nbAllocationSubsystems> counters;
+
+///
+/// \brief Header put before every block, so that the deallocation knows its size and subsystem
+///
+/// Its size keeps the alignment of the block given by malloc().
+///
+typedef struct alignas(alignof(std::max_align_t)) {
+    size_t size;
+    AllocationSubsystem subsystem;
+} BlockHeader;
+
+void *allocate(size_t size)
+{
+    auto subsystem = AllocationScope::getCurrent();
+    auto header = static_cast<BlockHeader *>(std::malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) {
+        return nullptr;
+    }
+    header->size = size;
+    header->subsystem = subsystem;
+    auto &c = counters[static_cast<size_t>(subsystem)];
+    c.nbAllocations.fetch_add(1, std::memory_order_relaxed);
+    c.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = c.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+    int64_t peak = c.peakBytes.load(std::memory_order_relaxed);
+    while ((live > peak) && !c.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return header + 1;
+}
+
+void deallocate(void *pointer)
+{
+    if (pointer == nullptr) {
+        return;
+    }
+    auto header = static_cast<BlockHeader *>(pointer) - 1;
+    auto &c = counters[static_cast<size_t>(header->subsystem)];
+    c.nbDeallocations.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(static_cast<int64_t>(header->size), std::memory_order_relaxed);
+    std::free(header);
+}
+
+} // namespace
+
+void *operator new(size_t size)
+{
+    void *pointer = allocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    deallocate(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    deallocate(pointer);
+}
+
+AllocationStats AllocationAccounting::getStats(AllocationSubsystem subsystem)
+{
+    const auto &c = counters[static_cast<size_t>(subsystem)];
+    return AllocationStats{c.nbAllocations.load(std::memory_order_relaxed), c.nbDeallocations.load(std::memory_order_relaxed),
+                           c.allocatedBytes.load(std::memory_order_relaxed), c.liveBytes.load(std::memory_order_relaxed),
+                           c.peakBytes.load(std::memory_order_relaxed)};
+}
+
+void AllocationAccounting::reset()
+{
+    for (auto &c : counters) {
+        c.nbAllocations.store(0, std::memory_order_relaxed);
+        c.nbDeallocations.store(0, std::memory_order_relaxed);
+        c.allocatedBytes.store(0, std::memory_order_relaxed);
+        c.peakBytes.store(c.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+#else
+
+AllocationStats AllocationAccounting::getStats(AllocationSubsystem /*subsystem*/)
+{
+    return AllocationStats{0, 0, 0, 0, 0};
+}
+
+void AllocationAccounting::reset()
+{
+}
+
+#endif // PCO_ALLOCATION_ACCOUNTING
+
+uint64_t AllocationAccounting::getPeakRss()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // In kilobytes on Linux
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+void AllocationAccounting::print()
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "Peak RSS : %.1f MB", static_cast<double>(getPeakRss()) / (1024.0 * 1024.0));
+    std::cout << line << std::endl;
+    if (!isEnabled()) {
+        return;
+    }
+    static const char *subsystemNames[] = {"Other", "Graph", "Builder", "Analyzer", "Watchdog", "Model"};
+    std::cout << "Allocations :" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-10s %12s %14s %14s %14s", "", "count", "allocated (B)", "live (B)", "peak (B)");
+    std::cout << line << std::endl;
+    for (size_t i = 0; i < nbAllocationSubsystems; i++) {
+        auto stats = getStats(static_cast<AllocationSubsystem>(i));
+        std::snprintf(line, sizeof(line), "  %-10s %12llu %14llu %14lld %14lld", subsystemNames[i],
+                      static_cast<unsigned long long>(stats.nbAllocations),
+                      static_cast<unsigned long long>(stats.allocatedBytes), static_cast<long long>(stats.liveBytes),
+                      static_cast<long long>(stats.peakBytes));
+        std::cout << line << std::endl;
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef ALLOCATIONACCOUNTING_H
+#define ALLOCATIONACCOUNTING_H
+
+#include <cstddef>
+#include <cstdint>
+
+///
+/// \brief The parts of the checker the allocations are attributed to
+///
+enum class AllocationSubsystem : uint8_t {
+    /// Anything outside of a scope, for instance the model checker itself
+    Other,
+    /// The scenario graphs and their flat copies
+    Graph,
+    /// The scenario builders and the scenarios they generate
+    Builder,
+    /// The concurrency analyzers
+    Analyzer,
+    /// The watchdog and its queues
+    Watchdog,
+    /// The model: its build, its hooks and the code of its threads
+    Model
+};
+
+/// Number of AllocationSubsystem
+constexpr size_t nbAllocationSubsystems = 6;
+
+///
+/// \brief Allocation counters of a subsystem
+///
+typedef struct {
+    /// Number of allocations
+    uint64_t nbAllocations;
+    /// Number of deallocations
+    uint64_t nbDeallocations;
+    /// Total number of bytes allocated
+    uint64_t allocatedBytes;
+    /// Number of bytes currently allocated
+    int64_t liveBytes;
+    /// Highest number of bytes allocated at the same time
+    int64_t peakBytes;
+} AllocationStats;
+
+///
+/// \brief The AllocationScope class
+///
+/// Attributes the allocations of the current thread to a subsystem for its
+/// lifetime, then restores the previous one. Scopes can be nested.
+///
+/// The allocations are only counted when the library is built with the
+/// PCO_ALLOCATION_ACCOUNTING CMake option, which replaces the global
+/// operator new and operator delete. Without it, a scope does nothing.
+///
+/// \code{cpp}
+/// {
+///     AllocationScope scope(AllocationSubsystem::Builder);
+///     scenario = builder->getNext();
+/// }
+/// \endcode
+///
+class AllocationScope
+{
+public:
+
+#ifdef PCO_ALLOCATION_ACCOUNTING
+    explicit AllocationScope(AllocationSubsystem subsystem) : previous(current) { current = subsystem; }
+
+    ~AllocationScope() { current = previous; }
+
+    /// Gets the subsystem of the allocations of the current thread
+    static AllocationSubsystem getCurrent() { return current; }
+
+private:
+
+    /// The subsystem before the scope
+    AllocationSubsystem previous;
+
+    /// The subsystem of the allocations of the current thread
+    static thread_local AllocationSubsystem current;
+#else
+    explicit AllocationScope(AllocationSubsystem /*subsystem*/) {}
+#endif
+
+public:
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+};
+
+///
+/// \brief The AllocationAccounting class
+///
+/// Reads the allocation counters of the subsystems, kept with relaxed atomics
+/// by the replaced operator new, and the peak resident set size of the
+/// process, which is always available.
+///
+class AllocationAccounting
+{
+public:
+
+    ///
+    /// \brief Indicates whether the allocations are counted
+    /// \return true if built with PCO_ALLOCATION_ACCOUNTING
+    ///
+    static constexpr bool isEnabled()
+    {
+#ifdef PCO_ALLOCATION_ACCOUNTING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    ///
+    /// \brief Gets the counters of a subsystem
+    /// \param subsystem The subsystem
+    /// \return The counters, all 0 if the allocations are not counted
+    ///
+    static AllocationStats getStats(AllocationSubsystem subsystem);
+
+    ///
+    /// \brief Resets the counters, except the live bytes, the peaks starting again from them
+    ///
+    static void reset();
+
+    ///
+    /// \brief Gets the peak resident set size of the process
+    /// \return The size in bytes
+    ///
+    static uint64_t getPeakRss();
+
+    ///
+    /// \brief Prints the peak resident set size, and the counters of each subsystem if enabled
+    ///
+    static void print();
+};
+
+#endif // ALLOCATIONACCOUNTING_H
@@ -1,5 +1,6 @@
 
 
+#include "allocationaccounting.h"
 #include "analyzerwatchdog.h"
 #include "pcoconcurrencyanalyzer.h"
 
@@ -23,6 +24,7 @@ void AnalyzerWatchDog::setConcurrencyAnalyzer(std::shared_ptr<PcoConcurrencyAnal
 }
 
 void AnalyzerWatchDog::trigger(int nbBlocked) {
+    AllocationScope scope(AllocationSubsystem::Watchdog);
     std::unique_lock<std::mutex> lock(mutex);
     q.push(nbBlocked);
     qA.push(analyzer);
@@ -33,6 +35,7 @@ void AnalyzerWatchDog::trigger(int nbBlocked) {
 
 void AnalyzerWatchDog::function()
 {
+    AllocationScope scope(AllocationSubsystem::Watchdog);
     while (true) {
         int n;
         std::shared_ptr<PcoConcurrencyAnalyzer> a;
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "chrometracewriter.h"
+
+
+///
+/// \brief Gets the name of a trace event
+/// \param event The event
+/// \return The name shown in the trace
+///
+static std::string eventName(const TraceEvent &event)
+{
+    switch (event.type) {
+    case TraceEventType::StartSection: return "startSection(" + std::to_string(event.section) + ")";
+    case TraceEventType::EndSection: return "endSection";
+    case TraceEventType::EndScenario: return "endScenario";
+    case TraceEventType::Wait: return "wait";
+    case TraceEventType::Section: return "section " + std::to_string(event.section);
+    }
+    return "";
+}
+
+///
+/// \brief Escapes a string for JSON
+/// \param text The string
+/// \return The escaped string
+///
+static std::string escape(const std::string &text)
+{
+    std::string result;
+    for (char c : text) {
+        if ((c == '"') || (c == '\\')) {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+bool ChromeTraceWriter::open(const std::string &fileName)
+{
+    file.open(fileName, std::ios::trunc);
+    nbScenarios = 0;
+    firstEvent = true;
+    if (!file) {
+        return false;
+    }
+    file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    return true;
+}
+
+void ChromeTraceWriter::writeEvent(const std::string &name, char phase, uint64_t timestamp, size_t pid, size_t tid,
+                                   const std::string &args)
+{
+    char ts[32];
+    // Microseconds, with the nanoseconds as decimals
+    std::snprintf(ts, sizeof(ts), "%llu.%03llu", static_cast<unsigned long long>(timestamp / 1000),
+                  static_cast<unsigned long long>(timestamp % 1000));
+    file << (firstEvent ? "" : ",\n") << "{\"name\": \"" << escape(name) << "\", \"ph\": \"" << phase
+         << "\", \"ts\": " << ts << ", \"pid\": " << pid << ", \"tid\": " << tid;
+    if (!args.empty()) {
+        file << ", \"args\": " << args;
+    }
+    file << "}";
+    firstEvent = false;
+}
+
+void ChromeTraceWriter::addScenario(size_t index, const Scenario &scenario, const std::vector<ObservableThread *> &threads,
+                                    PcoConcurrencyAnalyzer::EndingStatus status)
+{
+    if (!file.is_open()) {
+        return;
+    }
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    for (auto thread : threads) {
+        const auto &events = thread->getTraceEvents();
+        if (!events.empty()) {
+            first = std::min(first, events.front().timestamp);
+            last = std::max(last, events.back().timestamp);
+        }
+    }
+    if (first == UINT64_MAX) {
+        return;
+    }
+
+    std::string processName = "Scenario " + std::to_string(index) + " : " + PcoConcurrencyAnalyzer::toString(status);
+    writeEvent("process_name", 'M', 0, index, 0, "{\"name\": \"" + escape(processName) + "\"}");
+    writeEvent("process_sort_index", 'M', 0, index, 0, "{\"sort_index\": " + std::to_string(index) + "}");
+    writeEvent("scenario", 'M', 0, index, 0, "{\"points\": \"" + escape(ScenarioPrint::toString(scenario)) + "\"}");
+
+    for (size_t t = 0; t < threads.size(); t++) {
+        size_t tid = t + 1;
+        writeEvent("thread_name", 'M', 0, index, tid, "{\"name\": \"" + escape(threads[t]->getId()) + "\"}");
+        std::vector<const TraceEvent *> open;
+        for (const auto &event : threads[t]->getTraceEvents()) {
+            if (event.phase == 'B') {
+                open.push_back(&event);
+            }
+            else if (!open.empty()) {
+                open.pop_back();
+            }
+            writeEvent(eventName(event), event.phase, event.timestamp - first, index, tid);
+        }
+        // Spans interrupted by the end of the scenario
+        while (!open.empty()) {
+            writeEvent(eventName(*open.back()), 'E', last - first, index, tid);
+            open.pop_back();
+        }
+    }
+    nbScenarios++;
+}
+
+void ChromeTraceWriter::finish()
+{
+    if (!file.is_open()) {
+        return;
+    }
+    file << "\n]}\n";
+    file.close();
+}
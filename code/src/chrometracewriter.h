@@ -0,0 +1,87 @@
+#ifndef CHROMETRACEWRITER_H
+#define CHROMETRACEWRITER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief The ChromeTraceWriter class
+///
+/// Writes the trace events recorded by ObservableThread into a file in the
+/// Chrome trace event format, which can be opened by Perfetto
+/// (ui.perfetto.dev) or chrome://tracing.
+///
+/// Each scenario is a process of the trace, named after its index and its
+/// ending status, with one track per thread. Its timestamps start at 0, so
+/// that the scenarios can be compared. The spans still open when the scenario
+/// ends, for instance the wait of a thread that never got its turn, are
+/// closed at the last event of the scenario.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ObservableThread::setTracing(true);
+/// ChromeTraceWriter writer;
+/// writer.open("trace.json");
+/// // For each scenario, clearTraceEvents() on the threads, run, join, then:
+/// writer.addScenario(index, scenario, threads, status);
+/// writer.finish();
+/// \endcode
+///
+class ChromeTraceWriter
+{
+public:
+
+    ///
+    /// \brief Creates the file
+    /// \param fileName The name of the file
+    /// \return true if the file could be created, false else
+    ///
+    bool open(const std::string &fileName);
+
+    ///
+    /// \brief Writes the events recorded by the threads for a scenario
+    /// \param index The index of the scenario in the run, used as process id
+    /// \param scenario The scenario
+    /// \param threads The threads, already joined
+    /// \param status The ending status of the scenario
+    ///
+    void addScenario(size_t index, const Scenario &scenario, const std::vector<ObservableThread *> &threads,
+                     PcoConcurrencyAnalyzer::EndingStatus status);
+
+    ///
+    /// \brief Ends the JSON document and closes the file
+    ///
+    void finish();
+
+    /// Gets the number of scenarios written
+    [[nodiscard]] size_t getNbScenarios() const { return nbScenarios; }
+
+private:
+
+    ///
+    /// \brief Writes an event
+    /// \param name The name of the event
+    /// \param phase The phase, 'B', 'E' or 'M'
+    /// \param timestamp The time, in nanoseconds from the start of the scenario
+    /// \param pid The process id
+    /// \param tid The thread id
+    /// \param args The arguments, as a JSON object, or empty
+    ///
+    void writeEvent(const std::string &name, char phase, uint64_t timestamp, size_t pid, size_t tid,
+                    const std::string &args = "");
+
+    /// The file
+    std::ofstream file;
+
+    /// Number of scenarios written
+    size_t nbScenarios{0};
+
+    /// Whether an event has already been written, to separate them
+    bool firstEvent{true};
+};
+
+#endif // CHROMETRACEWRITER_H
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+#include "eventlog.h"
+
+
+EventRing::EventRing(size_t capacity, uint32_t thread) :
+    thread(thread)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    records.resize(size);
+    mask = size - 1;
+}
+
+bool EventRing::push(const EventLogRecord &record)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) > mask) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    records[h & mask] = record;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+size_t EventRing::drain(std::vector<EventLogRecord> &out)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    for (size_t i = t; i != h; i++) {
+        out.push_back(records[i & mask]);
+    }
+    tail.store(h, std::memory_order_release);
+    return h - t;
+}
+
+
+EventLog *EventLog::getInstance()
+{
+    static EventLog instance;
+    return &instance;
+}
+
+EventLog::~EventLog()
+{
+    close();
+}
+
+bool EventLog::open(const std::string &fileName, size_t ringCapacity)
+{
+    close();
+    std::lock_guard lock(mutex);
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    EventLogHeader header{};
+    std::copy(std::begin(eventLogMagic), std::end(eventLogMagic), header.magic);
+    header.version = eventLogVersion;
+    header.recordSize = sizeof(EventLogRecord);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    this->ringCapacity = ringCapacity;
+    rings.clear();
+    names.clear();
+    nbNamesWritten = 0;
+    stopping = false;
+    generation++;
+    opened.store(true, std::memory_order_release);
+    writer = std::thread(&EventLog::writerLoop, this);
+    return true;
+}
+
+void EventLog::close()
+{
+    if (!opened.load(std::memory_order_acquire)) {
+        return;
+    }
+    stopping = true;
+    writer.join();
+    opened.store(false, std::memory_order_release);
+
+    std::lock_guard lock(mutex);
+    drainAll();
+    for (const auto &ring : rings) {
+        if (ring->getNbDropped() > 0) {
+            uint64_t nb = ring->getNbDropped();
+            EventLogBlock block{static_cast<uint32_t>(EventLogBlockType::Drops), 1, ring->getThread()};
+            file.write(reinterpret_cast<const char *>(&block), sizeof(block));
+            file.write(reinterpret_cast<const char *>(&nb), sizeof(nb));
+        }
+    }
+    file.close();
+}
+
+uint32_t EventLog::intern(const std::string &name)
+{
+    for (size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            return static_cast<uint32_t>(i);
+        }
+    }
+    names.push_back(name);
+    return static_cast<uint32_t>(names.size() - 1);
+}
+
+EventRing *EventLog::createRing(const std::string &name)
+{
+    std::lock_guard lock(mutex);
+    rings.emplace_back(std::make_unique<EventRing>(ringCapacity, intern(name)));
+    return rings.back().get();
+}
+
+uint64_t EventLog::getNbDropped()
+{
+    std::lock_guard lock(mutex);
+    uint64_t result = 0;
+    for (const auto &ring : rings) {
+        result += ring->getNbDropped();
+    }
+    return result;
+}
+
+size_t EventLog::drainAll()
+{
+    for (; nbNamesWritten < names.size(); nbNamesWritten++) {
+        const auto &name = names[nbNamesWritten];
+        EventLogBlock block{static_cast<uint32_t>(EventLogBlockType::Name), static_cast<uint32_t>(name.size()),
+                            static_cast<uint32_t>(nbNamesWritten)};
+        file.write(reinterpret_cast<const char *>(&block), sizeof(block));
+        file.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    buffer.clear();
+    for (const auto &ring : rings) {
+        ring->drain(buffer);
+    }
+    if (!buffer.empty()) {
+        EventLogBlock block{static_cast<uint32_t>(EventLogBlockType::Records), static_cast<uint32_t>(buffer.size()), 0};
+        file.write(reinterpret_cast<const char *>(&block), sizeof(block));
+        file.write(reinterpret_cast<const char *>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size() * sizeof(EventLogRecord)));
+    }
+    return buffer.size();
+}
+
+void EventLog::writerLoop()
+{
+    while (!stopping.load(std::memory_order_acquire)) {
+        size_t nb;
+        {
+            std::lock_guard lock(mutex);
+            nb = drainAll();
+        }
+        if (nb == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
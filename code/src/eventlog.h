@@ -0,0 +1,271 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///
+/// \brief The kind of an event log record
+///
+enum class EventLogType : uint16_t {
+    StartSectionIn,
+    StartSectionOut,
+    EndSectionIn,
+    EndSectionOut,
+    EndScenarioIn,
+    EndScenarioOut
+};
+
+///
+/// \brief A record of the event log, 24 bytes
+///
+typedef struct {
+    /// Time of the event, in nanoseconds of the steady clock
+    uint64_t timestamp;
+    /// Interned id of the thread, see EventLog::intern()
+    uint32_t thread;
+    /// Kind of event, an EventLogType
+    uint16_t type;
+    /// Unused, 0
+    uint16_t reserved;
+    /// Section number, for the StartSection events
+    int32_t section;
+    /// Unused, 0
+    uint32_t padding;
+} EventLogRecord;
+
+///
+/// \brief Header of an event log file
+///
+/// It is followed by blocks, each one starting with an EventLogBlock:
+///
+/// - Name: the thread id given by value, then count characters of its name;
+/// - Records: count EventLogRecord;
+/// - Drops: the thread id given by value, and count records lost because its ring was full.
+///
+typedef struct {
+    /// "PCOEVLOG"
+    char magic[8];
+    /// Version of the format
+    uint32_t version;
+    /// Size of a record
+    uint32_t recordSize;
+} EventLogHeader;
+
+///
+/// \brief Header of a block of an event log file
+///
+typedef struct {
+    /// Kind of block, an EventLogBlockType
+    uint32_t type;
+    /// Number of elements of the block
+    uint32_t count;
+    /// Thread id for the Name and Drops blocks, 0 else
+    uint32_t value;
+} EventLogBlock;
+
+///
+/// \brief The kind of a block of an event log file
+///
+enum class EventLogBlockType : uint32_t {
+    Name,
+    Records,
+    Drops
+};
+
+/// Magic string of the event log files
+constexpr char eventLogMagic[8] = {'P', 'C', 'O', 'E', 'V', 'L', 'O', 'G'};
+
+/// Current version of the event log format
+constexpr uint32_t eventLogVersion = 1;
+
+///
+/// \brief The EventRing class
+///
+/// Lock-free ring of EventLogRecord with a single producer, the thread
+/// logging, and a single consumer, the writer of the EventLog. When the ring
+/// is full, the record is dropped and counted.
+///
+class EventRing
+{
+public:
+
+    ///
+    /// \brief EventRing
+    /// \param capacity The number of records, rounded up to a power of two
+    /// \param thread The interned id of the thread
+    ///
+    EventRing(size_t capacity, uint32_t thread);
+
+    ///
+    /// \brief Adds a record, from the producer
+    /// \param record The record
+    /// \return false if the ring was full and the record dropped
+    ///
+    bool push(const EventLogRecord &record);
+
+    ///
+    /// \brief Removes the available records, from the consumer
+    /// \param out The vector the records are appended to
+    /// \return The number of records removed
+    ///
+    size_t drain(std::vector<EventLogRecord> &out);
+
+    /// Gets the interned id of the thread
+    [[nodiscard]] uint32_t getThread() const { return thread; }
+
+    /// Gets the number of dropped records
+    [[nodiscard]] uint64_t getNbDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+    /// The records
+    std::vector<EventLogRecord> records;
+
+    /// Capacity minus 1, capacity being a power of two
+    size_t mask;
+
+    /// The interned id of the thread
+    uint32_t thread;
+
+    /// Index of the next record written, only modified by the producer
+    alignas(64) std::atomic<size_t> head{0};
+
+    /// Index of the next record read, only modified by the consumer
+    alignas(64) std::atomic<size_t> tail{0};
+
+    /// Number of dropped records
+    std::atomic<uint64_t> dropped{0};
+};
+
+///
+/// \brief The EventLog class
+///
+/// Binary log of the section events of the ObservableThread, replacing the
+/// lines printed through std::cout in verbose mode. Each thread writes fixed
+/// size records to its own EventRing, without lock nor system call, and a
+/// background thread drains the rings to the file. The thread ids are interned
+/// once, so a record does not hold any string. The file is turned back into a
+/// readable log by the eventlog_decode tool.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// EventLog::getInstance()->open("run.evlog");
+/// ObservableThread::setVerbosity(true);
+/// checker.run();
+/// EventLog::getInstance()->close();
+/// \endcode
+///
+class EventLog
+{
+public:
+
+    ///
+    /// \brief Gets the event log of the process
+    /// \return The event log
+    ///
+    static EventLog *getInstance();
+
+    ~EventLog();
+
+    ///
+    /// \brief Creates the file and starts the writer thread
+    /// \param fileName The name of the file
+    /// \param ringCapacity The number of records of the ring of each thread
+    /// \return true if the file could be created, false else
+    ///
+    bool open(const std::string &fileName, size_t ringCapacity = 1 << 14);
+
+    ///
+    /// \brief Stops the writer thread after it has drained the rings, and closes the file
+    ///
+    /// No thread shall be logging.
+    ///
+    void close();
+
+    /// Indicates whether the log is open
+    [[nodiscard]] bool isOpen() const { return opened.load(std::memory_order_acquire); }
+
+    ///
+    /// \brief Gets the generation of the log, incremented by each open()
+    /// \return The generation
+    ///
+    /// Used by the threads to know whether their ring is still valid.
+    ///
+    [[nodiscard]] uint64_t getGeneration() const { return generation.load(std::memory_order_acquire); }
+
+    ///
+    /// \brief Creates the ring of a thread
+    /// \param name The id of the thread
+    /// \return The ring, owned by the log until close()
+    ///
+    EventRing *createRing(const std::string &name);
+
+    ///
+    /// \brief Gets the total number of dropped records since open()
+    /// \return The number of dropped records
+    ///
+    uint64_t getNbDropped();
+
+private:
+
+    EventLog() = default;
+
+    ///
+    /// \brief Interns a thread id
+    /// \param name The id
+    /// \return Its interned id, the same for the same name
+    ///
+    uint32_t intern(const std::string &name);
+
+    ///
+    /// \brief Writes the pending names and the records of the rings
+    /// \return The number of records written
+    ///
+    size_t drainAll();
+
+    /// Loop of the writer thread
+    void writerLoop();
+
+    /// The file
+    std::ofstream file;
+
+    /// Protects the rings, the names and the file
+    std::mutex mutex;
+
+    /// The rings of the threads
+    std::vector<std::unique_ptr<EventRing> > rings;
+
+    /// The interned names
+    std::vector<std::string> names;
+
+    /// Number of names already written
+    size_t nbNamesWritten{0};
+
+    /// Capacity of the rings
+    size_t ringCapacity{0};
+
+    /// Records drained, reused between the drains
+    std::vector<EventLogRecord> buffer;
+
+    /// The writer thread
+    std::thread writer;
+
+    /// Whether the writer shall stop
+    std::atomic<bool> stopping{false};
+
+    /// Whether the log is open
+    std::atomic<bool> opened{false};
+
+    /// Incremented by each open()
+    std::atomic<uint64_t> generation{0};
+};
+
+#endif // EVENTLOG_H
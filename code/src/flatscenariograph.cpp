@@ -0,0 +1,57 @@
+#include <unordered_map>
+
+#include "allocationaccounting.h"
+#include "flatscenariograph.h"
+
+
+FlatScenarioGraph::FlatScenarioGraph(const std::vector<ScenarioGraphNode *> &firstNodes)
+{
+    AllocationScope scope(AllocationSubsystem::Graph);
+    // Numbering of the nodes in depth-first order, so that a chain of sections
+    // is stored contiguously
+    std::unordered_map<const ScenarioGraphNode *, NodeIndex> indices;
+    std::vector<const ScenarioGraphNode *> stack;
+    for (auto first : firstNodes) {
+        if (indices.find(first) == indices.end()) {
+            indices[first] = static_cast<NodeIndex>(sources.size());
+            sources.push_back(first);
+            stack.push_back(first);
+        }
+        roots.push_back(indices[first]);
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            for (auto it = node->next.rbegin(); it != node->next.rend(); it++) {
+                if (indices.find(*it) == indices.end()) {
+                    indices[*it] = static_cast<NodeIndex>(sources.size());
+                    sources.push_back(*it);
+                    stack.push_back(*it);
+                }
+            }
+        }
+    }
+
+    threads.reserve(sources.size());
+    numbers.reserve(sources.size());
+    mayEnds.reserve(sources.size());
+    offsets.reserve(sources.size() + 1);
+    for (auto node : sources) {
+        threads.push_back(node->thread);
+        numbers.push_back(node->number);
+        mayEnds.push_back(node->mayEnd ? 1 : 0);
+        anyMayEnd = anyMayEnd || (node->mayEnd && !node->next.empty());
+        offsets.push_back(static_cast<uint32_t>(children.size()));
+        for (auto child : node->next) {
+            children.push_back(indices[child]);
+        }
+    }
+    offsets.push_back(static_cast<uint32_t>(children.size()));
+}
+
+size_t FlatScenarioGraph::memoryUsage() const
+{
+    return offsets.capacity() * sizeof(uint32_t) + children.capacity() * sizeof(NodeIndex) +
+           threads.capacity() * sizeof(const ObservableThread *) + numbers.capacity() * sizeof(int) +
+           mayEnds.capacity() * sizeof(uint8_t) +
+           sources.capacity() * sizeof(const ScenarioGraphNode *) + roots.capacity() * sizeof(NodeIndex);
+}
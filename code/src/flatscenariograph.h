@@ -0,0 +1,170 @@
+#ifndef FLATSCENARIOGRAPH_H
+#define FLATSCENARIOGRAPH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "scenario.h"
+
+///
+/// \brief The FlatScenarioGraph class
+///
+/// This class is the finalized, immutable form of the scenario graphs of
+/// several threads, used by the scenario builders in their inner loops.
+/// Instead of chasing pointers across heap allocated ScenarioGraphNode,
+/// the nodes of all graphs are numbered with 32-bit indices and stored
+/// contiguously, in parallel arrays:
+///
+/// - the thread and the section number of each node;
+/// - the children of each node, in compressed sparse row form: the children
+///   of node i are children[offsets[i]] to children[offsets[i + 1] - 1].
+///
+/// The original nodes are kept aside, for cold data such as the semaphore
+/// effects of a section.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// FlatScenarioGraph graph(firstNodes);
+/// for (size_t t = 0; t < graph.nbThreads(); t++) {
+///     auto node = graph.getRoot(t);
+///     for (auto child = graph.childrenBegin(node); child != graph.childrenEnd(node); child++) {
+///         ScenarioPoint point = graph.getPoint(*child);
+///     }
+/// }
+/// \endcode
+///
+class FlatScenarioGraph
+{
+public:
+
+    /// Index of a node
+    using NodeIndex = uint32_t;
+
+    /// Default constructor, creates an empty graph
+    FlatScenarioGraph() = default;
+
+    ///
+    /// \brief Builds the flat form of several scenario graphs
+    /// \param firstNodes The initial node of each thread graph
+    ///
+    /// The graphs shall not be modified afterwards. Nodes reachable from
+    /// several initial nodes are shared.
+    ///
+    explicit FlatScenarioGraph(const std::vector<ScenarioGraphNode *> &firstNodes);
+
+    ///
+    /// \brief Gets the number of threads
+    /// \return The number of initial nodes given to the constructor
+    ///
+    [[nodiscard]] size_t nbThreads() const { return roots.size(); }
+
+    ///
+    /// \brief Gets the number of nodes
+    /// \return The number of nodes of all the graphs
+    ///
+    [[nodiscard]] size_t nbNodes() const { return numbers.size(); }
+
+    ///
+    /// \brief Gets the initial node of a thread
+    /// \param thread The index of the thread
+    /// \return The index of its initial node
+    ///
+    [[nodiscard]] NodeIndex getRoot(size_t thread) const { return roots[thread]; }
+
+    ///
+    /// \brief Gets the initial node of every thread
+    /// \return A vector of node indices, one per thread
+    ///
+    [[nodiscard]] const std::vector<NodeIndex> &getRoots() const { return roots; }
+
+    /// Gets a pointer to the first child of a node
+    [[nodiscard]] const NodeIndex *childrenBegin(NodeIndex node) const { return children.data() + offsets[node]; }
+
+    /// Gets a pointer past the last child of a node
+    [[nodiscard]] const NodeIndex *childrenEnd(NodeIndex node) const { return children.data() + offsets[node + 1]; }
+
+    /// Gets the number of children of a node
+    [[nodiscard]] uint32_t nbChildren(NodeIndex node) const { return offsets[node + 1] - offsets[node]; }
+
+    /// Gets a child of a node
+    [[nodiscard]] NodeIndex getChild(NodeIndex node, uint32_t child) const { return children[offsets[node] + child]; }
+
+    /// Indicates whether a node has no child
+    [[nodiscard]] bool isLeaf(NodeIndex node) const { return offsets[node] == offsets[node + 1]; }
+
+    /// Indicates whether the thread can end after a node, see ScenarioGraphNode::mayEnd
+    [[nodiscard]] bool canEnd(NodeIndex node) const { return isLeaf(node) || (mayEnds[node] != 0); }
+
+    ///
+    /// \brief Indicates whether a scenario can stop at a global position while it could go on
+    /// \param nodes The current node of each thread
+    /// \return true if every thread can end there, and one of them can still start a section
+    ///
+    /// The builders then generate the current prefix as a scenario, and go on
+    /// extending it. The position where all threads are on a leaf is not one of
+    /// them, as the prefix is generated there anyway.
+    ///
+    [[nodiscard]] bool canStop(const std::vector<NodeIndex> &nodes) const
+    {
+        if (!anyMayEnd) {
+            return false;
+        }
+        bool canGoOn = false;
+        for (auto node : nodes) {
+            if (!isLeaf(node)) {
+                if (mayEnds[node] == 0) {
+                    return false;
+                }
+                canGoOn = true;
+            }
+        }
+        return canGoOn;
+    }
+
+    /// Gets the thread of a node
+    [[nodiscard]] const ObservableThread *getThread(NodeIndex node) const { return threads[node]; }
+
+    /// Gets the section number of a node
+    [[nodiscard]] int getNumber(NodeIndex node) const { return numbers[node]; }
+
+    /// Gets the scenario point of a node
+    [[nodiscard]] ScenarioPoint getPoint(NodeIndex node) const { return ScenarioPoint{threads[node], numbers[node]}; }
+
+    /// Gets the original node, for cold data
+    [[nodiscard]] const ScenarioGraphNode *getSource(NodeIndex node) const { return sources[node]; }
+
+    ///
+    /// \brief Gets the memory used by the graph
+    /// \return The number of bytes allocated for the arrays
+    ///
+    [[nodiscard]] size_t memoryUsage() const;
+
+private:
+
+    /// Start of the children of each node in children, plus a final end offset
+    std::vector<uint32_t> offsets;
+
+    /// Children of all nodes
+    std::vector<NodeIndex> children;
+
+    /// Thread of each node
+    std::vector<const ObservableThread *> threads;
+
+    /// Section number of each node
+    std::vector<int> numbers;
+
+    /// Whether the thread can end after each node, although it has children
+    std::vector<uint8_t> mayEnds;
+
+    /// Whether a node may end its thread while having children
+    bool anyMayEnd{false};
+
+    /// Original node of each node
+    std::vector<const ScenarioGraphNode *> sources;
+
+    /// Initial node of each thread
+    std::vector<NodeIndex> roots;
+};
+
+#endif // FLATSCENARIOGRAPH_H
@@ -0,0 +1,230 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metricsexporter.h"
+
+
+///
+/// \brief Gets the current time
+/// \return The time in nanoseconds of the steady clock
+///
+static uint64_t now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+bool MetricsExporter::start(const std::string &address)
+{
+    stop();
+    int fd = -1;
+    if (address.rfind("unix:", 0) == 0) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::string path = address.substr(5);
+        if (path.empty() || (path.size() >= sizeof(addr.sun_path))) {
+            return false;
+        }
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        // A socket left by a previous run is replaced, but nothing else
+        struct stat status{};
+        if (lstat(path.c_str(), &status) == 0) {
+            if (!S_ISSOCK(status.st_mode)) {
+                std::cout << path << " exists and is not a socket" << std::endl;
+                return false;
+            }
+            unlink(path.c_str());
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((fd < 0) || (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+        socketPath = path;
+    }
+    else {
+        int port = std::atoi(address.c_str());
+        if ((port <= 0) || (port > 65535)) {
+            return false;
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        // Only reachable from the machine running the checks
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if ((fd < 0) || (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0) ||
+            (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+    }
+    if (listen(fd, 8) != 0) {
+        close(fd);
+        return false;
+    }
+
+    for (auto &nb : nbScenarios) {
+        nb.store(0, std::memory_order_relaxed);
+    }
+    nbPoints.store(0, std::memory_order_relaxed);
+    nbInvariantFailures.store(0, std::memory_order_relaxed);
+    nbQueued.store(0, std::memory_order_relaxed);
+    nbRemaining.store(0, std::memory_order_relaxed);
+    nbPruned.store(0, std::memory_order_relaxed);
+    startTime.store(now(), std::memory_order_relaxed);
+
+    listenFd = fd;
+    stopping = false;
+    server = std::thread(&MetricsExporter::serve, this);
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (listenFd < 0) {
+        return;
+    }
+    stopping = true;
+    server.join();
+    close(listenFd);
+    listenFd = -1;
+    if (!socketPath.empty()) {
+        unlink(socketPath.c_str());
+        socketPath.clear();
+    }
+}
+
+void MetricsExporter::addScenario(PcoConcurrencyAnalyzer::EndingStatus status, uint64_t nbPoints,
+                                  uint64_t nbInvariantFailures)
+{
+    // Single writer: a load and a store are enough, and cheaper than a read-modify-write
+    auto &counter = nbScenarios[static_cast<size_t>(status)];
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    this->nbPoints.store(this->nbPoints.load(std::memory_order_relaxed) + nbPoints, std::memory_order_relaxed);
+    if (nbInvariantFailures > 0) {
+        this->nbInvariantFailures.store(this->nbInvariantFailures.load(std::memory_order_relaxed) + nbInvariantFailures,
+                                        std::memory_order_relaxed);
+    }
+}
+
+void MetricsExporter::setBuilderState(uint64_t nbQueued, uint64_t nbRemaining, uint64_t nbPruned)
+{
+    this->nbQueued.store(nbQueued, std::memory_order_relaxed);
+    this->nbRemaining.store(nbRemaining, std::memory_order_relaxed);
+    this->nbPruned.store(nbPruned, std::memory_order_relaxed);
+}
+
+std::string MetricsExporter::render() const
+{
+    std::string text;
+    char line[160];
+    auto append = [&](const char *name, const char *type, const char *help) {
+        std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+        text += line;
+    };
+
+    append("pco_scenarios_total", "counter", "Scenarios run, by ending status.");
+    uint64_t total = 0;
+    for (size_t i = 0; i < nbScenarios.size(); i++) {
+        uint64_t nb = nbScenarios[i].load(std::memory_order_relaxed);
+        total += nb;
+        std::snprintf(line, sizeof(line), "pco_scenarios_total{status=\"%s\"} %llu\n", PcoConcurrencyAnalyzer::toString(static_cast<PcoConcurrencyAnalyzer::EndingStatus>(i)),
+                      static_cast<unsigned long long>(nb));
+        text += line;
+    }
+    double seconds = static_cast<double>(now() - startTime.load(std::memory_order_relaxed)) / 1e9;
+
+    auto value = [&](const char *name, const char *type, const char *help, double v) {
+        append(name, type, help);
+        std::snprintf(line, sizeof(line), "%s %.15g\n", name, v);
+        text += line;
+    };
+    value("pco_points_played_total", "counter", "Scenario points played, that is handoffs between threads.",
+          static_cast<double>(nbPoints.load(std::memory_order_relaxed)));
+    value("pco_scenarios_per_second", "gauge", "Mean number of scenarios run per second since the start.",
+          (seconds > 0.0) ? static_cast<double>(total) / seconds : 0.0);
+    value("pco_run_duration_seconds", "gauge", "Time since the start of the run.", seconds);
+    value("pco_builder_queued_scenarios", "gauge", "Scenarios generated and waiting to be run.",
+          static_cast<double>(nbQueued.load(std::memory_order_relaxed)));
+    value("pco_builder_remaining_scenarios", "gauge", "Scenarios left according to the builder, 0 if unknown.",
+          static_cast<double>(nbRemaining.load(std::memory_order_relaxed)));
+    value("pco_invariant_failures_total", "counter", "Failed checks of the model invariants.",
+          static_cast<double>(nbInvariantFailures.load(std::memory_order_relaxed)));
+    value("pco_pruned_subtrees_total", "counter", "Prefixes of scenarios dropped without being run.",
+          static_cast<double>(nbPruned.load(std::memory_order_relaxed)));
+    return text;
+}
+
+void MetricsExporter::serve()
+{
+    while (!stopping.load(std::memory_order_acquire)) {
+        // Wakes up regularly to check whether it shall stop
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd >= 0) {
+            answer(fd);
+            close(fd);
+        }
+    }
+}
+
+void MetricsExporter::answer(int fd) const
+{
+    // Only the request line matters, and a slow client shall not block the server
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buffer[1024];
+    while ((request.find("\r\n\r\n") == std::string::npos) && (request.size() < 8192)) {
+        ssize_t nb = recv(fd, buffer, sizeof(buffer), 0);
+        if (nb <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(nb));
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    if ((request.rfind("GET /metrics ", 0) == 0) || (request.rfind("GET / ", 0) == 0)) {
+        body = render();
+    }
+    else {
+        status = "404 Not Found";
+        body = "Not found, try /metrics\n";
+    }
+    std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t nb = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (nb <= 0) {
+            break;
+        }
+        sent += static_cast<size_t>(nb);
+    }
+}
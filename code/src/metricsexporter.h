@@ -0,0 +1,140 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief The MetricsExporter class
+///
+/// Embedded HTTP server publishing the progress of a run in the Prometheus
+/// text format, so that a long run can be followed, scraped or graphed
+/// while it executes. It listens either on a TCP port of the loopback
+/// interface or on a Unix socket, and answers GET /metrics with:
+///
+/// - pco_scenarios_total{status="..."}: the scenarios run, by ending status;
+/// - pco_points_played_total: the scenario points played, that is the handoffs;
+/// - pco_scenarios_per_second: the mean throughput since the start of the run;
+/// - pco_run_duration_seconds: the time since the start of the run;
+/// - pco_builder_queued_scenarios: the scenarios generated and waiting to be run;
+/// - pco_builder_remaining_scenarios: the scenarios left, as known by the builder;
+/// - pco_invariant_failures_total: the failed checks of the model invariants;
+/// - pco_pruned_subtrees_total: the prefixes dropped without being run.
+///
+/// The values are atomics written by the thread running the scenarios with
+/// relaxed stores, and read by the server thread. A request never takes a
+/// lock shared with the run, so the exporter does not slow it down.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// MetricsExporter exporter;
+/// exporter.start("9464");                  // or "unix:/tmp/pco.sock"
+/// exporter.addScenario(status, nbPoints, nbFailures);
+/// exporter.stop();
+/// \endcode
+///
+/// Then: curl http://localhost:9464/metrics
+///
+class MetricsExporter
+{
+public:
+
+    MetricsExporter() = default;
+
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &) = delete;
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+    ///
+    /// \brief Opens the socket and starts the server thread
+    /// \param address A port number, served on 127.0.0.1, or "unix:" followed by the path of a socket
+    /// \return true if the socket could be opened, false else
+    ///
+    /// The values are reset, and the duration of the run starts. An existing
+    /// file at the path of a Unix socket is only replaced if it is a socket.
+    ///
+    bool start(const std::string &address);
+
+    ///
+    /// \brief Stops the server thread and closes the socket
+    ///
+    void stop();
+
+    /// Indicates whether the server is running
+    [[nodiscard]] bool isRunning() const { return listenFd >= 0; }
+
+    ///
+    /// \brief Adds a scenario that has been run
+    /// \param status Its ending status
+    /// \param nbPoints The number of points played
+    /// \param nbInvariantFailures The number of failed checks of the invariants
+    ///
+    void addScenario(PcoConcurrencyAnalyzer::EndingStatus status, uint64_t nbPoints, uint64_t nbInvariantFailures);
+
+    ///
+    /// \brief Sets the state of the builder
+    /// \param nbQueued The number of scenarios generated and waiting
+    /// \param nbRemaining The number of scenarios left
+    /// \param nbPruned The total number of pruned subtrees
+    ///
+    void setBuilderState(uint64_t nbQueued, uint64_t nbRemaining, uint64_t nbPruned);
+
+    ///
+    /// \brief Formats the current values
+    /// \return The values in the Prometheus text format
+    ///
+    [[nodiscard]] std::string render() const;
+
+private:
+
+    /// Loop of the server thread
+    void serve();
+
+    ///
+    /// \brief Answers a connection
+    /// \param fd The socket of the connection
+    ///
+    void answer(int fd) const;
+
+    /// The listening socket, -1 if not running
+    int listenFd{-1};
+
+    /// Path of the Unix socket, removed by stop(), empty for TCP
+    std::string socketPath;
+
+    /// The server thread
+    std::thread server;
+
+    /// Whether the server shall stop
+    std::atomic<bool> stopping{false};
+
+    /// Start of the run, in nanoseconds of the steady clock
+    std::atomic<uint64_t> startTime{0};
+
+    /// Number of scenarios, by ending status
+    std::array<std::atomic<uint64_t>, PcoConcurrencyAnalyzer::nbEndingStatus> nbScenarios{};
+
+    /// Number of points played
+    std::atomic<uint64_t> nbPoints{0};
+
+    /// Number of failed checks of the invariants
+    std::atomic<uint64_t> nbInvariantFailures{0};
+
+    /// Number of scenarios waiting in the builder
+    std::atomic<uint64_t> nbQueued{0};
+
+    /// Number of scenarios left in the builder
+    std::atomic<uint64_t> nbRemaining{0};
+
+    /// Number of pruned subtrees
+    std::atomic<uint64_t> nbPruned{0};
+};
+
+#endif // METRICSEXPORTER_H
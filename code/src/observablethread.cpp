@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 
 #include "observablethread.h"
@@ -23,40 +24,199 @@ std::mutex ObservableThread::mutex;
 
 bool ObservableThread::verbose{false};
 
+bool ObservableThread::tracing{false};
+
+bool ObservableThread::profiling{false};
+
+void ObservableThread::trace(TraceEventType type, char phase, int section)
+{
+    if (!tracing) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    auto timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    traceEvents.push_back(TraceEvent{timestamp, type, phase, section});
+}
+
+void ObservableThread::logEvent(EventLogType type, int section)
+{
+    auto log = EventLog::getInstance();
+    if (!log->isOpen()) {
+        switch (type) {
+        case EventLogType::StartSectionIn:
+            std::cout << "Thread " << this->id << " in  startSection ( " << section << " ) " << std::endl;
+            break;
+        case EventLogType::StartSectionOut:
+            std::cout << "Thread " << this->id << " out startSection ( " << section << " ) " << std::endl;
+            break;
+        case EventLogType::EndSectionIn: std::cout << "Thread " << this->id << " in  endSection" << std::endl; break;
+        case EventLogType::EndSectionOut: std::cout << "Thread " << this->id << " out endSection" << std::endl; break;
+        case EventLogType::EndScenarioIn: std::cout << "Thread " << this->id << " in  endScenario" << std::endl; break;
+        case EventLogType::EndScenarioOut: std::cout << "Thread " << this->id << " out endScenario" << std::endl; break;
+        }
+        return;
+    }
+    if ((logRing == nullptr) || (logGeneration != log->getGeneration())) {
+        logGeneration = log->getGeneration();
+        logRing = log->createRing(id);
+    }
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    auto timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    logRing->push(EventLogRecord{timestamp, logRing->getThread(), static_cast<uint16_t>(type), 0, section, 0});
+}
+
+void ObservableThread::closeSectionTrace()
+{
+    if (sectionOpen) {
+        trace(TraceEventType::Section, 'E', tracedSection);
+        sectionOpen = false;
+    }
+}
+
+void ObservableThread::closeSectionProfile(std::chrono::steady_clock::time_point now)
+{
+    if (profiledSection >= 0) {
+        auto &cost = sectionCosts[profiledSection];
+        cost.nbRuns++;
+        cost.wallNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - profiledStart).count());
+        profiledSection = -1;
+    }
+}
+
 void ObservableThread::setConcurrencyAnalyzer(PcoConcurrencyAnalyzer *analyzer)
 {
     this->analyzer = analyzer;
+    boundAnalyzer = nullptr;
+    startHook = nullptr;
+    endHook = nullptr;
+    endScenarioHook = nullptr;
+}
+
+bool ObservableThread::followSection(int section)
+{
+    if (currentNode == nullptr) {
+        return false;
+    }
+    if ((nbAbsorbedPlayed < currentNode->absorbed.size()) && (currentNode->absorbed[nbAbsorbedPlayed] == section)) {
+        nbAbsorbedPlayed++;
+        return true;
+    }
+    const ScenarioGraphNode *next = nullptr;
+    for (auto child : currentNode->next) {
+        if (child->number == section) {
+            next = child;
+            break;
+        }
+    }
+    currentNode = next;
+    nbAbsorbedPlayed = 0;
+    return false;
 }
 
 void ObservableThread::obStartSection(int section)
 {
+    if (scenarioGraph && scenarioGraph->hasMergedSections() && followSection(section)) {
+        // Merged with the previous section, so not a scheduling point
+        if (profiling) {
+            auto now = std::chrono::steady_clock::now();
+            closeSectionProfile(now);
+            profiledSection = section;
+            profiledStart = now;
+        }
+        return;
+    }
+    std::chrono::steady_clock::time_point waitStart;
+    if (profiling) {
+        waitStart = std::chrono::steady_clock::now();
+        closeSectionProfile(waitStart);
+    }
+    if (tracing) {
+        closeSectionTrace();
+        trace(TraceEventType::StartSection, 'B', section);
+    }
     if (verbose) {
-        std::cout << "Thread " << this->id << " in  startSection ( " << section << " ) " << std::endl;
+        logEvent(EventLogType::StartSectionIn, section);
+    }
+    {
+        AllocationScope scope(AllocationSubsystem::Analyzer);
+        if (startHook != nullptr) {
+            startHook(boundAnalyzer, this, section);
+        }
+        else {
+            analyzer->startSection(this,section);
+        }
     }
-    analyzer->startSection(this,section);
     if (verbose) {
-        std::cout << "Thread " << this->id << " out startSection ( " << section << " ) " << std::endl;
+        logEvent(EventLogType::StartSectionOut, section);
+    }
+    if (profiling) {
+        profiledStart = std::chrono::steady_clock::now();
+        sectionCosts[section].blockedNs +=
+                static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(profiledStart - waitStart).count());
+        profiledSection = section;
+    }
+    if (tracing) {
+        trace(TraceEventType::StartSection, 'E', section);
+        trace(TraceEventType::Section, 'B', section);
+        sectionOpen = true;
+        tracedSection = section;
     }
 }
 
 void ObservableThread::obEndSection()
 {
+    if (profiling) {
+        closeSectionProfile(std::chrono::steady_clock::now());
+    }
+    if ((currentNode != nullptr) && (nbAbsorbedPlayed < currentNode->absorbed.size())) {
+        // Merged with the next section, so not a scheduling point
+        return;
+    }
     if (verbose) {
-        std::cout << "Thread " << this->id << " in  endSection" << std::endl;
+        logEvent(EventLogType::EndSectionIn);
+    }
+    if (tracing) {
+        closeSectionTrace();
+        trace(TraceEventType::EndSection, 'B');
+    }
+    {
+        AllocationScope scope(AllocationSubsystem::Analyzer);
+        if (endHook != nullptr) {
+            endHook(boundAnalyzer, this);
+        }
+        else {
+            analyzer->endSection(this);
+        }
     }
-    analyzer->endSection(this);
     if (verbose) {
-        std::cout << "Thread " << this->id << " out endSection" << std::endl;
+        logEvent(EventLogType::EndSectionOut);
     }
+    trace(TraceEventType::EndSection, 'E');
 }
 
 void ObservableThread::obEndScenario()
 {
+    if (profiling) {
+        closeSectionProfile(std::chrono::steady_clock::now());
+    }
     if (verbose) {
-        std::cout << "Thread " << this->id << " in  endScenario" << std::endl;
+        logEvent(EventLogType::EndScenarioIn);
+    }
+    if (tracing) {
+        closeSectionTrace();
+        trace(TraceEventType::EndScenario, 'B');
+    }
+    {
+        AllocationScope scope(AllocationSubsystem::Analyzer);
+        if (endScenarioHook != nullptr) {
+            endScenarioHook(boundAnalyzer, this);
+        }
+        else {
+            analyzer->endScenario(this);
+        }
     }
-    analyzer->endScenario(this);
     if (verbose) {
-        std::cout << "Thread " << this->id << " out endScenario" << std::endl;
+        logEvent(EventLogType::EndScenarioOut);
     }
+    trace(TraceEventType::EndScenario, 'E');
 }
@@ -1,12 +1,59 @@
 #ifndef OBSERVABLETHREAD_H
 #define OBSERVABLETHREAD_H
 
+#include <chrono>
+#include <map>
+
 #include <pcosynchro/pcothread.h>
 
+#include "allocationaccounting.h"
+#include "eventlog.h"
 #include "scenario.h"
 
 class PcoConcurrencyAnalyzer;
 
+///
+/// \brief The kind of a trace event
+///
+enum class TraceEventType {
+    /// A call to startSection()
+    StartSection,
+    /// A call to endSection()
+    EndSection,
+    /// A call to endScenario()
+    EndScenario,
+    /// A wait of the thread for its turn in the analyzer
+    Wait,
+    /// The code of a section, from the end of startSection() to the next call
+    Section
+};
+
+///
+/// \brief A timestamped event of an ObservableThread, see ObservableThread::setTracing()
+///
+typedef struct {
+    /// Time of the event, in nanoseconds of the steady clock
+    uint64_t timestamp;
+    /// Kind of event
+    TraceEventType type;
+    /// 'B' for the beginning of a span, 'E' for its end
+    char phase;
+    /// Section number, for StartSection and Section events
+    int section;
+} TraceEvent;
+
+///
+/// \brief Cost of a section of a thread, accumulated over the scenarios, see ObservableThread::setProfiling()
+///
+typedef struct {
+    /// Number of executions of the section
+    uint64_t nbRuns;
+    /// Time spent in the code of the section, in nanoseconds
+    uint64_t wallNs;
+    /// Time spent in startSection() waiting for the turn of the thread, in nanoseconds
+    uint64_t blockedNs;
+} SectionCost;
+
 ///
 /// \brief startSection, used to instrumentalize code
 /// \param id Id of the section
@@ -79,6 +126,26 @@ public:
     ///
     void setConcurrencyAnalyzer(PcoConcurrencyAnalyzer *analyzer);
 
+    ///
+    /// \brief Binds the thread to an analyzer, without virtual dispatch
+    /// \param analyzer The analyzer, for instance a StaticConcurrencyAnalyzer
+    ///
+    /// The section hooks call the analyzer through functions instantiated
+    /// for its exact type, so that the analyzer calls are inlined in them.
+    /// The hooks themselves remain an indirect call through a function
+    /// pointer, as the threads call startSection() without knowing the type
+    /// of their analyzer. A later call to setConcurrencyAnalyzer() restores
+    /// the PcoConcurrencyAnalyzer path.
+    ///
+    template<typename Analyzer>
+    void bindAnalyzer(Analyzer *analyzer)
+    {
+        boundAnalyzer = analyzer;
+        startHook = [](void *a, ObservableThread *t, int section) { static_cast<Analyzer *>(a)->startSection(t, section); };
+        endHook = [](void *a, ObservableThread *t) { static_cast<Analyzer *>(a)->endSection(t); };
+        endScenarioHook = [](void *a, ObservableThread *t) { static_cast<Analyzer *>(a)->endScenario(t); };
+    }
+
 
     ///
     /// \brief Starts the thread
@@ -107,18 +174,82 @@ public:
 
     [[nodiscard]] ScenarioGraph* getScenarioGraph() const { return scenarioGraph.get();}
 
+    ///
+    /// \brief Replaces the scenario graph of the thread
+    /// \param graph The new graph, for instance inferred by a ScenarioGraphRecorder, or nullptr
+    ///
+    /// No scenario builder shall be using the previous graph.
+    ///
+    void setScenarioGraph(std::unique_ptr<ScenarioGraph> graph) { scenarioGraph = std::move(graph);}
+
     ///
     /// \brief Gets the Id of the thread (the one set through the constructor)
     /// \return The Id of the thread
     ///
-    [[nodiscard]] std::string getId() const { return id;}
+    [[nodiscard]] const std::string &getId() const { return id;}
 
     ///
     /// \brief Sets the verbosity of sections enters/leaves
     /// \param verbosity true for a full verbosity, false for a quite run.
     ///
+    /// The enters and leaves are written to the EventLog if it is open, which
+    /// barely changes the timing of the threads, and printed else.
+    ///
     static void setVerbosity(bool verbosity) { verbose = verbosity;}
 
+    ///
+    /// \brief Enables the recording of trace events by all the threads
+    /// \param enabled true to record the events
+    ///
+    /// Each thread records the calls to startSection(), endSection() and
+    /// endScenario(), the code of its sections and its waits in the analyzer,
+    /// in its own buffer, so that no synchronization is needed. The buffers
+    /// are read after the threads have been joined, for instance by a
+    /// ChromeTraceWriter.
+    ///
+    static void setTracing(bool enabled) { tracing = enabled;}
+
+    /// Indicates whether the trace events are recorded
+    static bool isTracing() { return tracing;}
+
+    ///
+    /// \brief Records a trace event, if the tracing is enabled
+    /// \param type The kind of event
+    /// \param phase 'B' for the beginning of a span, 'E' for its end
+    /// \param section The section number, if relevant
+    ///
+    /// It shall be called by the thread itself, or while it is blocked by the caller.
+    ///
+    void trace(TraceEventType type, char phase, int section = -1);
+
+    /// Gets the trace events recorded since the last call to clearTraceEvents()
+    [[nodiscard]] const std::vector<TraceEvent> &getTraceEvents() const { return traceEvents;}
+
+    /// Forgets the recorded trace events, shall not be called while the thread runs
+    void clearTraceEvents() { traceEvents.clear(); sectionOpen = false;}
+
+    ///
+    /// \brief Enables the measure of the cost of the sections by all the threads
+    /// \param enabled true to measure the costs
+    ///
+    /// Each thread accumulates, per section number, the time spent in the
+    /// code of the section, from the end of startSection() to the next call,
+    /// and the time spent in startSection() waiting for its turn. The sections
+    /// merged by ScenarioGraph::coarsen() are measured separately. A section
+    /// interrupted by the end of the scenario is not counted. The costs are
+    /// read after the threads have been joined, for instance by a SectionProfiler.
+    ///
+    static void setProfiling(bool enabled) { profiling = enabled;}
+
+    /// Indicates whether the cost of the sections is measured
+    static bool isProfiling() { return profiling;}
+
+    /// Gets the cost of each section since the last call to clearSectionCosts(), by section number
+    [[nodiscard]] const std::map<int, SectionCost> &getSectionCosts() const { return sectionCosts;}
+
+    /// Forgets the costs of the sections, shall not be called while the thread runs
+    void clearSectionCosts() { sectionCosts.clear(); profiledSection = -1;}
+
 private:
 
     ///
@@ -167,6 +298,10 @@ private:
 
     /// Internal method started by the real PcoThread
     void intRun() {
+        currentNode = scenarioGraph ? scenarioGraph->getFirstNode() : nullptr;
+        nbAbsorbedPlayed = 0;
+        // A section interrupted by the end of the previous scenario is not counted
+        profiledSection = -1;
         // We set thread here to be sure it is set when run() starts
         mutex.lock();
         // this->tid = std::this_thread::get_id();
@@ -174,6 +309,7 @@ private:
             this->thread = std::unique_ptr<PcoThread>(PcoThread::thisThread());
         }
         mutex.unlock();
+        AllocationScope scope(AllocationSubsystem::Model);
         run();
     }
 
@@ -182,6 +318,14 @@ private:
     ///
     PcoConcurrencyAnalyzer *analyzer{nullptr};
 
+    ///
+    /// \brief The analyzer bound by bindAnalyzer(), and its section hooks
+    ///
+    void *boundAnalyzer{nullptr};
+    void (*startHook)(void *, ObservableThread *, int){nullptr};
+    void (*endHook)(void *, ObservableThread *){nullptr};
+    void (*endScenarioHook)(void *, ObservableThread *){nullptr};
+
     ///
     /// \brief The id of the thread, for printing purpose
     ///
@@ -202,8 +346,75 @@ private:
     ///
     std::unique_ptr<PcoThread> thread {nullptr};
 
+    ///
+    /// \brief The node of the last section started, used to skip the boundaries merged by ScenarioGraph::coarsen()
+    ///
+    /// It is followed by section number from the initial node, rather than
+    /// looked up by number, as unrolled loops give several nodes the same
+    /// number, only some of them being merged. nullptr if the thread left its graph.
+    ///
+    const ScenarioGraphNode *currentNode{nullptr};
+
+    /// The number of sections of ScenarioGraphNode::absorbed of currentNode started so far
+    size_t nbAbsorbedPlayed{0};
+
+    ///
+    /// \brief Follows the start of a section in the coarsened graph of the thread
+    /// \param section The section number
+    /// \return true if the section has been merged into the current node, so is not a scheduling point
+    ///
+    bool followSection(int section);
+
     static bool verbose;
 
+    ///
+    /// \brief Logs a section enter or leave, in verbose mode
+    /// \param type The kind of event
+    /// \param section The section number, for the StartSection events
+    ///
+    void logEvent(EventLogType type, int section = -1);
+
+    /// The ring of the thread in the EventLog, nullptr if not created yet
+    EventRing *logRing{nullptr};
+
+    /// The generation of the EventLog the ring belongs to
+    uint64_t logGeneration{0};
+
+    /// Whether the trace events are recorded
+    static bool tracing;
+
+    /// The trace events of the thread
+    std::vector<TraceEvent> traceEvents;
+
+    /// Whether the Section span of the current section is open
+    bool sectionOpen{false};
+
+    /// The section number of the open Section span
+    int tracedSection{-1};
+
+    ///
+    /// \brief Closes the Section span of the current section, if open
+    ///
+    void closeSectionTrace();
+
+    /// Whether the cost of the sections is measured
+    static bool profiling;
+
+    /// The cost of each section, by section number
+    std::map<int, SectionCost> sectionCosts;
+
+    /// The section whose code is running, -1 if none
+    int profiledSection{-1};
+
+    /// The time at which the code of profiledSection started
+    std::chrono::steady_clock::time_point profiledStart;
+
+    ///
+    /// \brief Adds the time spent in the code of the running section, if any, to its cost
+    /// \param now The current time
+    ///
+    void closeSectionProfile(std::chrono::steady_clock::time_point now);
+
     friend void startSection(int id);
     friend void endSection();
     friend void endScenario();
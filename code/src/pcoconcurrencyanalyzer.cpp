@@ -37,11 +37,60 @@ const Scenario& PcoConcurrencyAnalyzer::getScenario() const
 }
 
 
+const char *PcoConcurrencyAnalyzer::toString(EndingStatus status)
+{
+    switch (status) {
+    case EndingStatus::Unknown: return "Unknown";
+    case EndingStatus::Depth: return "Depth";
+    case EndingStatus::Deadlock: return "Deadlock";
+    case EndingStatus::EndAllScenario: return "AllScenario";
+    case EndingStatus::DeadEnd: return "DeadEnd";
+    }
+    return "Unknown";
+}
+
 PcoConcurrencyAnalyzer::EndingStatus PcoConcurrencyAnalyzer::getEndingStatus()
 {
     return endingStatus;
 }
 
+void PcoConcurrencyAnalyzer::setTiming(bool timing)
+{
+    this->timing = timing;
+}
+
+uint64_t PcoConcurrencyAnalyzer::getWaitNanoseconds()
+{
+    std::lock_guard lock(mutex);
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime).count());
+}
+
+size_t PcoConcurrencyAnalyzer::getNbInvariantFailures()
+{
+    std::lock_guard lock(mutex);
+    return nbInvariantFailures;
+}
+
+std::chrono::steady_clock::time_point PcoConcurrencyAnalyzer::getEndTime()
+{
+    std::lock_guard lock(mutex);
+    return endTime;
+}
+
+void PcoConcurrencyAnalyzer::setEndingStatus(EndingStatus status)
+{
+    endingStatus = status;
+    if (timing) {
+        endTime = std::chrono::steady_clock::now();
+    }
+}
+
+size_t PcoConcurrencyAnalyzer::getIndex()
+{
+    std::lock_guard lock(mutex);
+    return index;
+}
+
 
 void PcoConcurrencyAnalyzer::start()
 {
@@ -69,7 +118,7 @@ void PcoConcurrencyAnalyzer::startSection(ObservableThread *thread, int sectionN
         currentThread = nullptr;
     }
     if (index == scenario.size()) {
-        endingStatus = EndingStatus::Depth;
+        setEndingStatus(EndingStatus::Depth);
         PcoManager::getInstance()->setFreeMode();
         aborting = true;
         for (int i = 0; i < nbWaiting; i++) {
@@ -90,7 +139,7 @@ void PcoConcurrencyAnalyzer::startSection(ObservableThread *thread, int sectionN
 
         if ((nbWaiting + PcoManager::getInstance()->nbBlockedThreads() == nbRunningThreads - 1)) {
 
-            endingStatus = EndingStatus::DeadEnd;
+            setEndingStatus(EndingStatus::DeadEnd);
             PcoManager::getInstance()->setFreeMode();
 
             aborting = true;
@@ -102,7 +151,16 @@ void PcoConcurrencyAnalyzer::startSection(ObservableThread *thread, int sectionN
             return;
         }
         nbWaiting ++;
-        waiting.wait(lock);
+        thread->trace(TraceEventType::Wait, 'B');
+        if (timing) {
+            auto waitStart = std::chrono::steady_clock::now();
+            waiting.wait(lock);
+            waitTime += std::chrono::steady_clock::now() - waitStart;
+        }
+        else {
+            waiting.wait(lock);
+        }
+        thread->trace(TraceEventType::Wait, 'E');
         if (aborting) {
             ENDING;
             return;
@@ -121,7 +179,7 @@ void PcoConcurrencyAnalyzer::endSection(ObservableThread *thread)
         currentThread = nullptr;
         if (index == scenario.size()) {
             //std::cout << Scenario::toString(scenario) << "End of scenario (max depth reached)" << std::endl;
-            endingStatus = EndingStatus::Depth;
+            setEndingStatus(EndingStatus::Depth);
             aborting = true;
             for (int i = 0; i < nbWaiting; i++) {
                 waiting.notify_one();
@@ -144,14 +202,14 @@ void PcoConcurrencyAnalyzer::endScenario(ObservableThread *thread)
     nbRunningThreads --;
     if (!aborting) {
         if (nbRunningThreads == 0) {
-            endingStatus = EndingStatus::EndAllScenario;
+            setEndingStatus(EndingStatus::EndAllScenario);
         }
         else if (currentThread == thread) {
             index ++;
             currentThread = nullptr;
             if (index == scenario.size()) {
                 //std::cout << Scenario::toString(scenario) << "End of scenario (max depth reached)" << std::endl;
-                endingStatus = EndingStatus::Depth;
+                setEndingStatus(EndingStatus::Depth);
                 aborting = true;
                 for (int i = 0; i < nbWaiting; i++) {
                     waiting.notify_one();
@@ -181,7 +239,7 @@ void PcoConcurrencyAnalyzer::checkedBlocked(int /*nbBlocked*/)
     if ((!aborting) && (endingStatus == EndingStatus::Unknown)) {
         if ((PcoManager::getInstance()->nbBlockedThreads() == nbRunningThreads) && (nbRunningThreads != 0)) {
             // std::cout << "Checker ending" << std::endl;
-            endingStatus = EndingStatus::Deadlock;
+            setEndingStatus(EndingStatus::Deadlock);
             PcoManager::getInstance()->setFreeMode();
             aborting = true;
             currentThread = nullptr;
@@ -203,6 +261,7 @@ void PcoConcurrencyAnalyzer::setModel(PcoModel *model) {
 void PcoConcurrencyAnalyzer::checkInvariants() {
     if (model != nullptr) {
         if (!model->checkInvariants()) {
+            nbInvariantFailures++;
             std::cout << "****************************************************" << std::endl;
             std::cout << "Detected an error" << std::endl;
             std::cout << ScenarioPrint::toString(scenario) << std::endl;
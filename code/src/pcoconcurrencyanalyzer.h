@@ -1,6 +1,7 @@
 #ifndef PCOCONCURRENCYANALYZER_H
 #define PCOCONCURRENCYANALYZER_H
 
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 
@@ -99,6 +100,16 @@ public:
         DeadEnd
     };
 
+    /// Number of values of EndingStatus
+    static constexpr int nbEndingStatus = 5;
+
+    ///
+    /// \brief Gets the name of an ending status
+    /// \param status The ending status
+    /// \return The name, as printed in the statistics and the exported files
+    ///
+    static const char *toString(EndingStatus status);
+
     ///
     /// \brief Returns the ending status of the analyzer
     /// \return The current ending status of the analyzer
@@ -114,6 +125,42 @@ public:
 
     const Scenario& getScenario() const;
 
+    ///
+    /// \brief Gets the index of the scenario point reached
+    /// \return The number of scenario points completely played
+    ///
+    /// When the scenario ends with a DeadEnd or a Deadlock, the point at this
+    /// index is the one that could not start or complete.
+    ///
+    size_t getIndex();
+
+    ///
+    /// \brief Enables the measure of the waiting times
+    /// \param timing true to measure the time the threads wait for their turn
+    ///
+    /// It shall be called before the threads start. The measures are used by
+    /// the ScenarioMetrics of the PcoModelChecker.
+    ///
+    void setTiming(bool timing);
+
+    ///
+    /// \brief Gets the total time the threads waited for their turn
+    /// \return The time in nanoseconds, 0 if the timing is not enabled
+    ///
+    uint64_t getWaitNanoseconds();
+
+    ///
+    /// \brief Gets the time at which the ending status was set
+    /// \return The time, the epoch of the clock if the timing is not enabled or the scenario did not end
+    ///
+    std::chrono::steady_clock::time_point getEndTime();
+
+    ///
+    /// \brief Gets the number of times the model invariants did not stand
+    /// \return The number of failed checks of the scenario
+    ///
+    size_t getNbInvariantFailures();
+
 protected:
 
     /// The scenario that has to be played
@@ -135,6 +182,24 @@ protected:
     int nbRunningThreads;
     PcoModel *model{nullptr};
 
+    /// Whether the waiting times are measured
+    bool timing{false};
+
+    /// Total time the threads waited for their turn
+    std::chrono::steady_clock::duration waitTime{0};
+
+    /// Time at which the ending status was set
+    std::chrono::steady_clock::time_point endTime{};
+
+    /// Number of failed checks of the invariants
+    size_t nbInvariantFailures{0};
+
+    ///
+    /// \brief Sets the ending status, and records the time if the timing is enabled
+    /// \param status The ending status
+    ///
+    void setEndingStatus(EndingStatus status);
+
     ///
     /// \brief Checks the invariants whenever startSection, endSection or endScenario is called
     ///
@@ -1,10 +1,120 @@
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <set>
+
 #include "pcomodel.h"
+#include "verbosity.h"
 
 
 ScenarioBuilderInterface* PcoModel::getScenarioBuilder() {
     return scenarioBuilder.get();
 }
 
+void PcoModel::setScenarioBuilder(std::unique_ptr<ScenarioBuilderInterface> builder) {
+    scenarioBuilder = std::move(builder);
+}
+
 const std::vector<std::unique_ptr<ObservableThread> >& PcoModel::getThreads() {
     return threads;
 }
+
+double PcoModel::coarsenScenarioGraphs(int depth)
+{
+    std::vector<ScenarioGraphNode *> nodes;
+    size_t nbSections = 0;
+    for (const auto &thread : threads) {
+        nodes.push_back(thread->getScenarioGraph()->getFirstNode());
+        nbSections += thread->getScenarioGraph()->nbNodes() - 1;
+    }
+    // Counted first, as the nodes are modified in place
+    size_t nbBefore = ScenarioGraph::nbScenarios(nodes, depth);
+
+    size_t nbRemoved = 0;
+    for (const auto &thread : threads) {
+        nbRemoved += thread->getScenarioGraph()->coarsen();
+    }
+    size_t nbAfter = ScenarioGraph::nbScenarios(nodes, depth);
+
+    double factor = static_cast<double>(nbBefore) / static_cast<double>(nbAfter);
+    if (Verbosity::isAtLeast(VerbosityLevel::Progress)) {
+        std::cout << "Coarsening : " << nbSections << " -> " << nbSections - nbRemoved << " sections, "
+                  << nbBefore << " -> " << nbAfter << " scenarios (reduction factor " << factor << ")" << std::endl;
+    }
+    return factor;
+}
+
+std::unique_ptr<ScenarioBuilderInterface> PcoModel::createScenarioBuilder()
+{
+    return std::make_unique<ScenarioBuilderBuffer>();
+}
+
+///
+/// \brief Collects the shared data and counters accessed by a thread
+/// \param node The node to start from
+/// \param visited The nodes already visited
+/// \param data The set of data names to fill
+/// \param counters The set of counter identifiers to fill
+///
+static void collectFootprint(ScenarioGraphNode *node, std::set<ScenarioGraphNode *> &visited,
+                             std::set<std::string> &data, std::set<int> &counters)
+{
+    if (!visited.insert(node).second) {
+        return;
+    }
+    data.insert(node->footprint.begin(), node->footprint.end());
+    for (const auto &effect : node->effects) {
+        counters.insert(effect.counter);
+    }
+    for (auto child : node->next) {
+        collectFootprint(child, visited, data, counters);
+    }
+}
+
+std::vector<std::vector<ObservableThread *> > PcoModel::getThreadGroups()
+{
+    std::vector<std::set<std::string> > data(threads.size());
+    std::vector<std::set<int> > counters(threads.size());
+    std::vector<ObservableThread *> all;
+    for (size_t i = 0; i < threads.size(); i++) {
+        all.push_back(threads[i].get());
+        std::set<ScenarioGraphNode *> visited;
+        collectFootprint(threads[i]->getScenarioGraph()->getFirstNode(), visited, data[i], counters[i]);
+        if (data[i].empty() && counters[i].empty()) {
+            // Nothing is known about this thread, so it may share anything
+            return {all};
+        }
+    }
+
+    // Union-find over the threads, merging the ones sharing a data or a counter
+    std::vector<size_t> parent(threads.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](size_t i) {
+        while (parent[i] != i) {
+            i = parent[i] = parent[parent[i]];
+        }
+        return i;
+    };
+    std::map<std::string, size_t> dataOwner;
+    std::map<int, size_t> counterOwner;
+    for (size_t i = 0; i < threads.size(); i++) {
+        for (const auto &name : data[i]) {
+            auto it = dataOwner.emplace(name, i).first;
+            parent[find(i)] = find(it->second);
+        }
+        for (int counter : counters[i]) {
+            auto it = counterOwner.emplace(counter, i).first;
+            parent[find(i)] = find(it->second);
+        }
+    }
+
+    std::map<size_t, std::vector<ObservableThread *> > groups;
+    for (size_t i = 0; i < threads.size(); i++) {
+        groups[find(i)].push_back(threads[i].get());
+    }
+    std::vector<std::vector<ObservableThread *> > result;
+    for (auto &group : groups) {
+        result.push_back(std::move(group.second));
+    }
+    return result;
+}
@@ -62,6 +62,19 @@ public:
     ///
     virtual void finalReport() {}
 
+    ///
+    /// \brief Gets the observation of the scenario that has just been run
+    /// \return A key identifying the outcome of the scenario, empty if nothing is observed
+    ///
+    /// This function is called by the model checker after postRun(). Two
+    /// scenarios with the same key have the same outcome, for instance the same
+    /// final value of a shared variable. The checker counts the distinct keys
+    /// and, if PcoModelChecker::setSaturation() has been called, stops the
+    /// exhaustive exploration once no new key shows up. By default it returns
+    /// an empty key, so there is no need to override it if not useful.
+    ///
+    virtual std::string getObservationKey() { return {}; }
+
     ///
     /// \brief Function to check invariants of the model.
     /// \return true if all invariants stand, false else.
@@ -71,6 +84,43 @@ public:
     ///
     virtual bool checkInvariants() {return true;}
 
+    ///
+    /// \brief Creates a new, uninitialized, scenario builder
+    /// \return The scenario builder
+    ///
+    /// This function is used by the model checker whenever it needs to build
+    /// scenarios itself, for instance for a group of threads. By default it
+    /// creates a ScenarioBuilderBuffer, it can be overriden to choose another
+    /// builder or to configure it, for instance with a SemaphoreFilter.
+    ///
+    virtual std::unique_ptr<ScenarioBuilderInterface> createScenarioBuilder();
+
+    ///
+    /// \brief Gets groups of threads that share no data
+    /// \return A vector of groups, each group being a vector of threads
+    ///
+    /// Interleavings between threads of different groups are irrelevant, so
+    /// the model checker can explore each group separately. By default the groups
+    /// are inferred from the footprint and the semaphore effects of the sections:
+    /// two threads are in the same group if they access a common data or counter.
+    /// If a thread has no such annotation, nothing can be inferred and all threads
+    /// are put in a single group. It can be overriden to declare the groups.
+    ///
+    virtual std::vector<std::vector<ObservableThread *> > getThreadGroups();
+
+    ///
+    /// \brief Coarsens the scenario graphs of all threads
+    /// \param depth The depth used to compare the number of scenarios
+    /// \return The reduction factor of the number of scenarios
+    ///
+    /// Calls ScenarioGraph::coarsen() on every thread graph, and prints the
+    /// number of sections and of scenarios before and after from the Progress
+    /// verbosity level. It shall be called
+    /// from build(), after the sections have been annotated as local and before
+    /// the scenario builder is initialized.
+    ///
+    double coarsenScenarioGraphs(int depth);
+
     ///
     /// \brief Returns a pointer to the scenario builder of the model
     /// \return A pointer to the scenario builder of the model.
@@ -79,6 +129,15 @@ public:
     ///
     ScenarioBuilderInterface* getScenarioBuilder();
 
+    ///
+    /// \brief Replaces the scenario builder of the model
+    /// \param builder The new builder, already initialized, or nullptr
+    ///
+    /// This function is used by the model checker when it changes the scenario
+    /// graphs after build(), as the previous builder may refer to them.
+    ///
+    void setScenarioBuilder(std::unique_ptr<ScenarioBuilderInterface> builder);
+
     ///
     /// \brief Gets the vector of observable threads of the model.
     /// \return The vector of observable threads.
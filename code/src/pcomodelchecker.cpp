@@ -1,91 +1,701 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "pcomodelchecker.h"
+#include "progressreporter.h"
+#include "recordinganalyzer.h"
+#include "scenariographrecorder.h"
+#include "verbosity.h"
 
 void PcoModelChecker::setModel(PcoModel *model) {
     this->model = model;
 }
 
+void PcoModelChecker::setDepth(int depth) {
+    this->depth = depth;
+}
+
+void PcoModelChecker::setCompositional(bool compositional) {
+    this->compositional = compositional;
+}
+
+void PcoModelChecker::setIterativeDeepening(int initialDepth, int maxDepth, size_t budget) {
+    iterativeDeepening = true;
+    this->initialDepth = initialDepth;
+    this->maxDepth = maxDepth;
+    this->budget = budget;
+}
+
+void PcoModelChecker::setRecording(int nbRuns, int jitter) {
+    nbRecordingRuns = nbRuns;
+    recordingJitter = jitter;
+}
+
+void PcoModelChecker::setStateSpaceExport(const std::string &fileName, StateSpaceWriter::Format format, size_t maxEdges) {
+    stateSpaceFileName = fileName;
+    stateSpaceFormat = format;
+    stateSpaceMaxEdges = maxEdges;
+}
+
+void PcoModelChecker::setSaturation(size_t window, SaturationMode mode, size_t nbSamples) {
+    saturationWindow = window;
+    saturationMode = mode;
+    nbSaturationSamples = nbSamples;
+}
+
+void PcoModelChecker::setMetrics(bool enabled) {
+    collectMetrics = enabled;
+}
+
+void PcoModelChecker::setTraceExport(const std::string &fileName,
+                                     std::function<bool(size_t, PcoConcurrencyAnalyzer::EndingStatus)> selector,
+                                     size_t maxScenarios) {
+    traceFileName = fileName;
+    traceSelector = std::move(selector);
+    maxTracedScenarios = maxScenarios;
+}
+
+void PcoModelChecker::setMetricsExport(const std::string &address) {
+    metricsAddress = address;
+}
+
+void PcoModelChecker::setResultStore(const std::string &fileName, bool withObservationKeys) {
+    resultStoreFileName = fileName;
+    storeObservationKeys = withObservationKeys;
+}
+
+void PcoModelChecker::setSectionProfiling(bool enabled, const std::string &foldedFileName) {
+    profileSections = enabled;
+    this->foldedFileName = foldedFileName;
+}
+
 
 void PcoModelChecker::run() {
 
+    AllocationAccounting::reset();
+
     // First build the model
-    model->build();
+    {
+        AllocationScope scope(AllocationSubsystem::Model);
+        model->build();
+    }
 
     // Creation of the watchdog and start of this watchdog
     AnalyzerWatchDog watchDog;
     PcoManager::getInstance()->setWatchDog(&watchDog);
     watchDog.run();
 
-    // Iterate over all the scenarios, using the scenariobuilder iterator
-    for (Scenario scenario = model->getScenarioBuilder()->getNext(); !scenario.empty();
-         scenario = model->getScenarioBuilder()->getNext()) {
-
-        // To be sure we start from scratch we create a new analyzer
-        auto analyzer = std::make_shared<PcoConcurrencyAnalyzer>();
+    if (nbRecordingRuns > 0) {
+        recordScenarioGraphs(watchDog);
+    }
 
-        watchDog.setConcurrencyAnalyzer(analyzer);
+    bool exportStateSpace = false;
+    if (!stateSpaceFileName.empty()) {
+        std::vector<ObservableThread *> threads;
+        for (auto & thread : model->getThreads())
+            threads.push_back(thread.get());
+        exportStateSpace = stateSpaceWriter.open(stateSpaceFileName, stateSpaceFormat, threads, stateSpaceMaxEdges);
+        if (!exportStateSpace) {
+            std::cout << "Could not open " << stateSpaceFileName << std::endl;
+        }
+    }
 
-        analyzer->setModel(model);
+    storeResults = false;
+    if (!resultStoreFileName.empty()) {
+        std::vector<ObservableThread *> threads;
+        for (auto & thread : model->getThreads())
+            threads.push_back(thread.get());
+        storeResults = resultWriter.open(resultStoreFileName, threads);
+        if (!storeResults) {
+            std::cout << "Could not open " << resultStoreFileName << std::endl;
+        }
+    }
 
-        analyzer->setScenario(scenario, model->getThreads().size());
-        // The following lines could be used if the scenario builder has a getRemainingScenariosNb() function,
-        // but this is currently not the case
-        //            if ((model->getScenarioBuilder()->getRemainingScenariosNb() % 100) == 0) {
-        //                std::cout << model->getScenarioBuilder()->getRemainingScenariosNb() << std::endl;
-        //            }
+    exportTrace = false;
+    if (!traceFileName.empty()) {
+        exportTrace = traceWriter.open(traceFileName);
+        if (!exportTrace) {
+            std::cout << "Could not open " << traceFileName << std::endl;
+        }
+        ObservableThread::setTracing(exportTrace && (maxTracedScenarios > 0));
+    }
 
-        // Allow the model to set things before starting
-        model->preRun(scenario);
+    if (!metricsAddress.empty()) {
+        if (metricsExporter.start(metricsAddress)) {
+            std::cout << "Metrics served on " << metricsAddress << std::endl;
+        }
+        else {
+            std::cout << "Could not serve the metrics on " << metricsAddress << std::endl;
+        }
+    }
+    nbPrunedBefore = 0;
 
-        // Set the analyzer of all threads
+    sectionProfiler.clear();
+    if (profileSections) {
         for (auto & thread : model->getThreads())
-            thread->setConcurrencyAnalyzer(analyzer.get());
+            thread->clearSectionCosts();
+        ObservableThread::setProfiling(true);
+    }
 
-        // Start the threads
-        for (auto & thread : model->getThreads())
-            thread->start();
+    groups.clear();
+    groupStatusCounters.clear();
+    samplingStatusCounter.clear();
+    nbDuplicateSamples = 0;
+    observations.clear();
+    nbObserved = 0;
+    lastNewObservation = 0;
+    saturationIndex = 0;
+    nbScenariosRun = 0;
+    nbPointsPlayed = 0;
+    metrics.clear();
+    auto start = std::chrono::steady_clock::now();
+    if (compositional) {
+        groups = model->getThreadGroups();
+    }
+
+    // Depth of the groups, 0 would generate them without bound
+    int groupDepth = (depth > 0) ? depth : model->getScenarioBuilder()->getDepth();
+    std::vector<std::unique_ptr<ScenarioBuilderInterface> > groupBuilders;
+    if ((groups.size() > 1) && (groupDepth <= 0)) {
+        std::cout << "The compositional exploration requires a depth, set by setDepth(), "
+                  << "the threads are explored together" << std::endl;
+        groups.clear();
+    }
+    else if (groups.size() > 1) {
+        for (const auto &group : groups) {
+            groupBuilders.push_back(model->createScenarioBuilder());
+            if (!groupBuilders.back()->initSubset(group, groupDepth)) {
+                std::cout << "The scenario builder of the model cannot explore a group, "
+                          << "the threads are explored together" << std::endl;
+                groups.clear();
+                groupBuilders.clear();
+                break;
+            }
+        }
+    }
 
-        // And join them
+    if (groups.size() > 1) {
+        if (iterativeDeepening) {
+            std::cout << "Iterative deepening is not supported by the compositional exploration, "
+                      << "the groups are explored at depth " << groupDepth << std::endl;
+        }
+        // Each group is explored on its own, with a dedicated builder
+        groupStatusCounters.resize(groups.size());
+        for (size_t i = 0; i < groups.size(); i++) {
+            runScenarios(groupBuilders[i].get(), groups[i], watchDog, groupStatusCounters[i]);
+        }
+    }
+    else {
+        std::vector<ObservableThread *> threads;
         for (auto & thread : model->getThreads())
-            thread->join();
+            threads.push_back(thread.get());
+        if (iterativeDeepening) {
+            runIterativeDeepening(threads, watchDog);
+        }
+        else {
+            bool saturated = runScenarios(model->getScenarioBuilder(), threads, watchDog, endingStatusCounter,
+                                          saturationWindow > 0);
+            if (saturated) {
+                saturationIndex = nbObserved;
+                if (saturationMode == SaturationMode::RandomSampling) {
+                    RandomScenarioBuilderIter sampler(nbSaturationSamples > 0 ? nbSaturationSamples : saturationWindow);
+                    sampler.setSemaphoreFilter(model->getScenarioBuilder()->getSemaphoreFilter());
+                    sampler.initSubset(threads, model->getScenarioBuilder()->getDepth());
+                    runScenarios(&sampler, threads, watchDog, samplingStatusCounter);
+                    nbDuplicateSamples = sampler.getNbDuplicates();
+                }
+            }
+        }
+    }
 
-        // Update the ending status map
-        endingStatusCounter[analyzer->getEndingStatus()]++;
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    runDuration = duration.count();
 
-        // Allow the model to do something at the end of the scenario
-        model->postRun(scenario);
+    // Stop the watchdog
+    watchDog.terminate();
+
+    metricsExporter.stop();
 
-        // TODO : Do this depending on a verbosity level
-        // printEndingStatus(analyzer->getEndingStatus());
+    if (exportStateSpace) {
+        stateSpaceWriter.finish();
+        std::cout << "State space : " << stateSpaceWriter.getNbStates() << " states, "
+                  << stateSpaceWriter.getNbEdges() << " edges written to " << stateSpaceFileName << std::endl;
+        if (stateSpaceWriter.getNbDroppedEdges() > 0) {
+            std::cout << "State space : " << stateSpaceWriter.getNbDroppedEdges() << " traversals of edges not written, "
+                      << "beyond the maximum of " << stateSpaceMaxEdges << " edges" << std::endl;
+        }
     }
 
-    // Stop the watchdog
-    watchDog.terminate();
+    if (storeResults) {
+        resultWriter.finish();
+        storeResults = false;
+        std::cout << "Results : " << resultWriter.getNbScenarios() << " scenarios written to " << resultStoreFileName
+                  << std::endl;
+    }
+
+    if (exportTrace) {
+        ObservableThread::setTracing(false);
+        traceWriter.finish();
+        std::cout << "Trace : " << traceWriter.getNbScenarios() << " scenarios written to " << traceFileName << std::endl;
+    }
 
     // Print statistics about the ending status of each scenario
-    printStats();
+    if (groups.size() > 1) {
+        printGroupStats();
+    }
+    else {
+        printStats();
+    }
+
+    if (!observations.empty()) {
+        printObservations();
+    }
+
+    if (collectMetrics) {
+        metrics.print();
+    }
+
+    if (profileSections) {
+        ObservableThread::setProfiling(false);
+        for (auto & thread : model->getThreads())
+            sectionProfiler.addThread(thread.get());
+        sectionProfiler.printHotSpots();
+        if (!foldedFileName.empty()) {
+            if (sectionProfiler.writeFoldedStacks(foldedFileName)) {
+                std::cout << "Folded stacks written to " << foldedFileName << std::endl;
+            }
+            else {
+                std::cout << "Could not write " << foldedFileName << std::endl;
+            }
+        }
+    }
 
     // Write the model final report
     model->finalReport();
 }
 
-void PcoModelChecker::printEndingStatus(PcoConcurrencyAnalyzer::EndingStatus endingStatus)
+ScenarioSpaceEstimate PcoModelChecker::estimate(size_t nbProbes, size_t nbCalibrationScenarios) {
+
+    model->build();
+
+    std::vector<ObservableThread *> threads;
+    std::vector<ScenarioGraphNode *> firstNodes;
+    for (auto & thread : model->getThreads()) {
+        threads.push_back(thread.get());
+        firstNodes.push_back(thread->getScenarioGraph()->getFirstNode());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ScenarioSpaceEstimator estimator(firstNodes);
+    ScenarioSpaceEstimate result = estimator.estimate(depth, nbProbes);
+    std::chrono::duration<double> probeDuration = std::chrono::steady_clock::now() - start;
+
+    // Calibration on the first scenarios of the model builder
+    AnalyzerWatchDog watchDog;
+    PcoManager::getInstance()->setWatchDog(&watchDog);
+    watchDog.run();
+    size_t nbRun = 0;
+    start = std::chrono::steady_clock::now();
+    auto builder = model->getScenarioBuilder();
+    for (Scenario scenario = builder->getNext(); !scenario.empty() && (nbRun < nbCalibrationScenarios);
+         scenario = builder->getNext()) {
+        runScenario(scenario, threads, watchDog);
+        nbRun++;
+    }
+    std::chrono::duration<double> calibrationDuration = std::chrono::steady_clock::now() - start;
+    watchDog.terminate();
+
+    if (nbRun > 0) {
+        result.secondsPerScenario = calibrationDuration.count() / static_cast<double>(nbRun);
+        result.eta = result.nbScenarios * result.secondsPerScenario;
+    }
+
+    std::cout << "Estimated scenarios : " << result.nbScenarios << " +/- " << result.standardError
+              << " (" << result.nbProbes << " probes in " << probeDuration.count() << " s)" << std::endl;
+    std::cout << "Calibration : " << nbRun << " scenarios, " << result.secondsPerScenario * 1000.0
+              << " ms per scenario" << std::endl;
+    std::cout << "Estimated run time : " << result.eta << " s" << std::endl;
+    return result;
+}
+
+bool PcoModelChecker::runScenarios(ScenarioBuilderInterface *builder, const std::vector<ObservableThread *> &threads,
+                                   AnalyzerWatchDog &watchDog, std::map<PcoConcurrencyAnalyzer::EndingStatus, int> &counter,
+                                   bool stopOnSaturation)
+{
+    bool showProgress = Verbosity::isAtLeast(VerbosityLevel::Progress);
+    bool showScenarios = Verbosity::isAtLeast(VerbosityLevel::Scenarios);
+    ProgressReporter progress;
+    if (showProgress) {
+        size_t total = builder->getRemainingScenariosNb();
+        bool estimated = false;
+        if ((total == 0) && (depth > 0)) {
+            // The builder does not know, a quick estimation is enough for an ETA
+            std::vector<ScenarioGraphNode *> firstNodes;
+            for (auto thread : threads)
+                if (thread->getScenarioGraph())
+                    firstNodes.push_back(thread->getScenarioGraph()->getFirstNode());
+            if (firstNodes.size() == threads.size()) {
+                total = static_cast<size_t>(ScenarioSpaceEstimator(firstNodes).estimate(depth, 1000).nbScenarios);
+                estimated = true;
+            }
+        }
+        progress.start(total, estimated);
+    }
+
+    // Iterate over all the scenarios, using the scenariobuilder iterator
+    size_t nbDone = 0;
+    bool saturated = false;
+    for (Scenario scenario = nextScenario(builder); !scenario.empty(); scenario = nextScenario(builder)) {
+
+        auto endingStatus = runScenario(scenario, threads, watchDog);
+        nbDone++;
+
+        // Update the ending status map
+        counter[endingStatus]++;
+
+        if (metricsExporter.isRunning()) {
+            publishBuilderState(builder, nbPrunedBefore);
+        }
+
+        if (showScenarios) {
+            printEndingStatus(endingStatus);
+        }
+        else if (showProgress) {
+            progress.update(nbDone);
+        }
+
+        if (groups.size() <= 1) {
+            observe();
+            if (stopOnSaturation && (nbObserved - lastNewObservation >= saturationWindow)) {
+                saturated = true;
+                break;
+            }
+        }
+    }
+    if (showProgress) {
+        progress.finish(nbDone);
+    }
+    nbPrunedBefore += builder->getNbPrunedSubtrees();
+    return saturated;
+}
+
+void PcoModelChecker::publishBuilderState(ScenarioBuilderInterface *builder, size_t nbPruned)
+{
+    metricsExporter.setBuilderState(builder->getNbQueuedScenarios(), builder->getRemainingScenariosNb(),
+                                    nbPruned + builder->getNbPrunedSubtrees());
+}
+
+void PcoModelChecker::observe()
+{
+    std::string key = model->getObservationKey();
+    if (key.empty()) {
+        return;
+    }
+    nbObserved++;
+    auto result = observations.emplace(key, Observation{nbObserved, 0});
+    result.first->second.count++;
+    if (result.second) {
+        lastNewObservation = nbObserved;
+    }
+}
+
+void PcoModelChecker::printObservations()
+{
+    std::cout << "Observations : " << observations.size() << " distinct outcomes in " << nbObserved
+              << " scenarios" << std::endl;
+    if (saturationIndex > 0) {
+        std::cout << "Saturated after " << saturationIndex << " scenarios (no new outcome in the last "
+                  << saturationWindow << ")" << std::endl;
+        if (nbObserved > saturationIndex) {
+            size_t nbNew = 0;
+            for (const auto &observation : observations) {
+                if (observation.second.firstIndex > saturationIndex) {
+                    nbNew++;
+                }
+            }
+            std::cout << "Random sampling : " << nbObserved - saturationIndex << " scenarios, " << nbNew
+                      << " new outcomes" << std::endl;
+        }
+    }
+    std::vector<std::pair<std::string, Observation> > sorted(observations.begin(), observations.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return a.second.firstIndex < b.second.firstIndex;
+    });
+    for (const auto &observation : sorted) {
+        std::cout << "Outcome " << observation.first << " : found at scenario " << observation.second.firstIndex
+                  << ", " << observation.second.count << " scenarios" << std::endl;
+    }
+}
+
+void PcoModelChecker::runIterativeDeepening(const std::vector<ObservableThread *> &threads, AnalyzerWatchDog &watchDog)
+{
+    terminatedPrefixes.clear();
+    recordTerminatedPrefixes = true;
+    size_t nbRun = 0;
+    for (int depth = initialDepth; depth <= maxDepth; depth++) {
+        auto builder = model->createScenarioBuilder();
+        builder->initSubset(threads, depth);
+
+        std::map<PcoConcurrencyAnalyzer::EndingStatus, int> levelCounter;
+        size_t nbSkipped = 0;
+        bool budgetReached = false;
+        for (Scenario scenario = nextScenario(builder.get()); !scenario.empty(); scenario = nextScenario(builder.get())) {
+            if (terminatedPrefixes.hasPrefixOf(scenario)) {
+                // Extension of a scenario that already ended at a shallower depth
+                nbSkipped++;
+                continue;
+            }
+            if ((budget != 0) && (nbRun == budget)) {
+                budgetReached = true;
+                break;
+            }
+            levelCounter[runScenario(scenario, threads, watchDog)]++;
+            nbRun++;
+            if (metricsExporter.isRunning()) {
+                publishBuilderState(builder.get(), nbPrunedBefore + nbSkipped);
+            }
+        }
+        nbPrunedBefore += nbSkipped + builder->getNbPrunedSubtrees();
+
+        std::cout << "Depth " << depth << " : " << nbSkipped << " scenarios skipped" << std::endl;
+        printStatusCounter(levelCounter);
+
+        // Each terminated prefix is counted once, at the level where it ended
+        for (const auto &status : levelCounter) {
+            if (status.first != PcoConcurrencyAnalyzer::EndingStatus::Depth) {
+                endingStatusCounter[status.first] += status.second;
+            }
+        }
+        int nbDepth = levelCounter[PcoConcurrencyAnalyzer::EndingStatus::Depth];
+        if (budgetReached || (nbDepth == 0) || (depth == maxDepth)) {
+            endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::Depth] += nbDepth;
+            if (budgetReached) {
+                std::cout << "Budget of " << budget << " scenarios reached" << std::endl;
+            }
+            break;
+        }
+    }
+    recordTerminatedPrefixes = false;
+}
+
+void PcoModelChecker::recordScenarioGraphs(AnalyzerWatchDog &watchDog)
+{
+    std::vector<ObservableThread *> threads;
+    for (auto & thread : model->getThreads())
+        threads.push_back(thread.get());
+
+    // The builder may refer to the current graphs, and without graph no
+    // section is skipped by the threads
+    model->setScenarioBuilder(nullptr);
+    for (auto thread : threads)
+        thread->setScenarioGraph(nullptr);
+
+    ScenarioGraphRecorder recorder;
+    std::map<PcoConcurrencyAnalyzer::EndingStatus, int> counter;
+    for (int run = 0; run < nbRecordingRuns; run++) {
+        auto analyzer = std::make_shared<RecordingAnalyzer>(recordingJitter, run);
+        watchDog.setConcurrencyAnalyzer(analyzer);
+        analyzer->setModel(model);
+        Scenario scenario;
+        analyzer->setScenario(scenario, threads.size());
+
+        model->preRun(scenario);
+        for (auto thread : threads)
+            thread->setConcurrencyAnalyzer(analyzer.get());
+        for (auto thread : threads)
+            thread->start();
+        for (auto thread : threads)
+            thread->join();
+        model->postRun(scenario);
+
+        for (auto thread : threads)
+            recorder.record(thread, analyzer->getSequence(thread));
+        counter[analyzer->getEndingStatus()]++;
+    }
+
+    int builderDepth = depth;
+    std::cout << "Recording : " << nbRecordingRuns << " free runs" << std::endl;
+    printStatusCounter(counter);
+    for (auto thread : threads) {
+        thread->setScenarioGraph(recorder.createGraph(thread));
+        std::cout << "Thread " << thread->getId() << " : " << recorder.getNbSections(thread) << " sections, "
+                  << recorder.getNbDistinctSequences(thread) << " distinct sequences" << std::endl;
+        if (depth == 0) {
+            builderDepth += static_cast<int>(recorder.getMaxLength(thread));
+        }
+    }
+
+    auto builder = model->createScenarioBuilder();
+    builder->init(model->getThreads(), builderDepth);
+    model->setScenarioBuilder(std::move(builder));
+}
+
+PcoConcurrencyAnalyzer::EndingStatus PcoModelChecker::runScenario(Scenario &scenario, const std::vector<ObservableThread *> &threads,
+                                                                  AnalyzerWatchDog &watchDog)
 {
-    switch (endingStatus) {
-    case PcoConcurrencyAnalyzer::EndingStatus::Unknown: std::cout << "End: Unknown" << std::endl;break;
-    case PcoConcurrencyAnalyzer::EndingStatus::Depth: std::cout << "End: Depth" << std::endl;break;
-    case PcoConcurrencyAnalyzer::EndingStatus::Deadlock: std::cout << "End: Deadlock" << std::endl;break;
-    case PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario: std::cout << "End: AllScenario" << std::endl;break;
-    case PcoConcurrencyAnalyzer::EndingStatus::DeadEnd: std::cout << "End: DeadEnd" << std::endl;break;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    // To be sure we start from scratch we create a new analyzer
+    std::shared_ptr<PcoConcurrencyAnalyzer> analyzer;
+    {
+        AllocationScope scope(AllocationSubsystem::Analyzer);
+        analyzer = std::make_shared<PcoConcurrencyAnalyzer>();
+        analyzer->setTiming(collectMetrics);
+
+        analyzer->setModel(model);
+
+        analyzer->setScenario(scenario, threads.size());
+    }
+
+    watchDog.setConcurrencyAnalyzer(analyzer);
+
+    // Allow the model to set things before starting
+    {
+        AllocationScope scope(AllocationSubsystem::Model);
+        model->preRun(scenario);
+    }
+
+    // Set the analyzer of all threads
+    for (auto thread : threads)
+        thread->setConcurrencyAnalyzer(analyzer.get());
+
+    if (exportTrace && (traceWriter.getNbScenarios() < maxTracedScenarios)) {
+        for (auto thread : threads)
+            thread->clearTraceEvents();
+    }
+
+    // Start the threads
+    auto startBegin = std::chrono::steady_clock::now();
+    for (auto thread : threads)
+        thread->start();
+    auto startEnd = std::chrono::steady_clock::now();
+
+    // And join them
+    for (auto thread : threads)
+        thread->join();
+    auto joined = std::chrono::steady_clock::now();
+
+    // Allow the model to do something at the end of the scenario
+    {
+        AllocationScope scope(AllocationSubsystem::Model);
+        model->postRun(scenario);
+    }
+
+    auto endingStatus = analyzer->getEndingStatus();
+    bool complete = (endingStatus == PcoConcurrencyAnalyzer::EndingStatus::Depth) ||
+                    (endingStatus == PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario);
+    size_t length = complete ? scenario.size() : std::min(analyzer->getIndex(), scenario.size());
+    nbScenariosRun++;
+    nbPointsPlayed += length;
+    if (metricsExporter.isRunning()) {
+        metricsExporter.addScenario(endingStatus, length, analyzer->getNbInvariantFailures());
     }
+    if (exportTrace && (traceWriter.getNbScenarios() < maxTracedScenarios) &&
+        (!traceSelector || traceSelector(nbScenariosRun, endingStatus))) {
+        traceWriter.addScenario(nbScenariosRun, scenario, threads, endingStatus);
+        if (traceWriter.getNbScenarios() == maxTracedScenarios) {
+            // No other scenario will be written, so the threads stop recording their events
+            ObservableThread::setTracing(false);
+        }
+    }
+    if (collectMetrics) {
+        auto nanoseconds = [](std::chrono::steady_clock::duration duration) {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        };
+        auto end = analyzer->getEndTime();
+        ScenarioTimings timings{nanoseconds(startEnd - startBegin), analyzer->getWaitNanoseconds(), length,
+                                (end.time_since_epoch().count() == 0) ? 0 : nanoseconds(joined - end),
+                                nanoseconds(std::chrono::steady_clock::now() - wallStart)};
+        metrics.record(endingStatus, timings);
+    }
+    if (!stateSpaceFileName.empty()) {
+        stateSpaceWriter.addScenario(scenario, length, endingStatus);
+    }
+    if (storeResults) {
+        uint8_t flags = (analyzer->getNbInvariantFailures() > 0) ? ResultFlag::InvariantFailure : 0;
+        resultWriter.add(nbScenariosRun, scenario, endingStatus, static_cast<uint32_t>(length), flags,
+                         storeObservationKeys ? model->getObservationKey() : std::string());
+    }
+    if (recordTerminatedPrefixes) {
+        switch (endingStatus) {
+        case PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario:
+            terminatedPrefixes.insert(scenario);
+            break;
+        case PcoConcurrencyAnalyzer::EndingStatus::Deadlock:
+        case PcoConcurrencyAnalyzer::EndingStatus::DeadEnd: {
+            // The point at the analyzer index is the one that could not be played
+            size_t prefixLength = std::min(analyzer->getIndex() + 1, scenario.size());
+            terminatedPrefixes.insert(Scenario(scenario.begin(), scenario.begin() + prefixLength));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    return endingStatus;
+}
+
+void PcoModelChecker::printEndingStatus(PcoConcurrencyAnalyzer::EndingStatus endingStatus)
+{
+    std::cout << "End: " << PcoConcurrencyAnalyzer::toString(endingStatus) << std::endl;
+}
+
+Scenario PcoModelChecker::nextScenario(ScenarioBuilderInterface *builder)
+{
+    AllocationScope scope(AllocationSubsystem::Builder);
+    return builder->getNext();
 }
 
 void PcoModelChecker::printStats()
 {
-    std::cout << "End : Unknown     : " <<  endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::Unknown] << std::endl;
-    std::cout << "End : Depth       : " <<  endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::Depth] << std::endl;
-    std::cout << "End : Deadlock    : " <<  endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::Deadlock] << std::endl;
-    std::cout << "End : AllScenario : " <<  endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario] << std::endl;
-    std::cout << "End : DeadEnd     : " <<  endingStatusCounter[PcoConcurrencyAnalyzer::EndingStatus::DeadEnd] << std::endl;
+    printStatusCounter(endingStatusCounter);
+    if (!samplingStatusCounter.empty()) {
+        // The sampled scenarios may have been played by the exhaustive exploration too
+        std::cout << "Random sampling, not counted above :" << std::endl;
+        printStatusCounter(samplingStatusCounter);
+        std::cout << "Repeated draws skipped : " << nbDuplicateSamples << std::endl;
+    }
+    AllocationAccounting::print();
+}
+
+void PcoModelChecker::printStatusCounter(std::map<PcoConcurrencyAnalyzer::EndingStatus, int> &counter)
+{
+    std::cout << "End : Unknown     : " <<  counter[PcoConcurrencyAnalyzer::EndingStatus::Unknown] << std::endl;
+    std::cout << "End : Depth       : " <<  counter[PcoConcurrencyAnalyzer::EndingStatus::Depth] << std::endl;
+    std::cout << "End : Deadlock    : " <<  counter[PcoConcurrencyAnalyzer::EndingStatus::Deadlock] << std::endl;
+    std::cout << "End : AllScenario : " <<  counter[PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario] << std::endl;
+    std::cout << "End : DeadEnd     : " <<  counter[PcoConcurrencyAnalyzer::EndingStatus::DeadEnd] << std::endl;
+}
+
+void PcoModelChecker::printGroupStats()
+{
+    // Products are computed as doubles, as they easily overflow
+    double total = 1;
+    double allScenario = 1;
+    double withoutDeadlock = 1;
+    double withoutDeadEnd = 1;
+    for (size_t i = 0; i < groups.size(); i++) {
+        auto &counter = groupStatusCounters[i];
+        std::cout << "Group " << i + 1 << " :";
+        for (auto thread : groups[i])
+            std::cout << " " << thread->getId();
+        std::cout << std::endl;
+        printStatusCounter(counter);
+
+        double nb = 0;
+        for (const auto &status : counter)
+            nb += status.second;
+        total *= nb;
+        allScenario *= counter[PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario];
+        withoutDeadlock *= nb - counter[PcoConcurrencyAnalyzer::EndingStatus::Deadlock];
+        withoutDeadEnd *= nb - counter[PcoConcurrencyAnalyzer::EndingStatus::DeadEnd];
+    }
+    std::cout << "Combined (product of " << groups.size() << " groups) :" << std::endl;
+    std::cout << "Scenarios         : " << total << std::endl;
+    std::cout << "End : AllScenario : " << allScenario << std::endl;
+    std::cout << "With Deadlock     : " << total - withoutDeadlock << std::endl;
+    std::cout << "With DeadEnd      : " << total - withoutDeadEnd << std::endl;
+    AllocationAccounting::print();
 }
@@ -2,9 +2,20 @@
 #define PCOMODELCHECKER_H
 
 
+#include <functional>
+
+#include "allocationaccounting.h"
 #include "analyzerwatchdog.h"
+#include "chrometracewriter.h"
+#include "metricsexporter.h"
 #include "pcoconcurrencyanalyzer.h"
 #include "pcomodel.h"
+#include "resultstore.h"
+#include "scenariometrics.h"
+#include "scenariospaceestimator.h"
+#include "scenariotrie.h"
+#include "sectionprofiler.h"
+#include "statespacewriter.h"
 
 ///
 /// \brief The PcoModelChecker class
@@ -13,6 +24,10 @@
 /// offered by the model. First it builds the model, the run the scenarios and checks
 /// for model invariants during the runs. At the end it displays statistics about the execution.
 ///
+/// What is printed during the runs depends on Verbosity: by default a
+/// ProgressReporter line with the number of scenarios done and the time left,
+/// and at the Scenarios level the ending status of every scenario.
+///
 /// Typical use:
 ///
 /// \code{cpp}
@@ -26,6 +41,16 @@ class PcoModelChecker
 {
 public:
 
+    ///
+    /// \brief What the checker does once the observations are saturated
+    ///
+    enum class SaturationMode {
+        /// Stop the exploration
+        Stop,
+        /// Stop the exhaustive exploration and play random scenarios
+        RandomSampling
+    };
+
     ///
     /// \brief Default constructor
     ///
@@ -42,9 +67,261 @@ public:
     ///
     void run();
 
+    ///
+    /// \brief Estimates the number of scenarios of the model and the time to run them
+    /// \param nbProbes The number of random probes of the ScenarioSpaceEstimator
+    /// \param nbCalibrationScenarios The number of scenarios of the model builder run to measure their cost
+    /// \return The estimation
+    ///
+    /// It is meant to be called instead of run(), to decide whether a run is
+    /// affordable. It builds the model, estimates the number of scenarios of
+    /// the thread graphs up to the depth set by setDepth(), runs the first
+    /// scenarios of the model builder, and prints the estimated number of
+    /// scenarios with its standard error and the estimated duration of a run.
+    ///
+    ScenarioSpaceEstimate estimate(size_t nbProbes = 10000, size_t nbCalibrationScenarios = 20);
+
+    ///
+    /// \brief Sets the depth of the scenarios built by the checker itself
+    /// \param depth The depth of the scenarios
+    ///
+    /// The scenarios of the model own builder do not depend on it. It is used
+    /// whenever the checker creates builders, for instance in compositional mode.
+    ///
+    void setDepth(int depth);
+
+    ///
+    /// \brief Enables the compositional exploration of independent thread groups
+    /// \param compositional true to explore each group separately
+    ///
+    /// The groups are given by PcoModel::getThreadGroups(). Each group is explored
+    /// on its own, with a builder created by PcoModel::createScenarioBuilder() and
+    /// only the threads of the group running, and the results are combined as a
+    /// product. For groups of sizes n1, n2, ... the checker runs n1 + n2 + ...
+    /// scenarios instead of n1 * n2 * ... times the interleavings between groups.
+    ///
+    /// The groups are explored at the depth set by setDepth(), or else at the
+    /// depth of the model own builder. Without any depth, or if the builder does
+    /// not support initSubset(), all the threads are explored together.
+    ///
+    void setCompositional(bool compositional);
+
+    ///
+    /// \brief Enables the iterative deepening exploration
+    /// \param initialDepth The depth of the first level
+    /// \param maxDepth The depth of the last level
+    /// \param budget The maximum number of scenarios to run, 0 for no limit
+    ///
+    /// Instead of the model own builder, the checker explores depth initialDepth,
+    /// then initialDepth + 1, and so on, with builders created by
+    /// PcoModel::createScenarioBuilder(). A scenario ending with EndAllScenario,
+    /// Deadlock or DeadEnd is not extended: the scenarios of the next levels
+    /// sharing the prefix played are skipped. The exploration stops when no
+    /// scenario ends with Depth, at maxDepth or when the budget is reached.
+    /// The statistics of each level are printed. It is not supported by the
+    /// compositional exploration, which then explores the groups at the depth
+    /// set by setDepth() and prints a warning.
+    ///
+    void setIterativeDeepening(int initialDepth, int maxDepth, size_t budget = 0);
+
+    ///
+    /// \brief Enables the inference of the scenario graphs from free runs
+    /// \param nbRuns The number of free runs, 0 to disable the inference
+    /// \param jitter The maximum random delay at the start of each section, in microseconds
+    ///
+    /// Before exploring the scenarios, the checker runs the threads of the model
+    /// nbRuns times with a RecordingAnalyzer, without scheduling them, and
+    /// replaces their scenario graphs by the ones inferred by a
+    /// ScenarioGraphRecorder. The model builder is then replaced by one created
+    /// by PcoModel::createScenarioBuilder(), with the depth set by setDepth(),
+    /// or the total length of the longest recorded sequences if it is 0.
+    /// The annotations of the previous graphs (effects, footprints, coarsening)
+    /// are not kept.
+    ///
+    void setRecording(int nbRuns, int jitter = 0);
+
+    ///
+    /// \brief Enables the export of the explored state space
+    /// \param fileName The name of the file, an empty name disables the export
+    /// \param format The format of the file
+    /// \param maxEdges The maximum number of edges kept and written
+    ///
+    /// Every scenario played is added to a StateSpaceWriter, with the points
+    /// actually played and its ending status. The edges dropped beyond
+    /// maxEdges are reported at the end of the run.
+    ///
+    void setStateSpaceExport(const std::string &fileName, StateSpaceWriter::Format format = StateSpaceWriter::Format::Dot,
+                             size_t maxEdges = StateSpaceWriter::defaultMaxEdges);
+
+    ///
+    /// \brief Enables the early stop once the observations are saturated
+    /// \param window The number of consecutive scenarios without new observation, 0 to disable
+    /// \param mode What to do once saturated
+    /// \param nbSamples The number of random scenarios played in RandomSampling mode, 0 for window
+    ///
+    /// The observations are given by PcoModel::getObservationKey(). When window
+    /// scenarios of the model builder in a row bring no new key, the exhaustive
+    /// exploration stops. In RandomSampling mode, nbSamples scenarios drawn by a
+    /// RandomScenarioBuilderIter, with the depth of the model builder, are played
+    /// next, to look for outcomes the order of the builder would reach late.
+    /// They are drawn with the SemaphoreFilter of the model builder, each one
+    /// at most once, and their ending status are printed apart from the ones
+    /// of the exhaustive exploration.
+    /// It applies to the model own builder, not to the compositional or iterative
+    /// deepening explorations. The number of scenarios needed to find each
+    /// outcome is printed at the end of the run.
+    ///
+    void setSaturation(size_t window, SaturationMode mode = SaturationMode::Stop, size_t nbSamples = 0);
+
+    ///
+    /// \brief Enables the collection of the timings of every scenario
+    /// \param enabled true to collect the timings
+    ///
+    /// The start cost, the waiting time in the analyzer, the number of
+    /// handoffs, the teardown time and the wall time of every scenario are
+    /// aggregated in a ScenarioMetrics, per ending status, and printed at the
+    /// end of the run. The cost is a few clock reads per scenario and per wait.
+    ///
+    void setMetrics(bool enabled);
+
+    /// Gets the metrics collected by the last call to run()
+    [[nodiscard]] const ScenarioMetrics &getMetrics() const { return metrics; }
+
+    ///
+    /// \brief Enables the export of a timeline of selected scenarios
+    /// \param fileName The name of the Chrome trace file, an empty name disables the export
+    /// \param selector Function telling from the index of a scenario, starting at 1, and its
+    ///        ending status whether to write it, nullptr to write every scenario
+    /// \param maxScenarios The maximum number of scenarios written
+    ///
+    /// During the run, every thread records its section events with
+    /// ObservableThread::setTracing(). After each scenario, the events of the
+    /// selected ones are written by a ChromeTraceWriter, so that the file can
+    /// be opened with Perfetto. For instance, to keep the DeadEnd scenarios:
+    ///
+    /// \code{cpp}
+    /// checker.setTraceExport("trace.json", [](size_t, PcoConcurrencyAnalyzer::EndingStatus status) {
+    ///     return status == PcoConcurrencyAnalyzer::EndingStatus::DeadEnd;
+    /// });
+    /// \endcode
+    ///
+    void setTraceExport(const std::string &fileName,
+                        std::function<bool(size_t, PcoConcurrencyAnalyzer::EndingStatus)> selector = nullptr,
+                        size_t maxScenarios = 100);
+
+    ///
+    /// \brief Enables the live export of the progress of the run
+    /// \param address A port number, served on 127.0.0.1, or "unix:" followed by the path
+    ///        of a socket, an empty address disables the export
+    ///
+    /// During run(), a MetricsExporter serves the number of scenarios by
+    /// ending status, the throughput, the state of the builder, the invariant
+    /// failures and the pruned subtrees in the Prometheus text format, at
+    /// http://localhost:port/metrics. The server stops at the end of the
+    /// exploration.
+    ///
+    void setMetricsExport(const std::string &address);
+
+    ///
+    /// \brief Enables the measure of the cost of each section
+    /// \param enabled true to measure the costs
+    /// \param foldedFileName The name of a folded stacks file to write, empty for none
+    ///
+    /// During the run, the threads measure the time spent in each of their
+    /// sections and waiting to start them, see ObservableThread::setProfiling().
+    /// At the end, a SectionProfiler prints the hot-spot table and writes the
+    /// folded stacks, for flame graph tools.
+    ///
+    void setSectionProfiling(bool enabled, const std::string &foldedFileName = "");
+
+    /// Gets the section costs measured by the last call to run()
+    [[nodiscard]] const SectionProfiler &getSectionProfiler() const { return sectionProfiler; }
+
+    ///
+    /// \brief Enables the storage of the result of every scenario
+    /// \param fileName The name of the result store file, an empty name disables the storage
+    /// \param withObservationKeys true to store the key given by PcoModel::getObservationKey()
+    ///
+    /// Every scenario played is added to a ResultStoreWriter, with its index,
+    /// its ending status, whether the invariants failed and its points, so
+    /// that the result_query tool can find, for instance, every Deadlock
+    /// starting with a given prefix and export them for replay by a
+    /// FileScenarioBuilderIter.
+    ///
+    void setResultStore(const std::string &fileName, bool withObservationKeys = false);
+
+    /// Gets the number of scenarios run by the last call to run()
+    [[nodiscard]] size_t getNbScenariosRun() const { return nbScenariosRun; }
+
+    /// Gets the number of scenario points played by the last call to run(), that is the number of handoffs
+    [[nodiscard]] size_t getNbPointsPlayed() const { return nbPointsPlayed; }
+
+    /// Gets the duration of the exploration of the last call to run(), in seconds, without build()
+    [[nodiscard]] double getRunDuration() const { return runDuration; }
+
 
 private:
 
+    ///
+    /// \brief Runs a single scenario
+    /// \param scenario The scenario to run
+    /// \param threads The threads taking part in the scenario
+    /// \param watchDog The running watchdog
+    /// \return The ending status of the scenario
+    ///
+    PcoConcurrencyAnalyzer::EndingStatus runScenario(Scenario &scenario, const std::vector<ObservableThread *> &threads,
+                                                     AnalyzerWatchDog &watchDog);
+
+    ///
+    /// \brief Gets the next scenario of a builder, its allocations being attributed to the builder
+    /// \param builder The builder
+    /// \return The scenario, empty if there is no more scenario
+    ///
+    static Scenario nextScenario(ScenarioBuilderInterface *builder);
+
+    ///
+    /// \brief Runs all the scenarios of a builder
+    /// \param builder The initialized scenario builder
+    /// \param threads The threads taking part in the scenarios
+    /// \param watchDog The running watchdog
+    /// \param counter The map in which the ending status are counted
+    /// \param stopOnSaturation true to stop once the observations are saturated
+    /// \return true if stopped because of the saturation
+    ///
+    bool runScenarios(ScenarioBuilderInterface *builder, const std::vector<ObservableThread *> &threads,
+                      AnalyzerWatchDog &watchDog, std::map<PcoConcurrencyAnalyzer::EndingStatus, int> &counter,
+                      bool stopOnSaturation = false);
+
+    ///
+    /// \brief Publishes the state of a builder to the metrics exporter
+    /// \param builder The builder
+    /// \param nbPruned The number of subtrees pruned outside of the builder
+    ///
+    void publishBuilderState(ScenarioBuilderInterface *builder, size_t nbPruned);
+
+    ///
+    /// \brief Runs the iterative deepening exploration
+    /// \param threads The threads taking part in the scenarios
+    /// \param watchDog The running watchdog
+    ///
+    void runIterativeDeepening(const std::vector<ObservableThread *> &threads, AnalyzerWatchDog &watchDog);
+
+    ///
+    /// \brief Infers the scenario graphs of the threads from free runs
+    /// \param watchDog The running watchdog
+    ///
+    void recordScenarioGraphs(AnalyzerWatchDog &watchDog);
+
+    ///
+    /// \brief Records the observation of the scenario that has just been run
+    ///
+    void observe();
+
+    ///
+    /// \brief Prints the number of scenarios needed to find each outcome
+    ///
+    void printObservations();
+
     ///
     /// \brief Prints an ending status
     /// \param endingStatus status to be printed
@@ -54,16 +331,178 @@ private:
     ///
     /// \brief Prints statistics about all the scenarios.
     ///
-    /// It dispays the number of scenarios observed for each ending status.
+    /// It dispays the number of scenarios observed for each ending status, the
+    /// peak resident set size and, if built with PCO_ALLOCATION_ACCOUNTING, the
+    /// allocations of each subsystem, see AllocationAccounting.
     ///
     void printStats();
 
+    ///
+    /// \brief Prints the number of scenarios observed for each ending status
+    /// \param counter The map storing the number of each ending status
+    ///
+    static void printStatusCounter(std::map<PcoConcurrencyAnalyzer::EndingStatus, int> &counter);
+
+    ///
+    /// \brief Prints statistics about each group and their combination.
+    ///
+    void printGroupStats();
+
     /// The PcoModel to be run.
     PcoModel *model{nullptr};
 
     /// A map storing the number of each ending status observed during the run.
     std::map<PcoConcurrencyAnalyzer::EndingStatus, int> endingStatusCounter;
 
+    /// The number of each ending status of the scenarios drawn once the observations are saturated
+    std::map<PcoConcurrencyAnalyzer::EndingStatus, int> samplingStatusCounter;
+
+    /// Number of draws skipped by the sampling, as already drawn
+    size_t nbDuplicateSamples{0};
+
+    /// Depth of the scenarios built by the checker
+    int depth{0};
+
+    /// Whether the thread groups are explored separately
+    bool compositional{false};
+
+    /// The thread groups explored in compositional mode
+    std::vector<std::vector<ObservableThread *> > groups;
+
+    /// The number of each ending status observed for each group
+    std::vector<std::map<PcoConcurrencyAnalyzer::EndingStatus, int> > groupStatusCounters;
+
+    /// Whether the iterative deepening exploration is used
+    bool iterativeDeepening{false};
+
+    /// Whether runScenario() records the terminated prefixes, during the iterative deepening only
+    bool recordTerminatedPrefixes{false};
+
+    /// Depth of the first iterative deepening level
+    int initialDepth{1};
+
+    /// Depth of the last iterative deepening level
+    int maxDepth{0};
+
+    /// Maximum number of scenarios run by the iterative deepening, 0 for no limit
+    size_t budget{0};
+
+    /// Number of free runs used to infer the scenario graphs
+    int nbRecordingRuns{0};
+
+    /// Maximum random delay at the start of each section of the free runs, in microseconds
+    int recordingJitter{0};
+
+    /// Name of the state space file, empty if not exported
+    std::string stateSpaceFileName;
+
+    /// Format of the state space file
+    StateSpaceWriter::Format stateSpaceFormat{StateSpaceWriter::Format::Dot};
+
+    /// Maximum number of edges of the state space file
+    size_t stateSpaceMaxEdges{StateSpaceWriter::defaultMaxEdges};
+
+    /// Writer of the explored state space
+    StateSpaceWriter stateSpaceWriter;
+
+    ///
+    /// \brief Observation of an outcome
+    ///
+    typedef struct {
+        /// Number of scenarios run when it was first observed, 1 for the first scenario
+        size_t firstIndex;
+        /// Number of scenarios having this outcome
+        size_t count;
+    } Observation;
+
+    /// The observations, by key
+    std::map<std::string, Observation> observations;
+
+    /// Number of scenarios observed
+    size_t nbObserved{0};
+
+    /// Number of scenarios observed when the last new key showed up
+    size_t lastNewObservation{0};
+
+    /// Number of scenarios observed when the exhaustive exploration stopped, 0 if it did not
+    size_t saturationIndex{0};
+
+    /// Name of the Chrome trace file, empty if not exported
+    std::string traceFileName;
+
+    /// Selection of the traced scenarios, nullptr for all
+    std::function<bool(size_t, PcoConcurrencyAnalyzer::EndingStatus)> traceSelector;
+
+    /// Maximum number of traced scenarios
+    size_t maxTracedScenarios{100};
+
+    /// Writer of the Chrome trace
+    ChromeTraceWriter traceWriter;
+
+    /// Whether the trace is being written
+    bool exportTrace{false};
+
+    /// Name of the result store file, empty if not stored
+    std::string resultStoreFileName;
+
+    /// Whether the observation keys are stored
+    bool storeObservationKeys{false};
+
+    /// Writer of the result store
+    ResultStoreWriter resultWriter;
+
+    /// Whether the results are being stored
+    bool storeResults{false};
+
+    /// Whether the cost of the sections is measured
+    bool profileSections{false};
+
+    /// Name of the folded stacks file, empty if not written
+    std::string foldedFileName;
+
+    /// The cost of the sections
+    SectionProfiler sectionProfiler;
+
+    /// Address of the metrics server, empty if not exported
+    std::string metricsAddress;
+
+    /// Server of the live metrics
+    MetricsExporter metricsExporter;
+
+    /// Number of subtrees pruned by the builders already run, for the metrics exporter
+    size_t nbPrunedBefore{0};
+
+    /// Whether the timings of the scenarios are collected
+    bool collectMetrics{false};
+
+    /// The timings of the scenarios
+    ScenarioMetrics metrics;
+
+    /// Number of scenarios run
+    size_t nbScenariosRun{0};
+
+    /// Number of scenario points played
+    size_t nbPointsPlayed{0};
+
+    /// Duration of the exploration, in seconds
+    double runDuration{0.0};
+
+    /// Number of consecutive scenarios without new observation stopping the exploration, 0 for no stop
+    size_t saturationWindow{0};
+
+    /// What to do once saturated
+    SaturationMode saturationMode{SaturationMode::Stop};
+
+    /// Number of random scenarios played in RandomSampling mode, 0 for saturationWindow
+    size_t nbSaturationSamples{0};
+
+    ///
+    /// \brief The played prefixes of the scenarios that did not end with Depth
+    ///
+    /// Filled by runScenario(), used by the iterative deepening to skip their extensions.
+    ///
+    ScenarioTrie terminatedPrefixes;
+
 };
 
 
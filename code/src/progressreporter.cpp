@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "progressreporter.h"
+
+
+ProgressReporter::ProgressReporter(double interval) :
+    interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval)))
+{
+}
+
+void ProgressReporter::start(size_t total, bool estimated)
+{
+    this->total = total;
+    this->estimated = estimated;
+    inPlace = isatty(STDOUT_FILENO) != 0;
+    lastLength = 0;
+    startTime = std::chrono::steady_clock::now();
+    nextUpdate = startTime + interval;
+}
+
+void ProgressReporter::update(size_t done)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now < nextUpdate) {
+        return;
+    }
+    nextUpdate = now + interval;
+    std::string line = format(done, std::chrono::duration<double>(now - startTime).count());
+    if (inPlace) {
+        size_t length = line.size();
+        if (length < lastLength) {
+            line.append(lastLength - length, ' ');
+        }
+        lastLength = length;
+        std::cout << '\r' << line << std::flush;
+    }
+    else {
+        std::cout << line << std::endl;
+    }
+}
+
+void ProgressReporter::finish(size_t done)
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    char rate[32];
+    std::snprintf(rate, sizeof(rate), "%.1f", (seconds > 0.0) ? static_cast<double>(done) / seconds : 0.0);
+    std::string line = "Scenarios : " + std::to_string(done) + " in " + formatDuration(seconds) + " | " + rate + " /s";
+    if (inPlace) {
+        if (line.size() < lastLength) {
+            line.append(lastLength - line.size(), ' ');
+        }
+        std::cout << '\r';
+    }
+    std::cout << line << std::endl;
+    lastLength = 0;
+}
+
+std::string ProgressReporter::format(size_t done, double seconds) const
+{
+    double rate = (seconds > 0.0) ? static_cast<double>(done) / seconds : 0.0;
+    char buffer[64];
+    std::string line = "Scenarios : " + std::to_string(done);
+    if (total > 0) {
+        std::snprintf(buffer, sizeof(buffer), " / %s%zu (%.1f %%)", estimated ? "~" : "", total,
+                      100.0 * static_cast<double>(done) / static_cast<double>(total));
+        line += buffer;
+    }
+    std::snprintf(buffer, sizeof(buffer), " | %.1f /s", rate);
+    line += buffer;
+    if (total > 0) {
+        // An estimated total may be exceeded, the time left is then unknown
+        line += " | ETA ";
+        line += ((done < total) && (rate > 0.0)) ? formatDuration(static_cast<double>(total - done) / rate) : "--";
+    }
+    return line;
+}
+
+std::string ProgressReporter::formatDuration(double seconds)
+{
+    auto s = static_cast<unsigned long long>(seconds + 0.5);
+    char buffer[32];
+    if (s >= 3600) {
+        std::snprintf(buffer, sizeof(buffer), "%llu:%02llu:%02llu", s / 3600, (s / 60) % 60, s % 60);
+    }
+    else {
+        std::snprintf(buffer, sizeof(buffer), "%llu:%02llu", s / 60, s % 60);
+    }
+    return buffer;
+}
@@ -0,0 +1,103 @@
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+///
+/// \brief The ProgressReporter class
+///
+/// Prints a single progress line of a run, at most once per interval,
+/// whatever the number of scenarios: the number of scenarios done, the
+/// number expected if known, the rate in scenarios per second and the
+/// estimated time left. On a terminal the line is rewritten in place, else a
+/// new line is printed at each update.
+///
+/// The expected number of scenarios is either exact, given by
+/// ScenarioBuilderInterface::getMaxScenariosNb(), or estimated, for instance by
+/// a ScenarioSpaceEstimator, in which case it is prefixed by a '~'.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ProgressReporter progress;
+/// progress.start(builder->getMaxScenariosNb());
+/// for (...) {
+///     // Run a scenario
+///     progress.update(nbDone);
+/// }
+/// progress.finish(nbDone);
+/// \endcode
+///
+class ProgressReporter
+{
+public:
+
+    ///
+    /// \brief ProgressReporter constructor
+    /// \param interval The minimum time between two updates of the line, in seconds
+    ///
+    explicit ProgressReporter(double interval = 1.0);
+
+    ///
+    /// \brief Starts the timing of the run
+    /// \param total The number of scenarios expected, 0 if unknown
+    /// \param estimated true if total is an estimation
+    ///
+    void start(size_t total, bool estimated = false);
+
+    ///
+    /// \brief Reports the number of scenarios done, and prints the line if the interval elapsed
+    /// \param done The number of scenarios done since start()
+    ///
+    /// It only reads the clock when nothing has to be printed.
+    ///
+    void update(size_t done);
+
+    ///
+    /// \brief Prints the final line, with the total duration
+    /// \param done The number of scenarios done since start()
+    ///
+    void finish(size_t done);
+
+private:
+
+    ///
+    /// \brief Builds the progress line
+    /// \param done The number of scenarios done
+    /// \param seconds The time since start()
+    /// \return The line, without end of line
+    ///
+    [[nodiscard]] std::string format(size_t done, double seconds) const;
+
+    ///
+    /// \brief Formats a duration as h:mm:ss or m:ss
+    /// \param seconds The duration
+    /// \return The formatted duration
+    ///
+    static std::string formatDuration(double seconds);
+
+    /// Minimum time between two updates
+    std::chrono::steady_clock::duration interval;
+
+    /// Start of the run
+    std::chrono::steady_clock::time_point startTime;
+
+    /// Time of the next update
+    std::chrono::steady_clock::time_point nextUpdate;
+
+    /// Number of scenarios expected, 0 if unknown
+    size_t total{0};
+
+    /// Whether total is an estimation
+    bool estimated{false};
+
+    /// Whether the output is a terminal, the line being then rewritten in place
+    bool inPlace{false};
+
+    /// Length of the last line printed in place, to erase its end
+    size_t lastLength{0};
+};
+
+#endif // PROGRESSREPORTER_H
@@ -0,0 +1,66 @@
+#include "pcosynchro/pcomanager.h"
+
+#include "recordinganalyzer.h"
+
+
+RecordingAnalyzer::RecordingAnalyzer(int jitter, unsigned int seed) :
+    jitter(jitter), generator(seed)
+{
+}
+
+void RecordingAnalyzer::startSection(ObservableThread *thread, int sectionNumber)
+{
+    int delay = 0;
+    {
+        std::lock_guard lock(mutex);
+        if (aborting) {
+            nbRunningThreads--;
+            PcoThread::exitThread();
+            return;
+        }
+        sequences[thread].push_back(sectionNumber);
+        if (jitter > 0) {
+            delay = std::uniform_int_distribution<int>(0, jitter - 1)(generator);
+        }
+    }
+    if (delay > 0) {
+        PcoThread::usleep(delay);
+    }
+}
+
+void RecordingAnalyzer::endSection(ObservableThread */*thread*/)
+{
+    // Nothing to record, the next section is recorded by startSection()
+}
+
+void RecordingAnalyzer::endScenario(ObservableThread */*thread*/)
+{
+    std::lock_guard lock(mutex);
+    nbRunningThreads--;
+    if ((!aborting) && (nbRunningThreads == 0)) {
+        endingStatus = EndingStatus::EndAllScenario;
+    }
+}
+
+void RecordingAnalyzer::checkedBlocked(int /*nbBlocked*/)
+{
+    std::lock_guard lock(mutex);
+    if ((!aborting) && (endingStatus == EndingStatus::Unknown)) {
+        if ((PcoManager::getInstance()->nbBlockedThreads() == nbRunningThreads) && (nbRunningThreads != 0)) {
+            // Releases the blocked threads, the run can not go further
+            endingStatus = EndingStatus::Deadlock;
+            PcoManager::getInstance()->setFreeMode();
+            aborting = true;
+        }
+    }
+}
+
+std::vector<int> RecordingAnalyzer::getSequence(const ObservableThread *thread)
+{
+    std::lock_guard lock(mutex);
+    auto it = sequences.find(thread);
+    if (it == sequences.end()) {
+        return {};
+    }
+    return it->second;
+}
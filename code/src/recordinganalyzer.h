@@ -0,0 +1,70 @@
+#ifndef RECORDINGANALYZER_H
+#define RECORDINGANALYZER_H
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief The RecordingAnalyzer class
+///
+/// Analyzer that does not schedule the threads: they run freely, in the
+/// order chosen by the operating system, and the analyzer only records the
+/// sections each thread starts. A random delay can be added at the start of
+/// each section to diversify the interleavings of successive runs.
+///
+/// The run ends with EndAllScenario when all the threads end, or with
+/// Deadlock when all the running threads are blocked on synchronization
+/// primitives. The sequences recorded until then are kept.
+///
+/// Typical use, with a running AnalyzerWatchDog:
+///
+/// \code{cpp}
+/// auto analyzer = std::make_shared<RecordingAnalyzer>(100, run);
+/// watchDog.setConcurrencyAnalyzer(analyzer);
+/// analyzer->setScenario({}, threads.size());
+/// // set the analyzer of the threads, start and join them
+/// recorder.record(thread, analyzer->getSequence(thread));
+/// \endcode
+///
+class RecordingAnalyzer : public PcoConcurrencyAnalyzer
+{
+public:
+
+    ///
+    /// \brief RecordingAnalyzer constructor
+    /// \param jitter The maximum delay added at the start of each section, in microseconds, 0 for none
+    /// \param seed The seed of the random delays
+    ///
+    explicit RecordingAnalyzer(int jitter = 0, unsigned int seed = 0);
+
+    void startSection(ObservableThread *thread, int sectionNumber) override;
+
+    void endSection(ObservableThread *thread) override;
+
+    void endScenario(ObservableThread *thread) override;
+
+    void checkedBlocked(int nbBlocked) override;
+
+    ///
+    /// \brief Gets the sections started by a thread
+    /// \param thread The thread
+    /// \return The section numbers, in the order they were started
+    ///
+    std::vector<int> getSequence(const ObservableThread *thread);
+
+private:
+
+    /// The sections started by each thread
+    std::map<const ObservableThread *, std::vector<int> > sequences;
+
+    /// The maximum delay at the start of a section, in microseconds
+    int jitter;
+
+    /// The generator of the delays
+    std::mt19937 generator;
+};
+
+#endif // RECORDINGANALYZER_H
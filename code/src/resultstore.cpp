@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "resultstore.h"
+
+
+///
+/// \brief Offsets of the columns of a chunk, from the start of its header
+///
+typedef struct {
+    size_t indexes;
+    size_t played;
+    size_t pointsEnds;
+    size_t keysEnds;
+    size_t statuses;
+    size_t flags;
+    size_t points;
+    size_t keys;
+    size_t size;
+} ChunkLayout;
+
+///
+/// \brief Computes the layout of a chunk
+/// \param nbRows The number of scenarios
+/// \param nbPoints The number of points
+/// \param keysSize The number of characters of the keys
+/// \return The layout
+///
+static ChunkLayout chunkLayout(uint64_t nbRows, uint64_t nbPoints, uint64_t keysSize)
+{
+    ChunkLayout layout{};
+    layout.indexes = sizeof(ResultChunkHeader);
+    layout.played = layout.indexes + nbRows * sizeof(uint64_t);
+    layout.pointsEnds = layout.played + nbRows * sizeof(uint32_t);
+    layout.keysEnds = layout.pointsEnds + nbRows * sizeof(uint32_t);
+    layout.statuses = layout.keysEnds + nbRows * sizeof(uint32_t);
+    layout.flags = layout.statuses + nbRows;
+    layout.points = (layout.flags + nbRows + 3) & ~static_cast<size_t>(3);
+    layout.keys = layout.points + nbPoints * sizeof(ScenarioFilePoint);
+    layout.size = (layout.keys + keysSize + 7) & ~static_cast<size_t>(7);
+    return layout;
+}
+
+
+bool ResultStoreWriter::open(const std::string &fileName, const std::vector<ObservableThread *> &threads, uint32_t chunkRows)
+{
+    this->threads = threads;
+    this->chunkRows = std::max<uint32_t>(chunkRows, 1);
+    nbWritten = 0;
+    nbChunks = 0;
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    ResultStoreHeader header{};
+    std::memcpy(header.magic, resultStoreMagic, sizeof(header.magic));
+    header.version = resultStoreVersion;
+    header.nbThreads = static_cast<uint32_t>(threads.size());
+    uint64_t offset = sizeof(ResultStoreHeader);
+    for (auto thread : threads) {
+        offset += sizeof(uint16_t) + thread->getId().size();
+    }
+    header.chunksOffset = (offset + 7) & ~static_cast<uint64_t>(7);
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (auto thread : threads) {
+        const std::string &id = thread->getId();
+        auto length = static_cast<uint16_t>(id.size());
+        file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        file.write(id.data(), length);
+    }
+    const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    file.write(padding, static_cast<std::streamsize>(header.chunksOffset - offset));
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+void ResultStoreWriter::add(uint64_t index, const Scenario &scenario, PcoConcurrencyAnalyzer::EndingStatus status,
+                            uint32_t nbPlayed, uint8_t flags, const std::string &key)
+{
+    if (!file.is_open()) {
+        return;
+    }
+    for (const auto &point : scenario) {
+        uint16_t thread = 0;
+        while ((thread < threads.size()) && (threads[thread] != point.thread)) {
+            thread++;
+        }
+        if (thread < threads.size()) {
+            points.push_back(ScenarioFilePoint{thread, 0, point.number});
+        }
+    }
+    keys += key;
+    indexes.push_back(index);
+    played.push_back(nbPlayed);
+    pointsEnds.push_back(static_cast<uint32_t>(points.size()));
+    keysEnds.push_back(static_cast<uint32_t>(keys.size()));
+    statuses.push_back(static_cast<uint8_t>(status));
+    this->flags.push_back(flags);
+    if (indexes.size() == chunkRows) {
+        flush();
+    }
+}
+
+void ResultStoreWriter::flush()
+{
+    if (indexes.empty()) {
+        return;
+    }
+    ChunkLayout layout = chunkLayout(indexes.size(), points.size(), keys.size());
+    std::vector<char> chunk(layout.size, 0);
+    ResultChunkHeader header{static_cast<uint32_t>(indexes.size()), 0, points.size(), keys.size(), layout.size};
+    std::memcpy(chunk.data(), &header, sizeof(header));
+    std::memcpy(chunk.data() + layout.indexes, indexes.data(), indexes.size() * sizeof(uint64_t));
+    std::memcpy(chunk.data() + layout.played, played.data(), played.size() * sizeof(uint32_t));
+    std::memcpy(chunk.data() + layout.pointsEnds, pointsEnds.data(), pointsEnds.size() * sizeof(uint32_t));
+    std::memcpy(chunk.data() + layout.keysEnds, keysEnds.data(), keysEnds.size() * sizeof(uint32_t));
+    std::memcpy(chunk.data() + layout.statuses, statuses.data(), statuses.size());
+    std::memcpy(chunk.data() + layout.flags, flags.data(), flags.size());
+    std::memcpy(chunk.data() + layout.points, points.data(), points.size() * sizeof(ScenarioFilePoint));
+    std::memcpy(chunk.data() + layout.keys, keys.data(), keys.size());
+    file.seekp(0, std::ios::end);
+    file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+
+    nbWritten += indexes.size();
+    nbChunks++;
+    // The header is only updated once the chunk is complete
+    file.flush();
+    file.seekp(offsetof(ResultStoreHeader, nbScenarios));
+    file.write(reinterpret_cast<const char *>(&nbWritten), sizeof(nbWritten));
+    file.write(reinterpret_cast<const char *>(&nbChunks), sizeof(nbChunks));
+    file.flush();
+
+    indexes.clear();
+    played.clear();
+    pointsEnds.clear();
+    keysEnds.clear();
+    statuses.clear();
+    flags.clear();
+    points.clear();
+    keys.clear();
+}
+
+void ResultStoreWriter::finish()
+{
+    if (!file.is_open()) {
+        return;
+    }
+    flush();
+    file.close();
+}
+
+
+ResultStoreReader::~ResultStoreReader()
+{
+    close();
+}
+
+void ResultStoreReader::close()
+{
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+        data = nullptr;
+    }
+    size = 0;
+    threadIds.clear();
+    chunks.clear();
+    nbScenarios = 0;
+}
+
+bool ResultStoreReader::open(const std::string &fileName)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status{};
+    if ((fstat(fd, &status) != 0) || (static_cast<size_t>(status.st_size) < sizeof(ResultStoreHeader))) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const char *>(mapped);
+
+    ResultStoreHeader header{};
+    std::memcpy(&header, data, sizeof(header));
+    if ((std::memcmp(header.magic, resultStoreMagic, sizeof(header.magic)) != 0) ||
+        (header.version != resultStoreVersion) || (header.chunksOffset > size)) {
+        close();
+        return false;
+    }
+    size_t position = sizeof(ResultStoreHeader);
+    for (uint32_t t = 0; t < header.nbThreads; t++) {
+        uint16_t length = 0;
+        if (position + sizeof(length) > header.chunksOffset) {
+            close();
+            return false;
+        }
+        std::memcpy(&length, data + position, sizeof(length));
+        position += sizeof(length);
+        if (position + length > header.chunksOffset) {
+            close();
+            return false;
+        }
+        threadIds.emplace_back(data + position, length);
+        position += length;
+    }
+
+    position = header.chunksOffset;
+    for (uint64_t c = 0; c < header.nbChunks; c++) {
+        ResultChunkHeader chunkHeader{};
+        if (position + sizeof(chunkHeader) > size) {
+            break;
+        }
+        std::memcpy(&chunkHeader, data + position, sizeof(chunkHeader));
+        ChunkLayout layout = chunkLayout(chunkHeader.nbRows, chunkHeader.nbPoints, chunkHeader.keysSize);
+        if ((layout.size != chunkHeader.size) || (position + layout.size > size)) {
+            // Truncated or corrupted chunk
+            break;
+        }
+        const char *base = data + position;
+        chunks.push_back(Chunk{nbScenarios, chunkHeader.nbRows,
+                               reinterpret_cast<const uint64_t *>(base + layout.indexes),
+                               reinterpret_cast<const uint32_t *>(base + layout.played),
+                               reinterpret_cast<const uint32_t *>(base + layout.pointsEnds),
+                               reinterpret_cast<const uint32_t *>(base + layout.keysEnds),
+                               reinterpret_cast<const uint8_t *>(base + layout.statuses),
+                               reinterpret_cast<const uint8_t *>(base + layout.flags),
+                               reinterpret_cast<const ScenarioFilePoint *>(base + layout.points), base + layout.keys});
+        nbScenarios += chunkHeader.nbRows;
+        position += layout.size;
+    }
+    return true;
+}
+
+std::vector<uint64_t> ResultStoreReader::select(int status, uint8_t flagsMask) const
+{
+    std::vector<uint64_t> result;
+    for (const auto &chunk : chunks) {
+        for (uint32_t i = 0; i < chunk.nbRows; i++) {
+            if (((status < 0) || (chunk.statuses[i] == status)) && ((chunk.flags[i] & flagsMask) == flagsMask)) {
+                result.push_back(chunk.firstRow + i);
+            }
+        }
+    }
+    return result;
+}
+
+ResultRow ResultStoreReader::getRow(uint64_t row) const
+{
+    auto it = std::upper_bound(chunks.begin(), chunks.end(), row, [](uint64_t r, const Chunk &chunk) {
+        return r < chunk.firstRow;
+    });
+    const Chunk &chunk = *(it - 1);
+    auto i = static_cast<uint32_t>(row - chunk.firstRow);
+    uint32_t pointsBegin = (i == 0) ? 0 : chunk.pointsEnds[i - 1];
+    uint32_t keysBegin = (i == 0) ? 0 : chunk.keysEnds[i - 1];
+    return ResultRow{chunk.indexes[i], chunk.statuses[i], chunk.flags[i], chunk.played[i], chunk.points + pointsBegin,
+                     chunk.pointsEnds[i] - pointsBegin, chunk.keys + keysBegin, chunk.keysEnds[i] - keysBegin};
+}
@@ -0,0 +1,288 @@
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pcoconcurrencyanalyzer.h"
+#include "scenariofile.h"
+
+///
+/// \brief Header of a result store file
+///
+/// A result store file is made of, in native byte order:
+///
+/// - this header;
+/// - the thread table, as in a scenario file: for each thread, the length of
+///   its id on 16 bits and the characters of the id;
+/// - padding up to chunksOffset, a multiple of 8;
+/// - the chunks, each one starting with a ResultChunkHeader.
+///
+/// The header is updated after each chunk, so that a file can be read while
+/// the run still writes it.
+///
+typedef struct {
+    /// "PCORSLT" and a null character
+    char magic[8];
+    /// Version of the format
+    uint32_t version;
+    /// Number of threads in the thread table
+    uint32_t nbThreads;
+    /// Number of scenarios of the chunks written
+    uint64_t nbScenarios;
+    /// Number of chunks written
+    uint64_t nbChunks;
+    /// Offset of the first chunk from the start of the file
+    uint64_t chunksOffset;
+} ResultStoreHeader;
+
+///
+/// \brief Header of a chunk of a result store file
+///
+/// It is followed by the columns of its nbRows scenarios, each one stored
+/// contiguously, so that a filter only reads the columns it needs:
+///
+/// - index: uint64_t, the index of the scenario in the run, starting at 1;
+/// - played: uint32_t, the number of points played;
+/// - pointsEnd: uint32_t, the end of the points of the scenario in the points column;
+/// - keysEnd: uint32_t, the end of the observation key of the scenario in the keys column;
+/// - status: uint8_t, the PcoConcurrencyAnalyzer::EndingStatus;
+/// - flags: uint8_t, a combination of ResultFlag;
+/// - padding to a multiple of 4;
+/// - points: nbPoints ScenarioFilePoint, all the points of the scenarios;
+/// - keys: keysSize characters;
+/// - padding to a multiple of 8.
+///
+typedef struct {
+    /// Number of scenarios of the chunk
+    uint32_t nbRows;
+    /// Unused, 0
+    uint32_t reserved;
+    /// Number of points of the points column
+    uint64_t nbPoints;
+    /// Number of characters of the keys column
+    uint64_t keysSize;
+    /// Size of the chunk, header included
+    uint64_t size;
+} ResultChunkHeader;
+
+///
+/// \brief The flags of a scenario in a result store
+///
+enum ResultFlag : uint8_t {
+    /// The invariants of the model did not stand at least once
+    InvariantFailure = 1
+};
+
+/// Magic string of the result store files
+constexpr char resultStoreMagic[8] = "PCORSLT";
+
+/// Current version of the result store format
+constexpr uint32_t resultStoreVersion = 1;
+
+///
+/// \brief The ResultStoreWriter class
+///
+/// Writes the result of every scenario of a run to a result store file: its
+/// index, its ending status, its flags, its optional observation key and
+/// its points, so that the scenarios having a given result can be found and
+/// replayed without running the model again. The results are gathered in
+/// chunks of columns, appended to the file when full.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ResultStoreWriter writer;
+/// writer.open("results.pcor", threads);
+/// writer.add(index, scenario, status, nbPlayed, flags);
+/// writer.finish();
+/// \endcode
+///
+class ResultStoreWriter
+{
+public:
+
+    ///
+    /// \brief Creates the file and writes the thread table
+    /// \param fileName The name of the file
+    /// \param threads The threads the scenarios may refer to
+    /// \param chunkRows The number of scenarios of a chunk
+    /// \return true if the file could be created, false else
+    ///
+    bool open(const std::string &fileName, const std::vector<ObservableThread *> &threads, uint32_t chunkRows = 4096);
+
+    ///
+    /// \brief Adds the result of a scenario
+    /// \param index The index of the scenario in the run
+    /// \param scenario The scenario
+    /// \param status Its ending status
+    /// \param nbPlayed The number of points played
+    /// \param flags A combination of ResultFlag
+    /// \param key The observation key, empty if none
+    ///
+    /// The points referring to a thread not given to open() are dropped.
+    ///
+    void add(uint64_t index, const Scenario &scenario, PcoConcurrencyAnalyzer::EndingStatus status, uint32_t nbPlayed,
+             uint8_t flags, const std::string &key = "");
+
+    ///
+    /// \brief Writes the last chunk and closes the file
+    ///
+    void finish();
+
+    /// Gets the number of scenarios added
+    [[nodiscard]] uint64_t getNbScenarios() const { return nbWritten + indexes.size(); }
+
+private:
+
+    ///
+    /// \brief Appends the pending chunk to the file and updates the header
+    ///
+    void flush();
+
+    /// The file
+    std::ofstream file;
+
+    /// The threads, in the order of the table
+    std::vector<ObservableThread *> threads;
+
+    /// Number of scenarios of a chunk
+    uint32_t chunkRows{4096};
+
+    /// Number of scenarios of the chunks written
+    uint64_t nbWritten{0};
+
+    /// Number of chunks written
+    uint64_t nbChunks{0};
+
+    /// The columns of the pending chunk
+    std::vector<uint64_t> indexes;
+    std::vector<uint32_t> played;
+    std::vector<uint32_t> pointsEnds;
+    std::vector<uint32_t> keysEnds;
+    std::vector<uint8_t> statuses;
+    std::vector<uint8_t> flags;
+    std::vector<ScenarioFilePoint> points;
+    std::string keys;
+};
+
+///
+/// \brief The result of a scenario read from a result store
+///
+/// The pointers refer to the mapped file.
+///
+typedef struct {
+    /// Index of the scenario in the run
+    uint64_t index;
+    /// Ending status, a PcoConcurrencyAnalyzer::EndingStatus
+    uint8_t status;
+    /// A combination of ResultFlag
+    uint8_t flags;
+    /// Number of points played
+    uint32_t nbPlayed;
+    /// The points of the scenario
+    const ScenarioFilePoint *points;
+    /// Number of points of the scenario
+    uint32_t nbPoints;
+    /// The observation key, not null-terminated
+    const char *key;
+    /// Number of characters of the key
+    uint32_t keyLength;
+} ResultRow;
+
+///
+/// \brief The ResultStoreReader class
+///
+/// Reads a result store file, mapped in memory. The chunks are located at
+/// open(), and the results are read in place. select() only reads the status
+/// and flags columns.
+///
+/// Typical use, to find the deadlocks:
+///
+/// \code{cpp}
+/// ResultStoreReader reader;
+/// reader.open("results.pcor");
+/// for (auto row : reader.select(static_cast<int>(PcoConcurrencyAnalyzer::EndingStatus::Deadlock), 0))
+///     ResultRow result = reader.getRow(row);
+/// \endcode
+///
+class ResultStoreReader
+{
+public:
+
+    ResultStoreReader() = default;
+    ~ResultStoreReader();
+
+    ResultStoreReader(const ResultStoreReader &) = delete;
+    ResultStoreReader &operator=(const ResultStoreReader &) = delete;
+
+    ///
+    /// \brief Maps a result store file
+    /// \param fileName The name of the file
+    /// \return true if the file is a result store of a supported version, false else
+    ///
+    /// A truncated last chunk, being written, is ignored.
+    ///
+    bool open(const std::string &fileName);
+
+    /// Gets the number of scenarios of the file
+    [[nodiscard]] uint64_t getNbScenarios() const { return nbScenarios; }
+
+    /// Gets the ids of the threads of the file
+    [[nodiscard]] const std::vector<std::string> &getThreadIds() const { return threadIds; }
+
+    ///
+    /// \brief Selects the scenarios by status and flags
+    /// \param status The ending status, -1 for any
+    /// \param flagsMask The flags the scenarios shall all have, 0 for any
+    /// \return The rows of the selected scenarios, in increasing order
+    ///
+    [[nodiscard]] std::vector<uint64_t> select(int status, uint8_t flagsMask) const;
+
+    ///
+    /// \brief Gets the result of a scenario
+    /// \param row The row of the scenario, between 0 and getNbScenarios() - 1
+    /// \return The result
+    ///
+    [[nodiscard]] ResultRow getRow(uint64_t row) const;
+
+private:
+
+    ///
+    /// \brief The columns of a chunk in the mapped file
+    ///
+    typedef struct {
+        uint64_t firstRow;
+        uint32_t nbRows;
+        const uint64_t *indexes;
+        const uint32_t *played;
+        const uint32_t *pointsEnds;
+        const uint32_t *keysEnds;
+        const uint8_t *statuses;
+        const uint8_t *flags;
+        const ScenarioFilePoint *points;
+        const char *keys;
+    } Chunk;
+
+    /// Unmaps the file
+    void close();
+
+    /// The mapped file
+    const char *data{nullptr};
+
+    /// The size of the mapped file
+    size_t size{0};
+
+    /// The ids of the threads of the file
+    std::vector<std::string> threadIds;
+
+    /// The chunks
+    std::vector<Chunk> chunks;
+
+    /// Number of scenarios of the chunks
+    uint64_t nbScenarios{0};
+};
+
+#endif // RESULTSTORE_H
@@ -1,8 +1,14 @@
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <set>
 #include <sstream>
 
 
+#include "allocationaccounting.h"
 #include "scenario.h"
+#include "flatscenariograph.h"
 #include "observablethread.h"
 
 
@@ -31,6 +37,21 @@ ScenarioGraphNode::ScenarioGraphNode(const ObservableThread *thread, int number)
     thread(thread), number(number)
 {}
 
+void ScenarioGraphNode::acquire(int counter, int n)
+{
+    effects.push_back(SectionEffect{counter, -n});
+}
+
+void ScenarioGraphNode::release(int counter, int n)
+{
+    effects.push_back(SectionEffect{counter, n});
+}
+
+void ScenarioGraphNode::addLoop(ScenarioGraphNode *target, int bound)
+{
+    loops.push_back(LoopEdge{target, bound});
+}
+
 
 
 void ScenarioGraph::setInitialNode(ScenarioGraphNode *node)
@@ -45,6 +66,7 @@ ScenarioGraphNode *ScenarioGraph::getFirstNode()
 
 ScenarioGraphNode *ScenarioGraph::createNode(const ObservableThread *thread, int number)
 {
+    AllocationScope scope(AllocationSubsystem::Graph);
     // As the constructor is protected, std::make_unique() does not work, even though
     // ScenarioGraph is a friend of ScenarioGraphNode
     auto node = std::unique_ptr<ScenarioGraphNode>(new ScenarioGraphNode(thread, number));
@@ -53,6 +75,16 @@ ScenarioGraphNode *ScenarioGraph::createNode(const ObservableThread *thread, int
     return n;
 }
 
+ScenarioGraphNode *ScenarioGraph::findNode(int number)
+{
+    for (const auto &node : set) {
+        if (node->number == number) {
+            return node.get();
+        }
+    }
+    return nullptr;
+}
+
 
 ///
 /// \brief addToSet
@@ -82,6 +114,10 @@ std::string ScenarioGraph::toDot() const
     dotString << "digraph mygraph {\n";
     dotString << "rankdir=\"LR\";\n";
     for ( auto node : set) {
+        if (node->mayEnd && !node->next.empty()) {
+            // The thread can also end after this section
+            dotString << node->number << " [peripheries=2];\n";
+        }
         for(auto child : node->next) {
             dotString << node->number << " -> " << child->number << ";\n";
         }
@@ -91,11 +127,41 @@ std::string ScenarioGraph::toDot() const
 }
 
 
+///
+/// \brief Memoized count of the scenarios from a node
+/// \param n The node
+/// \param depth The remaining depth
+/// \param memo The counts already computed
+/// \return The number of scenarios
+///
+static size_t countScenarios(ScenarioGraphNode *n, int depth, std::map<std::pair<ScenarioGraphNode *, int>, size_t> &memo)
+{
+    if (depth == 0) {
+        return 1;
+    }
+    if (n->next.empty()) {
+        return 1;
+    }
+    auto key = std::make_pair(n, depth);
+    auto it = memo.find(key);
+    if (it != memo.end()) {
+        return it->second;
+    }
+    // The scenario ending the thread after this section
+    size_t result = n->mayEnd ? 1 : 0;
+    for (auto child : n->next) {
+        result += countScenarios(child, depth - 1, memo);
+    }
+    memo[key] = result;
+    return result;
+}
+
 size_t ScenarioGraph::nbScenarios(int depth) const
 {
     size_t result = 0;
+    std::map<std::pair<ScenarioGraphNode *, int>, size_t> memo;
     for (auto child : m_firstNode->next) {
-        result += nbScenarios(child, depth);
+        result += countScenarios(child, depth, memo);
     }
     return result;
 }
@@ -103,15 +169,261 @@ size_t ScenarioGraph::nbScenarios(int depth) const
 
 size_t ScenarioGraph::nbScenarios(ScenarioGraphNode *n, int depth)
 {
-    size_t result = 0;
+    std::map<std::pair<ScenarioGraphNode *, int>, size_t> memo;
+    return countScenarios(n, depth, memo);
+}
+
+
+///
+/// \brief Memoized count of the interleavings from a global position
+/// \param graph The flat graph of the threads
+/// \param nodes The current node of each thread
+/// \param depth The remaining depth
+/// \param memo The counts already computed
+/// \return The number of scenarios
+///
+static size_t countInterleavings(const FlatScenarioGraph &graph, std::vector<FlatScenarioGraph::NodeIndex> &nodes, int depth,
+                                 std::map<std::pair<std::vector<FlatScenarioGraph::NodeIndex>, int>, size_t> &memo)
+{
     if (depth == 0) {
         return 1;
     }
-    if (n->next.empty()) {
-        return 1;
+    auto key = std::make_pair(nodes, depth);
+    auto it = memo.find(key);
+    if (it != memo.end()) {
+        return it->second;
     }
-    for (auto child : n->next) {
-        result += nbScenarios(child, depth - 1);
+    size_t result = 0;
+    bool atLeastOneNew = false;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        auto current = nodes[i];
+        for (auto child = graph.childrenBegin(current); child != graph.childrenEnd(current); child++) {
+            atLeastOneNew = true;
+            nodes[i] = *child;
+            result += countInterleavings(graph, nodes, depth - 1, memo);
+        }
+        nodes[i] = current;
+    }
+    if (!atLeastOneNew || graph.canStop(nodes)) {
+        // The prefix itself is a scenario
+        result += 1;
     }
+    memo[key] = result;
     return result;
 }
+
+///
+/// \brief Memoized count of the interleavings from a global position, up to the end of the threads
+/// \param graph The flat graph of the threads
+/// \param nodes The current node of each thread
+/// \param memo The counts already computed
+/// \param visiting The global positions of the current path, to detect the cycles
+/// \return The number of scenarios, std::numeric_limits<size_t>::max() if they are not bounded
+///
+static size_t countAllInterleavings(const FlatScenarioGraph &graph, std::vector<FlatScenarioGraph::NodeIndex> &nodes,
+                                    std::map<std::vector<FlatScenarioGraph::NodeIndex>, size_t> &memo,
+                                    std::set<std::vector<FlatScenarioGraph::NodeIndex> > &visiting)
+{
+    constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+    auto it = memo.find(nodes);
+    if (it != memo.end()) {
+        return it->second;
+    }
+    if (!visiting.insert(nodes).second) {
+        // The position can be reached again, so the scenarios can be infinitely long
+        return unbounded;
+    }
+    size_t result = 0;
+    bool atLeastOneNew = false;
+    for (size_t i = 0; (i < nodes.size()) && (result != unbounded); i++) {
+        auto current = nodes[i];
+        for (auto child = graph.childrenBegin(current); child != graph.childrenEnd(current); child++) {
+            atLeastOneNew = true;
+            nodes[i] = *child;
+            size_t sub = countAllInterleavings(graph, nodes, memo, visiting);
+            result = (sub > unbounded - result) ? unbounded : result + sub;
+        }
+        nodes[i] = current;
+    }
+    if ((!atLeastOneNew || graph.canStop(nodes)) && (result != unbounded)) {
+        // The prefix itself is a scenario
+        result += 1;
+    }
+    visiting.erase(nodes);
+    memo[nodes] = result;
+    return result;
+}
+
+size_t ScenarioGraph::nbScenarios(const std::vector<ScenarioGraphNode *> &nodes, int depth)
+{
+    FlatScenarioGraph graph(nodes);
+    std::vector<FlatScenarioGraph::NodeIndex> current = graph.getRoots();
+    if (depth <= 0) {
+        std::map<std::vector<FlatScenarioGraph::NodeIndex>, size_t> memo;
+        std::set<std::vector<FlatScenarioGraph::NodeIndex> > visiting;
+        return countAllInterleavings(graph, current, memo, visiting);
+    }
+    std::map<std::pair<std::vector<FlatScenarioGraph::NodeIndex>, int>, size_t> memo;
+    return countInterleavings(graph, current, depth, memo);
+}
+
+
+size_t ScenarioGraph::coarsen()
+{
+    AllocationScope scope(AllocationSubsystem::Graph);
+    if (!m_firstNode) {
+        return 0;
+    }
+    std::set<ScenarioGraphNode *> reachable;
+    addToSet(m_firstNode, reachable);
+
+    std::map<ScenarioGraphNode *, int> nbParents;
+    for (auto node : reachable) {
+        for (auto child : node->next) {
+            nbParents[child]++;
+        }
+    }
+
+    std::set<ScenarioGraphNode *> removed;
+    for (auto node : reachable) {
+        if ((node == m_firstNode) || (removed.count(node) != 0)) {
+            continue;
+        }
+        while (!node->mayEnd && (node->next.size() == 1) && (node->next[0] != node) && (node->next[0] != m_firstNode) &&
+               (nbParents[node->next[0]] == 1) && (node->local || node->next[0]->local)) {
+            auto child = node->next[0];
+            node->absorbed.push_back(child->number);
+            node->absorbed.insert(node->absorbed.end(), child->absorbed.begin(), child->absorbed.end());
+            node->effects.insert(node->effects.end(), child->effects.begin(), child->effects.end());
+            node->footprint.insert(node->footprint.end(), child->footprint.begin(), child->footprint.end());
+            node->local = node->local && child->local;
+            node->mayEnd = child->mayEnd;
+            node->next = child->next;
+            removed.insert(child);
+        }
+    }
+
+    for (auto it = set.begin(); it != set.end();) {
+        if (removed.count(it->get()) != 0) {
+            it = set.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+    merged = merged || !removed.empty();
+    return removed.size();
+}
+
+size_t ScenarioGraph::unrollLoops()
+{
+    AllocationScope scope(AllocationSubsystem::Graph);
+    if (m_firstNode == nullptr) {
+        return 0;
+    }
+    std::set<ScenarioGraphNode *> reachable;
+    addToSet(m_firstNode, reachable);
+
+    // The loops, as their last section and their edge
+    std::vector<std::pair<ScenarioGraphNode *, LoopEdge> > loops;
+    std::map<ScenarioGraphNode *, std::vector<ScenarioGraphNode *> > parents;
+    for (auto node : reachable) {
+        for (const auto &loop : node->loops) {
+            loops.emplace_back(node, loop);
+        }
+        for (auto child : node->next) {
+            parents[child].push_back(node);
+        }
+    }
+    if (loops.empty()) {
+        return 0;
+    }
+
+    // The body of a loop: the nodes between its first and its last section
+    std::vector<std::set<ScenarioGraphNode *> > bodies;
+    for (const auto &loop : loops) {
+        std::set<ScenarioGraphNode *> forward;
+        addToSet(loop.second.target, forward);
+        std::set<ScenarioGraphNode *> body;
+        std::vector<ScenarioGraphNode *> stack{loop.first};
+        while (!stack.empty()) {
+            auto node = stack.back();
+            stack.pop_back();
+            if ((forward.count(node) != 0) && body.insert(node).second && (node != loop.second.target)) {
+                for (auto parent : parents[node]) {
+                    stack.push_back(parent);
+                }
+            }
+        }
+        bodies.push_back(body);
+    }
+
+    // A node of the unrolled graph is an original node with the iteration
+    // counters of the loops containing it
+    using State = std::pair<ScenarioGraphNode *, std::vector<int> >;
+    std::map<State, ScenarioGraphNode *> unrolled;
+    std::vector<std::pair<State, ScenarioGraphNode *> > toExpand;
+    auto getNode = [&](ScenarioGraphNode *node, std::vector<int> counters) {
+        for (size_t l = 0; l < loops.size(); l++) {
+            if (bodies[l].count(node) == 0) {
+                counters[l] = 0;
+            }
+        }
+        State state{node, counters};
+        auto it = unrolled.find(state);
+        if (it != unrolled.end()) {
+            return it->second;
+        }
+        auto copy = createNode(node->thread, node->number);
+        copy->effects = node->effects;
+        copy->footprint = node->footprint;
+        copy->local = node->local;
+        copy->mayEnd = node->mayEnd;
+        copy->absorbed = node->absorbed;
+        unrolled[state] = copy;
+        toExpand.emplace_back(state, copy);
+        return copy;
+    };
+
+    auto first = getNode(m_firstNode, std::vector<int>(loops.size(), 0));
+    while (!toExpand.empty()) {
+        auto [state, copy] = toExpand.back();
+        toExpand.pop_back();
+        for (auto child : state.first->next) {
+            copy->next.push_back(getNode(child, state.second));
+        }
+        for (size_t l = 0; l < loops.size(); l++) {
+            if ((loops[l].first == state.first) && (state.second[l] < loops[l].second.bound)) {
+                auto counters = state.second;
+                counters[l]++;
+                copy->next.push_back(getNode(loops[l].second.target, counters));
+            }
+        }
+    }
+
+    // Only the unrolled nodes are kept
+    std::set<ScenarioGraphNode *> kept;
+    for (const auto &node : unrolled) {
+        kept.insert(node.second);
+    }
+    for (auto it = set.begin(); it != set.end();) {
+        if (kept.count(it->get()) == 0) {
+            it = set.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+    m_firstNode = first;
+    return unrolled.size();
+}
+
+bool ScenarioGraph::hasMergedSections() const
+{
+    return merged;
+}
+
+size_t ScenarioGraph::nbNodes() const
+{
+    return set.size();
+}
@@ -17,6 +17,14 @@ typedef struct {
     int number;
 } ScenarioPoint;
 
+/// An abstract effect of a section on a counting semaphore
+typedef struct {
+    /// The counter identifier, as returned by SemaphoreFilter::addCounter()
+    int counter;
+    /// The value added to the counter, negative for an acquire
+    int delta;
+} SectionEffect;
+
 /// A scenario is a vector of scenario points
 /// Its size defines the scenario depth
 using Scenario = std::vector<ScenarioPoint>;
@@ -43,6 +51,15 @@ public:
 
 
 class ScenarioGraph;
+class ScenarioGraphNode;
+
+/// A loop edge, going back to a previous section of the same thread
+typedef struct {
+    /// The section starting the loop body
+    ScenarioGraphNode *target;
+    /// The maximum number of times the edge is taken in a row
+    int bound;
+} LoopEdge;
 
 ///
 /// \brief The ScenarioGraphNode class
@@ -76,6 +93,75 @@ public:
 
     /// A vector of children, each one being a potentiel next section
     std::vector<ScenarioGraphNode *> next;
+
+    ///
+    /// \brief Whether the thread can end after this section, although it has children
+    ///
+    /// A node without children always ends the thread. This flag lets a single
+    /// node stand both for a section ending the thread and for the same section
+    /// followed by others, so that the builders do not generate the same
+    /// scenario twice from two sibling nodes.
+    ///
+    bool mayEnd{false};
+
+    ///
+    /// \brief Abstract semaphore effects of the section, in program order
+    ///
+    /// They are only used by a SemaphoreFilter, to reject interleavings
+    /// in which this section would block, without running them.
+    ///
+    std::vector<SectionEffect> effects;
+
+    ///
+    /// \brief Names of the shared data accessed by the section
+    ///
+    /// Used to infer groups of threads that share no data, and can then
+    /// be explored independently. See PcoModel::getThreadGroups().
+    ///
+    std::vector<std::string> footprint;
+
+    ///
+    /// \brief Whether the section is local
+    ///
+    /// A local section accesses no shared data and calls no synchronization
+    /// primitive, so it commutes with the sections of the other threads. Its
+    /// boundary with a neighbour section is not a meaningful scheduling point,
+    /// and ScenarioGraph::coarsen() can merge them.
+    ///
+    bool local{false};
+
+    /// Section numbers merged into this node by ScenarioGraph::coarsen(), in order
+    std::vector<int> absorbed;
+
+    ///
+    /// \brief Loop edges from this section, see addLoop()
+    ///
+    std::vector<LoopEdge> loops;
+
+    ///
+    /// \brief Declares that the thread can loop back to a previous section
+    /// \param target The first section of the loop body
+    /// \param bound The maximum number of iterations after the first one
+    ///
+    /// This section being the last one of the loop body, the thread can start
+    /// target again after it, at most bound times each time it enters the
+    /// loop. The loops are taken into account by ScenarioGraph::unrollLoops().
+    ///
+    void addLoop(ScenarioGraphNode *target, int bound);
+
+    ///
+    /// \brief Declares that the section acquires a counter
+    /// \param counter The counter identifier
+    /// \param n The number of acquisitions
+    ///
+    void acquire(int counter, int n = 1);
+
+    ///
+    /// \brief Declares that the section releases a counter
+    /// \param counter The counter identifier
+    /// \param n The number of releases
+    ///
+    void release(int counter, int n = 1);
 };
 
 class ScenarioGraphNode;
@@ -119,6 +205,9 @@ public:
     /// \brief nbScenarios
     /// \return The number of possible scenarios up to a certain depth
     ///
+    /// The counts are memoized per node and depth, so that the graphs sharing
+    /// nodes, as unrolled ones, are counted in linear time.
+    ///
     [[nodiscard]] size_t nbScenarios(int depth) const;
 
     ///
@@ -127,7 +216,79 @@ public:
     ///
     [[nodiscard]] static size_t nbScenarios(ScenarioGraphNode *n, int depth);
 
-    // static size_t nbScenarios(std::vector<ScenarioGraphNode *> graphs, int depth);
+    ///
+    /// \brief nbScenarios
+    /// \param nodes The current node of each thread
+    /// \param depth The depth of the scenarios
+    /// \return The number of interleavings of several threads up to a certain depth
+    ///
+    /// It counts the scenarios the builders generate from these nodes, without
+    /// generating them. As for the builders, a depth of 0 means no bound: the
+    /// scenarios go up to the end of the threads, and if a cycle makes them
+    /// infinitely long, std::numeric_limits<size_t>::max() is returned.
+    ///
+    [[nodiscard]] static size_t nbScenarios(const std::vector<ScenarioGraphNode *> &nodes, int depth);
+
+    ///
+    /// \brief Merges chains of nodes around local sections
+    /// \return The number of nodes removed from the graph
+    ///
+    /// A node having a single child, this child having no other parent, is merged
+    /// with its child if one of them is local, unless the thread may end after the
+    /// node, see ScenarioGraphNode::mayEnd. The start of the child section is
+    /// then no longer a scheduling point: the merged node keeps the number of the
+    /// first section and records the others in ScenarioGraphNode::absorbed.
+    /// The ObservableThread follows its path in the graph, and skips the
+    /// startSection() and endSection() calls inside a merged node.
+    /// The merges are decided per node, so the copies of a section created by
+    /// unrollLoops() can be merged or not independently.
+    ///
+    /// It shall be called before the graph is given to a scenario builder.
+    ///
+    size_t coarsen();
+
+    ///
+    /// \brief Unrolls the loop edges of the graph, in place
+    /// \return The number of nodes of the unrolled graph, 0 if there is no loop edge
+    ///
+    /// Each node is replaced by one node per reachable combination of the
+    /// iteration counters of the loops containing it. The counter of a loop
+    /// is forgotten when leaving its body, so that the nodes following a loop
+    /// are shared by all its iterations. Only the reachable combinations are
+    /// created, and the graph is acyclic if its next edges were.
+    ///
+    /// The combinations are all created by this call, memoized by node and
+    /// counters, rather than on demand: the builders, PcoModel and the
+    /// analyzers read the next edges directly, and FlatScenarioGraph walks the
+    /// whole reachable graph before each generation. A node is copied at most
+    /// once per combination of the counters of its loops, that is the product
+    /// of their bounds plus one.
+    ///
+    /// Several nodes then share the same section number: the ObservableThread
+    /// still calls startSection() with the number, whatever the iteration.
+    /// It shall be called after the nodes have been annotated, before
+    /// coarsen() and before the graph is given to a scenario builder.
+    ///
+    size_t unrollLoops();
+
+    ///
+    /// \brief Indicates whether coarsen() merged sections of the graph
+    /// \return true if a node has absorbed sections
+    ///
+    [[nodiscard]] bool hasMergedSections() const;
+
+    ///
+    /// \brief Gets the number of nodes of the graph
+    /// \return The number of nodes, including the initial one
+    ///
+    [[nodiscard]] size_t nbNodes() const;
+
+    ///
+    /// \brief Finds a node thanks to its section number
+    /// \param number The section number
+    /// \return A pointer to the node, nullptr if there is no such node
+    ///
+    ScenarioGraphNode *findNode(int number);
 
     ///
     /// \brief Creates a scenario node
@@ -146,6 +307,9 @@ private:
 
     /// Set of nodes of this graph
     std::set<std::unique_ptr<ScenarioGraphNode>> set;
+
+    /// Whether coarsen() merged sections
+    bool merged{false};
 };
 
 
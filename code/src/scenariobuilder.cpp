@@ -1,7 +1,50 @@
+#include "allocationaccounting.h"
 #include "scenariobuilder.h"
+#include "verbosity.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+
+
+
+///
+/// \brief Checks whether a blocking section can be dropped
+/// \param graph The flat graph of the threads
+/// \param threads The current node of every thread
+/// \param thread The index of the thread whose section would block
+/// \return true if another thread still has sections to play
+///
+/// In that case the scenario can only end up in a DeadEnd. If every other thread
+/// can end, the scenario is kept, as it may reveal a real deadlock.
+///
+static bool othersRunning(const FlatScenarioGraph &graph, const std::vector<FlatScenarioGraph::NodeIndex> &threads, int thread)
+{
+    for (size_t i = 0; i < threads.size(); i++) {
+        if ((static_cast<int>(i) != thread) && (!graph.canEnd(threads[i]))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 
+///
+/// \brief Gets the initial node of the scenario graph of every thread
+/// \param threads A vector of observable threads, as raw or smart pointers
+/// \return The vector of initial nodes, in the same order
+///
+template<typename ThreadPointer>
+static std::vector<ScenarioGraphNode*> firstNodes(const std::vector<ThreadPointer> &threads)
+{
+    std::vector<ScenarioGraphNode*> nodes;
+    nodes.reserve(threads.size());
+    for(const auto& t: threads)
+        nodes.push_back(t->getScenarioGraph()->getFirstNode());
+    return nodes;
+}
 
 
 void UnoptimizedScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth)
@@ -9,6 +52,22 @@ void UnoptimizedScenarioBuilderIter::init(const std::vector<std::unique_ptr<Obse
     scenarios = builder.generateScenarios(threads, depth);
 }
 
+bool UnoptimizedScenarioBuilderIter::initSubset(const std::vector<ObservableThread *> &threads, int depth)
+{
+    scenarios = builder.generateScenarios(firstNodes(threads), depth);
+    return true;
+}
+
+void UnoptimizedScenarioBuilderIter::setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter)
+{
+    builder.setSemaphoreFilter(std::move(filter));
+}
+
+std::shared_ptr<SemaphoreFilter> UnoptimizedScenarioBuilderIter::getSemaphoreFilter()
+{
+    return builder.getSemaphoreFilter();
+}
+
 size_t BruteforceScenarioBuilderIter::getMaxScenariosNb()
 {
     return scenarios.size();
@@ -28,9 +87,71 @@ Scenario BruteforceScenarioBuilderIter::getNext()
     return Scenario();
 }
 
-void PredefinedScenarioBuilderIter::setScenarios(std::vector<Scenario> scenarios)
+void PredefinedScenarioBuilderIter::setScenarios(const std::vector<Scenario> &scenarios)
 {
-    this->scenarios = std::move(scenarios);
+    trie.clear();
+    order.clear();
+    currentIndex = 0;
+    nbGiven = 0;
+    nbGivenPoints = 0;
+    nbDuplicates = 0;
+    flatMemory = 0;
+    for (const auto &scenario : scenarios) {
+        addScenario(scenario);
+    }
+}
+
+void PredefinedScenarioBuilderIter::addScenario(const Scenario &scenario)
+{
+    if (scenario.empty()) {
+        return;
+    }
+    nbGiven++;
+    nbGivenPoints += scenario.size();
+    flatMemory += sizeof(Scenario) + scenario.size() * sizeof(ScenarioPoint);
+    if (trie.insert(scenario)) {
+        ordered = false;
+    }
+    else {
+        nbDuplicates++;
+    }
+}
+
+Scenario PredefinedScenarioBuilderIter::getNext()
+{
+    if (!ordered) {
+        order = trie.getTerminals();
+        ordered = true;
+    }
+    if (currentIndex < order.size()) {
+        currentIndex ++;
+        return trie.getScenario(order[currentIndex - 1]);
+    }
+    return Scenario();
+}
+
+size_t PredefinedScenarioBuilderIter::getMaxScenariosNb()
+{
+    return trie.size();
+}
+
+size_t PredefinedScenarioBuilderIter::getRemainingScenariosNb()
+{
+    return trie.size() - currentIndex;
+}
+
+void PredefinedScenarioBuilderIter::printStorageStats() const
+{
+    size_t memory = trie.memoryUsage();
+    std::cout << "Predefined scenarios : " << nbGiven << " given, " << nbDuplicates << " duplicates dropped" << std::endl;
+    std::cout << "Points stored : " << trie.nbPoints() << " instead of " << nbGivenPoints << std::endl;
+    std::cout << "Memory : " << memory << " bytes instead of " << flatMemory << " bytes (";
+    if (memory <= flatMemory) {
+        std::cout << flatMemory - memory << " bytes saved)" << std::endl;
+    }
+    else {
+        std::cout << memory - flatMemory << " bytes more)" << std::endl;
+    }
 }
 
 
@@ -39,43 +160,57 @@ ScenarioBranchBuilderBuffer::ScenarioBranchBuilderBuffer(size_t step): step(step
 
 
 bool ScenarioBranchBuilderBuffer::build(int thread, int nextPoint) {
-    if (currentthreads[thread]->next.empty())
+    if (graph.isLeaf(currentthreads[thread]))
         return false;
-    auto n = currentthreads[thread]->next[nextPoint];
-    current.push_back(ScenarioPoint{n->thread, n->number});
-    currentthreads[thread] = currentthreads[thread]->next[nextPoint];
+    auto n = graph.getChild(currentthreads[thread], nextPoint);
+    current.push_back(graph.getPoint(n));
+    currentthreads[thread] = n;
     return true;
 }
 
+void ScenarioBranchBuilderBuffer::putCurrent() {
+    if (currentIndex == nextIndex) {
+        buffer->put(current);
+        nextIndex = nextIndex + step;
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios))
+            std::cout << ".";
+    }
+    currentIndex++;
+}
+
 void ScenarioBranchBuilderBuffer::buildVector(int index) {
+    if (cancelled) {
+        return;
+    }
+    if (graph.canStop(currentthreads)) {
+        // All the threads can end here, so the prefix is also a scenario
+        putCurrent();
+    }
     bool atLeastOneNew = false;
     for(int i=0;i<nbThreads;i++) {
-        for (size_t j = 0; j < currentthreads[i]->next.size(); j++) {
+        for (size_t j = 0; j < graph.nbChildren(currentthreads[i]); j++) {
             auto lastBranch = currentthreads[i];
             if (build(i,j)) {
                 atLeastOneNew = true;
-                if (index == scenarioSize - 1) {
-                    if (currentIndex == nextIndex) {
-                        buffer->put(current);
-                        nextIndex = nextIndex + step;
-                        std::cout << ".";
-                    }
-                    currentIndex++;
+                bool entered = filter && filter->enter(graph.getSource(currentthreads[i]));
+                if (filter && !entered && othersRunning(graph, currentthreads, i)) {
+                    // The section would block, so this interleaving is a DeadEnd
+                    filter->reject();
+                }
+                else if (index == scenarioSize - 1) {
+                    putCurrent();
                 }
                 else
                     buildVector(index + 1);
+                if (entered)
+                    filter->leave(graph.getSource(currentthreads[i]));
                 current.pop_back();
                 currentthreads[i] = lastBranch;
             }
         }
     }
     if (!atLeastOneNew) {
-        if (currentIndex == nextIndex) {
-            buffer->put(current);
-            nextIndex = nextIndex + step;
-            std::cout << ".";
-        }
-        currentIndex++;
+        putCurrent();
     }
 }
 
@@ -85,6 +220,21 @@ bool ScenarioBranchBuilderBuffer::isFinished()
     return !running;
 }
 
+void ScenarioBranchBuilderBuffer::cancel()
+{
+    cancelled = true;
+}
+
+void ScenarioBranchBuilderBuffer::setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter)
+{
+    declaredFilter = std::move(filter);
+}
+
+void ScenarioBranchBuilderBuffer::cloneFilter()
+{
+    filter = declaredFilter ? declaredFilter->clone() : nullptr;
+}
+
 void ScenarioBranchBuilderBuffer::generateScenarios(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth)
 {
     running = true;
@@ -98,10 +248,13 @@ void ScenarioBranchBuilderBuffer::generateScenarios(const std::vector<std::uniqu
 void ScenarioBranchBuilderBuffer::generateScenarios(const std::vector<ScenarioGraphNode*>& threads, int depth)
 {
     std::vector<int> choice;
-    currentthreads = threads;
+    graph = FlatScenarioGraph(threads);
+    currentthreads = graph.getRoots();
     current.clear();
     nbThreads = threads.size();
     scenarioSize = depth;
+    if (filter)
+        filter->reset();
 
     buildVector(0);
     running = false;
@@ -120,26 +273,37 @@ void ScenarioBranchBuilderBuffer::generateScenarios(const std::vector<ScenarioGr
 ScenarioBranchBuilder::ScenarioBranchBuilder() = default;
 
 bool ScenarioBranchBuilder::build(int thread, int nextPoint) {
-    if (currentthreads[thread]->next.empty())
+    if (graph.isLeaf(currentthreads[thread]))
         return false;
-    auto n = currentthreads[thread]->next[nextPoint];
-    current.push_back(ScenarioPoint{n->thread, n->number});
-    currentthreads[thread] = currentthreads[thread]->next[nextPoint];
+    auto n = graph.getChild(currentthreads[thread], nextPoint);
+    current.push_back(graph.getPoint(n));
+    currentthreads[thread] = n;
     return true;
 }
 
 void ScenarioBranchBuilder::buildVector(int index) {
+    if (graph.canStop(currentthreads)) {
+        // All the threads can end here, so the prefix is also a scenario
+        result.push_back(current);
+    }
     bool atLeastOneNew = false;
     for(int i=0;i<nbThreads;i++) {
-        for (size_t j = 0; j < currentthreads[i]->next.size(); j++) {
+        for (size_t j = 0; j < graph.nbChildren(currentthreads[i]); j++) {
             auto lastBranch = currentthreads[i];
             if (build(i,j)) {
                 atLeastOneNew = true;
-                if (index == scenarioSize - 1) {
+                bool entered = filter && filter->enter(graph.getSource(currentthreads[i]));
+                if (filter && !entered && othersRunning(graph, currentthreads, i)) {
+                    // The section would block, so this interleaving is a DeadEnd
+                    filter->reject();
+                }
+                else if (index == scenarioSize - 1) {
                     result.push_back(current);
                 }
                 else
                     buildVector(index + 1);
+                if (entered)
+                    filter->leave(graph.getSource(currentthreads[i]));
                 current.pop_back();
                 currentthreads[i] = lastBranch;
             }
@@ -163,16 +327,23 @@ std::vector<Scenario> ScenarioBranchBuilder::generateScenarios(const std::vector
 std::vector<Scenario> ScenarioBranchBuilder::generateScenarios(const std::vector<ScenarioGraphNode*>& threads, int depth)
 {
     std::vector<int> choice;
-    currentthreads = threads;
+    graph = FlatScenarioGraph(threads);
+    currentthreads = graph.getRoots();
     current.clear();
     nbThreads = threads.size();
     scenarioSize = depth;
+    filter = declaredFilter ? declaredFilter->clone() : nullptr;
 
     buildVector(0);
 
     return result;
 }
 
+void ScenarioBranchBuilder::setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter)
+{
+    declaredFilter = std::move(filter);
+}
+
 
 
 void FlowScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth)
@@ -180,6 +351,12 @@ void FlowScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableT
     builder.initScenarios(threads, depth);
 }
 
+bool FlowScenarioBuilderIter::initSubset(const std::vector<ObservableThread *> &threads, int depth)
+{
+    builder.initScenarios(firstNodes(threads), depth);
+    return true;
+}
+
 Scenario FlowScenarioBuilderIter::getNext()
 {
     return builder.getNext();
@@ -235,18 +412,19 @@ size_t FlowScenarioBuilderIter::getRemainingScenariosNb()
 
 
 bool ScenarioBranchBuilderIter::build(int thread, int nextPoint) {
-    if (currentthreads[thread]->next.empty())
+    if (graph.isLeaf(currentthreads[thread]))
         return false;
-    auto n = currentthreads[thread]->next[nextPoint];
-    current.push_back(ScenarioPoint{n->thread, n->number});
-    currentthreads[thread] = currentthreads[thread]->next[nextPoint];
+    auto n = graph.getChild(currentthreads[thread], nextPoint);
+    current.push_back(graph.getPoint(n));
+    currentthreads[thread] = n;
     return true;
 }
 
 bool ScenarioBranchBuilderIter::buildVector() {
     bool result = false;
     while (true) {
-        std::cout << currentIndex << ", " << int_i[currentIndex] << ", " << int_j[currentIndex] << std::endl;
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios))
+            std::cout << currentIndex << ", " << int_i[currentIndex] << ", " << int_j[currentIndex] << std::endl;
         int_lastBranch[currentIndex] = currentthreads[int_i[currentIndex]];
         if (build(int_i[currentIndex],int_j[currentIndex])) {
             int_atLeastOneNew[currentIndex] = true;
@@ -273,7 +451,7 @@ bool ScenarioBranchBuilderIter::buildVector() {
 
             result = true;
             int_j[currentIndex] ++;
-            if (int_j[currentIndex] < currentthreads[int_i[currentIndex]]->next.size()) {
+            if (int_j[currentIndex] < graph.nbChildren(currentthreads[int_i[currentIndex]])) {
                 if (currentReady.empty()) {
                     break;
                 }
@@ -340,7 +518,7 @@ bool ScenarioBranchBuilderIter::buildVector() {
         }
         result = true;
         int_j[currentIndex] ++;
-        if (int_j[currentIndex] >= currentthreads[int_i[currentIndex]]->next.size()) {
+        if (int_j[currentIndex] >= graph.nbChildren(currentthreads[int_i[currentIndex]])) {
             // End of J for loop
             int_j[currentIndex] = 0;
             int_i[currentIndex] ++;
@@ -357,7 +535,7 @@ bool ScenarioBranchBuilderIter::buildVector() {
                     // that's the end
                 }
             }
-            else if (currentthreads[int_i[currentIndex]]->next.size() ==0) {
+            else if (graph.isLeaf(currentthreads[int_i[currentIndex]])) {
                 result = false;
             }
             else if (!currentReady.empty()){
@@ -386,7 +564,8 @@ void ScenarioBranchBuilderIter::initScenarios(const std::vector<std::unique_ptr<
 void ScenarioBranchBuilderIter::initScenarios(const std::vector<ScenarioGraphNode*>& threads, int depth)
 {
     std::vector<int> choice;
-    currentthreads = threads;
+    graph = FlatScenarioGraph(threads);
+    currentthreads = graph.getRoots();
     current.clear();
     nbThreads = threads.size();
     scenarioSize = depth;
@@ -395,7 +574,7 @@ void ScenarioBranchBuilderIter::initScenarios(const std::vector<ScenarioGraphNod
     int_j.resize(scenarioSize, 0);
     int_index.resize(scenarioSize, 0);
     int_atLeastOneNew.resize(scenarioSize, false);
-    int_lastBranch.resize(scenarioSize, nullptr);
+    int_lastBranch.resize(scenarioSize, 0);
 
     nextCurrentIndex = 0;
     currentIndex = 0;
@@ -418,9 +597,35 @@ Scenario ScenarioBranchBuilderIter::getNext()
 
 void ScenarioBuilderBuffer::init(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth)
 {
+    this->depth = depth;
+    nodes = firstNodes(threads);
+    counted = false;
+    nbReturned = 0;
+    builder.cloneFilter();
     builder.buffer = &buffer;
     auto *b = &builder;
-    th = std::make_unique<std::thread>([b,&threads,depth]{b->generateScenarios(threads, depth);});
+    // The nodes are copied, as the generation outlives this call
+    th = std::make_unique<std::thread>([b,nodes = nodes,depth]{
+        AllocationScope scope(AllocationSubsystem::Builder);
+        b->generateScenarios(nodes, depth);
+    });
+}
+
+bool ScenarioBuilderBuffer::initSubset(const std::vector<ObservableThread *> &threads, int depth)
+{
+    this->depth = depth;
+    nodes = firstNodes(threads);
+    counted = false;
+    nbReturned = 0;
+    builder.cloneFilter();
+    builder.buffer = &buffer;
+    auto *b = &builder;
+    // The nodes are copied, as the generation outlives this call
+    th = std::make_unique<std::thread>([b,nodes = nodes,depth]{
+        AllocationScope scope(AllocationSubsystem::Builder);
+        b->generateScenarios(nodes, depth);
+    });
+    return true;
 }
 
 Scenario ScenarioBuilderBuffer::getNext()
@@ -428,21 +633,353 @@ Scenario ScenarioBuilderBuffer::getNext()
     if ((buffer.getNbElements() == 0) && builder.isFinished()) {
         return {};
     }
-    return buffer.get();
+    Scenario scenario = buffer.get();
+    if (!scenario.empty()) {
+        nbReturned++;
+    }
+    return scenario;
+
+}
 
+void ScenarioBuilderBuffer::setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter)
+{
+    builder.setSemaphoreFilter(std::move(filter));
+}
+
+std::shared_ptr<SemaphoreFilter> ScenarioBuilderBuffer::getSemaphoreFilter()
+{
+    return builder.getSemaphoreFilter();
 }
 
 size_t ScenarioBuilderBuffer::getMaxScenariosNb()
 {
-    return 0;
+    countScenarios();
+    return nbScenarios;
 
 }
 
 size_t ScenarioBuilderBuffer::getRemainingScenariosNb()
 {
-    return 0;
+    countScenarios();
+    return (nbReturned < nbScenarios) ? nbScenarios - nbReturned : 0;
+}
+
+size_t ScenarioBuilderBuffer::getNbQueuedScenarios()
+{
+    return static_cast<size_t>(buffer.getNbElements());
+}
+
+size_t ScenarioBuilderBuffer::getNbPrunedSubtrees()
+{
+    return builder.getNbRejected();
+}
+
+void ScenarioBuilderBuffer::countScenarios()
+{
+    if (counted) {
+        return;
+    }
+    counted = true;
+    size_t nbInterleavings = ScenarioGraph::nbScenarios(nodes, depth);
+    if (nbInterleavings == std::numeric_limits<size_t>::max()) {
+        // Not bounded, reported as unknown
+        nbScenarios = 0;
+        return;
+    }
+    // One scenario out of step is generated, starting with the first one
+    nbScenarios = (nbInterleavings + step - 1) / step;
 }
 
 
 
 
+
+
+
+
+///
+/// \brief Counts the scenarios per number of preemptions from a global position
+/// \param graph The flat graph of the threads
+/// \param nodes The current node of each thread
+/// \param last The thread of the previous point, -1 for the first one
+/// \param depth The remaining depth
+/// \param maxPreemptions The maximum number of preemptions counted
+/// \param memo The counts already computed
+/// \return A vector whose element i is the number of scenarios with exactly i preemptions
+///
+static std::vector<size_t> countPerPreemptions(const FlatScenarioGraph &graph, std::vector<FlatScenarioGraph::NodeIndex> &nodes,
+                                               int last, int depth, int maxPreemptions,
+                                               std::map<std::tuple<std::vector<FlatScenarioGraph::NodeIndex>, int, int>, std::vector<size_t> > &memo)
+{
+    std::vector<size_t> result(maxPreemptions + 1, 0);
+    if (depth == 0) {
+        result[0] = 1;
+        return result;
+    }
+    auto key = std::make_tuple(nodes, last, depth);
+    auto it = memo.find(key);
+    if (it != memo.end()) {
+        return it->second;
+    }
+    bool atLeastOneNew = false;
+    bool lastRunning = (last >= 0) && !graph.isLeaf(nodes[last]);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        auto node = nodes[i];
+        int cost = (lastRunning && (static_cast<int>(i) != last)) ? 1 : 0;
+        for (auto child = graph.childrenBegin(node); child != graph.childrenEnd(node); child++) {
+            atLeastOneNew = true;
+            nodes[i] = *child;
+            auto sub = countPerPreemptions(graph, nodes, i, depth - 1, maxPreemptions, memo);
+            for (int k = 0; k + cost <= maxPreemptions; k++) {
+                result[k + cost] += sub[k];
+            }
+        }
+        nodes[i] = node;
+    }
+    if (!atLeastOneNew || graph.canStop(nodes)) {
+        // The prefix itself is a scenario, without more preemptions
+        result[0] += 1;
+    }
+    memo[key] = result;
+    return result;
+}
+
+PreemptionBoundedScenarioBuilderIter::PreemptionBoundedScenarioBuilderIter(int maxPreemptions) :
+    maxPreemptions(maxPreemptions)
+{
+    if (maxPreemptions < 0) {
+        std::cout << "Invalid maximum number of preemptions " << maxPreemptions << ", 0 is used" << std::endl;
+        this->maxPreemptions = 0;
+    }
+}
+
+void PreemptionBoundedScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth)
+{
+    initNodes(firstNodes(threads), depth);
+}
+
+bool PreemptionBoundedScenarioBuilderIter::initSubset(const std::vector<ObservableThread *> &threads, int depth)
+{
+    initNodes(firstNodes(threads), depth);
+    return true;
+}
+
+void PreemptionBoundedScenarioBuilderIter::initNodes(const std::vector<ScenarioGraphNode *> &nodes, int depth)
+{
+    graph = FlatScenarioGraph(nodes);
+    scenarioSize = depth;
+    std::map<std::tuple<std::vector<FlatScenarioGraph::NodeIndex>, int, int>, std::vector<size_t> > memo;
+    std::vector<FlatScenarioGraph::NodeIndex> current = graph.getRoots();
+    nbPerBound = countPerPreemptions(graph, current, -1, depth, maxPreemptions, memo);
+    bound = -1;
+    scenarios.clear();
+    currentIndex = 0;
+    nbReturned = 0;
+}
+
+void PreemptionBoundedScenarioBuilderIter::buildVector(int index, int last, int preemptions)
+{
+    if ((preemptions == bound) && graph.canStop(currentthreads)) {
+        // All the threads can end here, so the prefix is also a scenario
+        scenarios.push_back(current);
+    }
+    bool atLeastOneNew = false;
+    bool lastRunning = (last >= 0) && !graph.isLeaf(currentthreads[last]);
+    for (size_t i = 0; i < currentthreads.size(); i++) {
+        auto lastBranch = currentthreads[i];
+        int cost = (lastRunning && (static_cast<int>(i) != last)) ? 1 : 0;
+        for (auto n = graph.childrenBegin(lastBranch); n != graph.childrenEnd(lastBranch); n++) {
+            atLeastOneNew = true;
+            if (preemptions + cost > bound) {
+                // Too many preemptions for this bound, whatever follows
+                continue;
+            }
+            current.push_back(graph.getPoint(*n));
+            currentthreads[i] = *n;
+            if (index == scenarioSize - 1) {
+                if (preemptions + cost == bound) {
+                    scenarios.push_back(current);
+                }
+            }
+            else {
+                buildVector(index + 1, i, preemptions + cost);
+            }
+            current.pop_back();
+            currentthreads[i] = lastBranch;
+        }
+    }
+    if ((!atLeastOneNew) && (preemptions == bound)) {
+        scenarios.push_back(current);
+    }
+}
+
+Scenario PreemptionBoundedScenarioBuilderIter::getNext()
+{
+    while (currentIndex == scenarios.size()) {
+        // Generate the scenarios of the next bound
+        if (bound == maxPreemptions) {
+            return {};
+        }
+        bound++;
+        scenarios.clear();
+        currentIndex = 0;
+        if (nbPerBound[bound] > 0) {
+            scenarios.reserve(nbPerBound[bound]);
+            currentthreads = graph.getRoots();
+            current.clear();
+            buildVector(0, -1, 0);
+        }
+    }
+    nbReturned++;
+    return std::move(scenarios[currentIndex++]);
+}
+
+size_t PreemptionBoundedScenarioBuilderIter::getMaxScenariosNb()
+{
+    return std::accumulate(nbPerBound.begin(), nbPerBound.end(), size_t{0});
+}
+
+size_t PreemptionBoundedScenarioBuilderIter::getRemainingScenariosNb()
+{
+    return getMaxScenariosNb() - nbReturned;
+}
+
+const std::vector<size_t> &PreemptionBoundedScenarioBuilderIter::getNbScenariosPerBound() const
+{
+    return nbPerBound;
+}
+
+void PreemptionBoundedScenarioBuilderIter::printNbScenariosPerBound() const
+{
+    size_t total = 0;
+    for (size_t k = 0; k < nbPerBound.size(); k++) {
+        total += nbPerBound[k];
+        std::cout << "Preemptions " << k << " : " << nbPerBound[k] << " scenarios (" << total << " up to this bound)" << std::endl;
+    }
+    std::cout << "The scenarios with more than " << maxPreemptions
+              << " preemptions are not counted" << std::endl;
+}
+
+
+bool RandomScenarioBuilderIter::ScenarioLess::operator()(const Scenario &a, const Scenario &b) const
+{
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                        [](const ScenarioPoint &p1, const ScenarioPoint &p2) {
+        return (p1.thread < p2.thread) || ((p1.thread == p2.thread) && (p1.number < p2.number));
+    });
+}
+
+void RandomScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth)
+{
+    graph = FlatScenarioGraph(firstNodes(threads));
+    scenarioSize = depth;
+    nbReturned = 0;
+    nbDuplicates = 0;
+    drawn.clear();
+    filter = declaredFilter ? declaredFilter->clone() : nullptr;
+}
+
+bool RandomScenarioBuilderIter::initSubset(const std::vector<ObservableThread *> &threads, int depth)
+{
+    graph = FlatScenarioGraph(firstNodes(threads));
+    scenarioSize = depth;
+    nbReturned = 0;
+    nbDuplicates = 0;
+    drawn.clear();
+    filter = declaredFilter ? declaredFilter->clone() : nullptr;
+    return true;
+}
+
+void RandomScenarioBuilderIter::setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter)
+{
+    declaredFilter = std::move(filter);
+}
+
+std::shared_ptr<SemaphoreFilter> RandomScenarioBuilderIter::getSemaphoreFilter()
+{
+    return declaredFilter;
+}
+
+bool RandomScenarioBuilderIter::draw(Scenario &result)
+{
+    if (filter)
+        filter->reset();
+    std::vector<FlatScenarioGraph::NodeIndex> current = graph.getRoots();
+    // The possible moves of a step, as a thread and a child of its node
+    std::vector<std::pair<size_t, FlatScenarioGraph::NodeIndex> > moves;
+    size_t length = static_cast<size_t>((scenarioSize > 0) ? scenarioSize : maxDrawLength);
+    while (result.size() < length) {
+        moves.clear();
+        bool blocked = false;
+        for (size_t i = 0; i < current.size(); i++) {
+            for (size_t j = 0; j < graph.nbChildren(current[i]); j++) {
+                auto child = graph.getChild(current[i], j);
+                if (filter && othersRunning(graph, current, static_cast<int>(i))) {
+                    if (!filter->enter(graph.getSource(child))) {
+                        // The section would block, so this interleaving is a DeadEnd
+                        blocked = true;
+                        continue;
+                    }
+                    filter->leave(graph.getSource(child));
+                }
+                moves.emplace_back(i, child);
+            }
+        }
+        if (moves.empty()) {
+            if (blocked) {
+                filter->reject();
+                return false;
+            }
+            break;
+        }
+        // When all the threads can end here, stopping is one more choice
+        size_t nbChoices = moves.size() + (graph.canStop(current) ? 1 : 0);
+        size_t choice = std::uniform_int_distribution<size_t>(0, nbChoices - 1)(generator);
+        if (choice == moves.size()) {
+            break;
+        }
+        auto move = moves[choice];
+        current[move.first] = move.second;
+        if (filter)
+            filter->enter(graph.getSource(move.second));
+        result.push_back(graph.getPoint(move.second));
+    }
+    return true;
+}
+
+Scenario RandomScenarioBuilderIter::getNext()
+{
+    while (nbReturned < nbScenarios) {
+        nbReturned++;
+        Scenario result;
+        if (!draw(result)) {
+            continue;
+        }
+        if (result.empty()) {
+            // Nothing to play, so no scenario at all
+            nbReturned = nbScenarios;
+            break;
+        }
+        if (!drawn.insert(result).second) {
+            nbDuplicates++;
+            continue;
+        }
+        return result;
+    }
+    return {};
+}
+
+size_t RandomScenarioBuilderIter::getMaxScenariosNb()
+{
+    return nbScenarios;
+}
+
+size_t RandomScenarioBuilderIter::getRemainingScenariosNb()
+{
+    return nbScenarios - nbReturned;
+}
+
+size_t RandomScenarioBuilderIter::getNbPrunedSubtrees()
+{
+    return filter ? filter->getNbRejected() : 0;
+}
@@ -1,8 +1,14 @@
 #ifndef SCENARIOBUILDER_H
 #define SCENARIOBUILDER_H
 
+#include <iostream>
+#include <random>
+
 #include "scenario.h"
 #include "observablethread.h"
+#include "semaphorefilter.h"
+#include "flatscenariograph.h"
+#include "scenariotrie.h"
 /*
 class ScenarioBuilder
 {
@@ -27,6 +33,7 @@ private:
 };
 */
 
+#include <atomic>
 #include <condition_variable>
 
 template<typename T> class BufferN {
@@ -36,6 +43,7 @@ protected:
     std::mutex mutex;
     std::condition_variable waitProd, waitConso;
     bool finished{false};
+    bool cancelled{false};
 
 public:
 
@@ -51,9 +59,12 @@ public:
 
     virtual void put(T item) {
         std::unique_lock<std::mutex> lk(mutex);
-        while (nbElements == bufferSize) {
+        while ((nbElements == bufferSize) && (!cancelled)) {
             waitProd.wait(lk);
         }
+        if (cancelled) {
+            return;
+        }
         elements[writePointer] = item;
         writePointer = (writePointer + 1)
                        % bufferSize;
@@ -67,7 +78,7 @@ public:
         while ((nbElements == 0) && (!finished)) {
             waitConso.wait(lk);
         }
-        if (finished) {
+        if (nbElements == 0) {
             return {};
         }
         item = elements[readPointer];
@@ -83,6 +94,17 @@ public:
         finished = true;
         waitConso.notify_one();
     }
+
+    ///
+    /// \brief Unblocks the producer and drops every further item
+    ///
+    /// Used when the consumer stops before the producer finished.
+    ///
+    virtual void cancel() {
+        std::unique_lock<std::mutex> lk(mutex);
+        cancelled = true;
+        waitProd.notify_all();
+    }
 };
 
 typedef BufferN<Scenario> Buffer;
@@ -97,16 +119,30 @@ public:
 
     void printScenario(std::vector<int> scenario);
 
+    ///
+    /// \brief Sets a filter dropping interleavings in which a section would block
+    /// \param filter The filter, or nullptr to generate all interleavings
+    ///
+    /// The builder works on a clone of the filter, created by generateScenarios().
+    ///
+    void setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter);
+
+    /// Gets the filter given to setSemaphoreFilter(), nullptr if none
+    [[nodiscard]] std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() const { return declaredFilter; }
+
 private:
 
 
     bool build(int thread, int nextPoint);
     void buildVector(int index);
     Scenario current;
-    std::vector<ScenarioGraphNode*> currentthreads;
+    FlatScenarioGraph graph;
+    std::vector<FlatScenarioGraph::NodeIndex> currentthreads;
     int nbThreads{0};
     int scenarioSize{0};
     std::vector<Scenario> result;
+    std::shared_ptr<SemaphoreFilter> declaredFilter{nullptr};
+    std::shared_ptr<SemaphoreFilter> filter{nullptr};
 };
 
 
@@ -122,6 +158,36 @@ public:
 
     bool isFinished();
 
+    ///
+    /// \brief Stops the generation as soon as possible
+    ///
+    void cancel();
+
+    ///
+    /// \brief Sets a filter dropping interleavings in which a section would block
+    /// \param filter The filter, or nullptr to generate all interleavings
+    ///
+    /// The builder works on a clone of the filter, created by cloneFilter().
+    ///
+    void setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter);
+
+    ///
+    /// \brief Creates the clone of the filter used by the next generation
+    ///
+    /// It shall be called before generateScenarios(), by the thread that
+    /// reads getNbRejected().
+    ///
+    void cloneFilter();
+
+    ///
+    /// \brief Gets the number of prefixes rejected by the filter of the current generation
+    /// \return The number of rejected prefixes, 0 without filter
+    ///
+    [[nodiscard]] size_t getNbRejected() const { return filter ? filter->getNbRejected() : 0; }
+
+    /// Gets the filter given to setSemaphoreFilter(), nullptr if none
+    [[nodiscard]] std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() const { return declaredFilter; }
+
     Buffer *buffer{nullptr};
 
 private:
@@ -129,8 +195,11 @@ private:
 
     bool build(int thread, int nextPoint);
     void buildVector(int index);
+    /// Puts the current scenario in the buffer, if it is in the step
+    void putCurrent();
     Scenario current;
-    std::vector<ScenarioGraphNode*> currentthreads;
+    FlatScenarioGraph graph;
+    std::vector<FlatScenarioGraph::NodeIndex> currentthreads;
     int nbThreads{0};
     int scenarioSize{0};
     std::vector<Scenario> result;
@@ -138,6 +207,9 @@ private:
     size_t step{1};
     size_t nextIndex{0};
     size_t currentIndex{0};
+    std::shared_ptr<SemaphoreFilter> declaredFilter{nullptr};
+    std::shared_ptr<SemaphoreFilter> filter{nullptr};
+    std::atomic<bool> cancelled{false};
 };
 
 
@@ -156,6 +228,28 @@ public:
     /// This method shall be called only once, and before any call to getNext().
     ///
     virtual void init(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth) = 0;
+
+    ///
+    /// \brief Initialize the builder for threads not owned by the caller
+    /// \param threads A vector of observable threads, for instance a group of the model threads
+    /// \param depth The depth of scenarios to generate
+    ///
+    /// Same as init(), used by the PcoModelChecker when it creates builders itself.
+    /// The default implementation reports that the builder does not support it.
+    ///
+    /// \return false if the builder cannot be initialized on a subset of threads
+    ///
+    virtual bool initSubset(const std::vector<ObservableThread *> &/*threads*/, int /*depth*/)
+    {
+        std::cout << "This scenario builder does not support initSubset()" << std::endl;
+        return false;
+    }
+
+    ///
+    /// \brief Gets the depth given to init()
+    /// \return The depth of the scenarios, 0 if unknown or unbounded
+    ///
+    virtual int getDepth() { return 0; }
     ///
     /// \brief getNext
     /// \return The next scenario. If the scenario is empty, it means there is no more scenario
@@ -169,6 +263,27 @@ public:
     virtual size_t getMaxScenariosNb() = 0;
 
     virtual size_t getRemainingScenariosNb() = 0;
+
+    ///
+    /// \brief Gets the number of scenarios generated but not yet returned by getNext()
+    /// \return The number of scenarios waiting, 0 for a builder without queue
+    ///
+    virtual size_t getNbQueuedScenarios() { return 0; }
+
+    ///
+    /// \brief Gets the number of subtrees of the scenario space dropped without being generated
+    /// \return The number of pruned prefixes, 0 for a builder that does not prune
+    ///
+    virtual size_t getNbPrunedSubtrees() { return 0; }
+
+    ///
+    /// \brief Gets the filter of the builder
+    /// \return The SemaphoreFilter of the builder, nullptr if it has none
+    ///
+    /// It allows another builder to drop the same interleavings, for instance
+    /// the one sampling the scenarios once the observations are saturated.
+    ///
+    virtual std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() { return nullptr; }
 };
 
 class BruteforceScenarioBuilderIter : public ScenarioBuilderInterface
@@ -187,6 +302,17 @@ class UnoptimizedScenarioBuilderIter : public BruteforceScenarioBuilderIter
 {
 public:
     void init(const std::vector<std::unique_ptr<ObservableThread> >& threads, int depth) override;
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
+
+    ///
+    /// \brief Sets a filter dropping interleavings in which a section would block
+    /// \param filter The filter, or nullptr to generate all interleavings
+    ///
+    /// It shall be called before init().
+    ///
+    void setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter);
+
+    std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() override;
 
 private:
     ScenarioBranchBuilder builder;
@@ -194,12 +320,79 @@ private:
 };
 
 
-class PredefinedScenarioBuilderIter : public BruteforceScenarioBuilderIter
+///
+/// \brief The PredefinedScenarioBuilderIter class
+///
+/// Builder playing a given set of scenarios, for instance a regression set.
+/// The scenarios are stored in a ScenarioTrie: the prefixes they share are
+/// stored once and identical scenarios are dropped. They are played in the
+/// depth-first order of the trie, so that consecutive scenarios share the
+/// longest possible prefixes, which is not the order they were given in.
+///
+class PredefinedScenarioBuilderIter : public ScenarioBuilderInterface
 {
 public:
     void init(const std::vector<std::unique_ptr<ObservableThread> >& /*threads*/, int /*depth*/) override {}
-    void setScenarios(std::vector<Scenario> scenarios);
+    bool initSubset(const std::vector<ObservableThread *> &/*threads*/, int /*depth*/) override { return true; }
+
+    ///
+    /// \brief Sets the scenarios to play
+    /// \param scenarios The scenarios, replacing the previous ones
+    ///
+    void setScenarios(const std::vector<Scenario> &scenarios);
+
+    ///
+    /// \brief Adds a scenario to play
+    /// \param scenario The scenario, ignored if empty
+    ///
+    /// It allows to load a large set without building a vector of all its scenarios.
+    /// The scenarios shall all be added before the first call to getNext().
+    ///
+    void addScenario(const Scenario &scenario);
+
+    Scenario getNext() override;
+    size_t getMaxScenariosNb() override;
+    size_t getRemainingScenariosNb() override;
+
+    /// Gets the number of scenarios given several times, and dropped
+    [[nodiscard]] size_t getNbDuplicates() const { return nbDuplicates; }
+
+    /// Gets the memory a vector of all the scenarios given would use, in bytes
+    [[nodiscard]] size_t getFlatMemoryUsage() const { return flatMemory; }
 
+    /// Gets the memory used by the trie, in bytes
+    [[nodiscard]] size_t getMemoryUsage() const { return trie.memoryUsage(); }
+
+    ///
+    /// \brief Prints the number of duplicates dropped and the memory saved
+    ///
+    void printStorageStats() const;
+
+private:
+
+    /// The scenarios
+    ScenarioTrie trie;
+
+    /// The terminal nodes of the trie, in the order they are played
+    std::vector<uint32_t> order;
+
+    /// Whether order is up to date with the trie
+    bool ordered{true};
+
+    /// The index of the next scenario in order
+    size_t currentIndex{0};
+
+    /// The number of scenarios given, duplicates included
+    size_t nbGiven{0};
+
+    /// The number of points given, duplicates included
+    size_t nbGivenPoints{0};
+
+    /// The number of duplicates dropped
+    size_t nbDuplicates{0};
+
+    /// The memory a vector of all the scenarios given would use
+    size_t flatMemory{0};
 };
 
 
@@ -255,7 +448,8 @@ private:
     bool build(int thread, int nextPoint);
     bool buildVector();
     Scenario current;
-    std::vector<ScenarioGraphNode*> currentthreads;
+    FlatScenarioGraph graph;
+    std::vector<FlatScenarioGraph::NodeIndex> currentthreads;
     size_t nbThreads{0};
     size_t scenarioSize{0};
     std::vector<Scenario> result;
@@ -264,7 +458,7 @@ private:
     std::vector<size_t> int_j;
     std::vector<size_t> int_index;
     std::vector<bool> int_atLeastOneNew;
-    std::vector<ScenarioGraphNode*> int_lastBranch;
+    std::vector<FlatScenarioGraph::NodeIndex> int_lastBranch;
     size_t currentIndex{0};
     size_t nextCurrentIndex{0};
     Scenario currentReady;
@@ -276,6 +470,7 @@ class FlowScenarioBuilderIter : public ScenarioBuilderInterface
 public:
 
     void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override;
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
     Scenario getNext() override;
     size_t getMaxScenariosNb() override;
     size_t getRemainingScenariosNb() override;
@@ -287,6 +482,198 @@ protected:
 
 
 
+///
+/// \brief The PreemptionBoundedScenarioBuilderIter class
+///
+/// This builder enumerates the scenarios in order of increasing number of
+/// preemptions, up to a bound, as CHESS does. A preemption is a switch from
+/// a thread that could still play a section to another thread; switching when
+/// a thread has finished is free. Most concurrency bugs show up with very few
+/// preemptions, so the first bounds give a high bug-finding power in a tiny
+/// fraction of the full space.
+///
+/// The scenarios of a bound are generated when the previous bound is exhausted.
+///
+class PreemptionBoundedScenarioBuilderIter : public ScenarioBuilderInterface
+{
+public:
+
+    ///
+    /// \brief PreemptionBoundedScenarioBuilderIter
+    /// \param maxPreemptions The maximum number of preemptions of a scenario
+    ///
+    /// A negative bound is reported and replaced by 0.
+    ///
+    explicit PreemptionBoundedScenarioBuilderIter(int maxPreemptions);
+
+    void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override;
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
+    Scenario getNext() override;
+    size_t getMaxScenariosNb() override;
+    size_t getRemainingScenariosNb() override;
+
+    ///
+    /// \brief Gets the exact number of scenarios for each bound
+    /// \return A vector whose element i is the number of scenarios with exactly i preemptions
+    ///
+    [[nodiscard]] const std::vector<size_t> &getNbScenariosPerBound() const;
+
+    ///
+    /// \brief Prints the number of scenarios for each bound, and the cumulated ones
+    ///
+    /// Scenarios with more preemptions than the maximum are not counted, so the
+    /// cumulated number equals the number of scenarios of the whole space only
+    /// when the maximum is at least the largest number of preemptions of a scenario.
+    ///
+    void printNbScenariosPerBound() const;
+
+protected:
+
+    ///
+    /// \brief Initializes the builder from the initial node of every thread
+    /// \param nodes The initial nodes
+    /// \param depth The depth of scenarios to generate
+    ///
+    void initNodes(const std::vector<ScenarioGraphNode *> &nodes, int depth);
+
+    ///
+    /// \brief Generates the scenarios having exactly a number of preemptions
+    /// \param index The index of the point to generate
+    /// \param last The thread of the previous point, -1 for the first one
+    /// \param preemptions The number of preemptions so far
+    ///
+    void buildVector(int index, int last, int preemptions);
+
+    /// Maximum number of preemptions
+    int maxPreemptions;
+
+    /// Current bound, that is the exact number of preemptions of the current scenarios
+    int bound{-1};
+
+    /// The flat form of the thread graphs
+    FlatScenarioGraph graph;
+
+    /// The current node of every thread, during the generation
+    std::vector<FlatScenarioGraph::NodeIndex> currentthreads;
+
+    /// Depth of the scenarios
+    int scenarioSize{0};
+
+    /// Scenario being generated
+    Scenario current;
+
+    /// Scenarios of the current bound
+    std::vector<Scenario> scenarios;
+
+    /// Index of the next scenario of the current bound
+    size_t currentIndex{0};
+
+    /// Number of scenarios already returned
+    size_t nbReturned{0};
+
+    /// Number of scenarios for each bound
+    std::vector<size_t> nbPerBound;
+};
+
+
+///
+/// \brief The RandomScenarioBuilderIter class
+///
+/// This builder draws a fixed number of random scenarios. Each scenario is a
+/// random path in the product of the thread graphs: at each step, one of the
+/// children of the current node of every thread is picked with a uniform
+/// probability. A scenario stops at the depth, or earlier when no thread can
+/// advance. A scenario drawn again is skipped, and counted by
+/// getNbDuplicates().
+///
+/// With a SemaphoreFilter, a move in which a section would block while other
+/// threads can still advance is never drawn, as for the exhaustive builders.
+/// If all the moves of a step are such moves, the draw is dropped and counted
+/// as a pruned subtree.
+///
+/// It is used by the PcoModelChecker to sample the rest of the space once the
+/// exhaustive exploration no longer brings new observations.
+///
+class RandomScenarioBuilderIter : public ScenarioBuilderInterface
+{
+public:
+
+    ///
+    /// \brief RandomScenarioBuilderIter
+    /// \param nbScenarios The number of scenarios to draw
+    /// \param seed The seed of the random generator
+    ///
+    explicit RandomScenarioBuilderIter(size_t nbScenarios, unsigned int seed = 0) :
+        nbScenarios(nbScenarios), generator(seed) {}
+
+    void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override;
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
+    Scenario getNext() override;
+    size_t getMaxScenariosNb() override;
+    size_t getRemainingScenariosNb() override;
+    size_t getNbPrunedSubtrees() override;
+    int getDepth() override { return scenarioSize; }
+    std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() override;
+
+    ///
+    /// \brief Sets a filter dropping interleavings in which a section would block
+    /// \param filter The filter, or nullptr to draw among all interleavings
+    ///
+    /// The builder works on a clone of the filter, created by init().
+    ///
+    void setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter);
+
+    /// Gets the number of draws skipped because the scenario had already been drawn
+    [[nodiscard]] size_t getNbDuplicates() const { return nbDuplicates; }
+
+protected:
+
+    ///
+    /// \brief Draws a scenario
+    /// \param result The scenario drawn
+    /// \return false if the draw has been dropped by the filter
+    ///
+    /// Without a depth, the draw stops after maxDrawLength points.
+    ///
+    bool draw(Scenario &result);
+
+    /// Orders the scenarios, to find the ones drawn again
+    struct ScenarioLess {
+        bool operator()(const Scenario &a, const Scenario &b) const;
+    };
+
+    /// Number of scenarios to draw
+    size_t nbScenarios;
+
+    /// Number of scenarios already drawn
+    size_t nbReturned{0};
+
+    /// Number of draws of a scenario already drawn
+    size_t nbDuplicates{0};
+
+    /// The scenarios drawn
+    std::set<Scenario, ScenarioLess> drawn;
+
+    /// The filter given to setSemaphoreFilter(), nullptr if none
+    std::shared_ptr<SemaphoreFilter> declaredFilter{nullptr};
+
+    /// The clone of the filter used by the draws, nullptr if none
+    std::shared_ptr<SemaphoreFilter> filter{nullptr};
+
+    /// Depth of the scenarios, 0 for no bound
+    int scenarioSize{0};
+
+    /// Maximum length of a draw when the depth is not bounded, in case the graphs have cycles
+    static constexpr int maxDrawLength = 1 << 16;
+
+    /// The random generator
+    std::mt19937_64 generator;
+
+    /// The flat form of the thread graphs
+    FlatScenarioGraph graph;
+};
+
+
 class ScenarioBuilderBuffer : public ScenarioBuilderInterface
 {
 public:
@@ -299,17 +686,51 @@ public:
     /// only. It allows to arbitrarily play only a subset of all scenarios.
     /// Mainly useful during debugging.
     ///
-    ScenarioBuilderBuffer(size_t step = 1) : buffer(10), builder(step) {}
+    ScenarioBuilderBuffer(size_t step = 1) : builder(step), buffer(10), step(step) {}
 
     ~ScenarioBuilderBuffer() override {
-        th->join();
+        // The generation may still run if not all scenarios have been consumed
+        builder.cancel();
+        buffer.cancel();
+        if (th) {
+            th->join();
+        }
     }
 
     void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override;
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
     Scenario getNext() override;
+
+    ///
+    /// \brief Gets the number of scenarios of the generation
+    /// \return The number of scenarios
+    ///
+    /// It is counted at the first call, without generating the scenarios, so
+    /// that a run without progress nor metrics does not pay for it. With a
+    /// SemaphoreFilter it is an upper bound, as the rejected prefixes are not
+    /// taken into account. It is 0 if the scenarios are not bounded.
+    ///
     size_t getMaxScenariosNb() override;
     size_t getRemainingScenariosNb() override;
+    size_t getNbQueuedScenarios() override;
+
+    ///
+    /// \brief Gets the number of prefixes rejected by the filter since init()
+    /// \return The number of rejected prefixes, 0 without filter
+    ///
+    size_t getNbPrunedSubtrees() override;
+    int getDepth() override { return depth; }
     bool isFinished();
+
+    ///
+    /// \brief Sets a filter dropping interleavings in which a section would block
+    /// \param filter The filter, or nullptr to generate all interleavings
+    ///
+    /// It shall be called before init(), which clones it.
+    ///
+    void setSemaphoreFilter(std::shared_ptr<SemaphoreFilter> filter);
+
+    std::shared_ptr<SemaphoreFilter> getSemaphoreFilter() override;
 protected:
 
     ScenarioBranchBuilderBuffer builder;
@@ -318,6 +739,31 @@ protected:
 
     std::unique_ptr<std::thread> th;
 
+    /// Depth given to init(), 0 for no bound
+    int depth{0};
+
+private:
+
+    ///
+    /// \brief Counts the scenarios to be generated, if not done yet
+    ///
+    void countScenarios();
+
+    /// Interval between two scenarios played
+    size_t step{1};
+
+    /// The first node of each thread, kept to count the scenarios
+    std::vector<ScenarioGraphNode *> nodes;
+
+    /// Whether nbScenarios has been counted since init()
+    bool counted{false};
+
+    /// Number of scenarios of the generation
+    size_t nbScenarios{0};
+
+    /// Number of scenarios returned by getNext()
+    size_t nbReturned{0};
+
 };
 
 
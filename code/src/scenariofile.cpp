@@ -0,0 +1,230 @@
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scenariofile.h"
+
+
+bool ScenarioFileWriter::open(const std::string &fileName, const std::vector<ObservableThread *> &threads)
+{
+    std::vector<std::string> threadIds;
+    for (auto thread : threads) {
+        threadIds.push_back(thread->getId());
+    }
+    bool result = open(fileName, threadIds);
+    this->threads = threads;
+    return result;
+}
+
+bool ScenarioFileWriter::open(const std::string &fileName, const std::vector<std::string> &threadIds)
+{
+    threads.clear();
+    nbScenarios = 0;
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+
+    ScenarioFileHeader header{};
+    std::memcpy(header.magic, scenarioFileMagic, sizeof(header.magic));
+    header.version = scenarioFileVersion;
+    header.nbThreads = static_cast<uint32_t>(threadIds.size());
+    uint64_t offset = sizeof(ScenarioFileHeader);
+    for (const auto &id : threadIds) {
+        offset += sizeof(uint16_t) + id.size();
+    }
+    header.recordsOffset = (offset + 3) & ~static_cast<uint64_t>(3);
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const auto &id : threadIds) {
+        auto length = static_cast<uint16_t>(id.size());
+        file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        file.write(id.data(), length);
+    }
+    const char padding[4] = {0, 0, 0, 0};
+    file.write(padding, static_cast<std::streamsize>(header.recordsOffset - offset));
+    return static_cast<bool>(file);
+}
+
+bool ScenarioFileWriter::write(const Scenario &scenario)
+{
+    points.clear();
+    for (const auto &point : scenario) {
+        uint16_t index = 0;
+        while ((index < threads.size()) && (threads[index] != point.thread)) {
+            index++;
+        }
+        if (index == threads.size()) {
+            return false;
+        }
+        points.push_back(ScenarioFilePoint{index, 0, point.number});
+    }
+    writePoints(points.data(), static_cast<uint32_t>(points.size()));
+    return true;
+}
+
+void ScenarioFileWriter::writePoints(const ScenarioFilePoint *points, uint32_t nbPoints)
+{
+    file.write(reinterpret_cast<const char *>(&nbPoints), sizeof(nbPoints));
+    file.write(reinterpret_cast<const char *>(points), static_cast<std::streamsize>(nbPoints * sizeof(ScenarioFilePoint)));
+    nbScenarios++;
+}
+
+size_t ScenarioFileWriter::writeAll(ScenarioBuilderInterface *builder)
+{
+    size_t result = 0;
+    for (Scenario scenario = builder->getNext(); !scenario.empty(); scenario = builder->getNext()) {
+        if (write(scenario)) {
+            result++;
+        }
+    }
+    return result;
+}
+
+void ScenarioFileWriter::finish()
+{
+    if (!file.is_open()) {
+        return;
+    }
+    file.seekp(offsetof(ScenarioFileHeader, nbScenarios));
+    file.write(reinterpret_cast<const char *>(&nbScenarios), sizeof(nbScenarios));
+    file.close();
+}
+
+
+FileScenarioBuilderIter::~FileScenarioBuilderIter()
+{
+    close();
+}
+
+void FileScenarioBuilderIter::close()
+{
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+        data = nullptr;
+    }
+    size = 0;
+    threadIds.clear();
+    threads.clear();
+}
+
+bool FileScenarioBuilderIter::open(const std::string &fileName)
+{
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status{};
+    if ((fstat(fd, &status) != 0) || (static_cast<size_t>(status.st_size) < sizeof(ScenarioFileHeader))) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(status.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const char *>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    std::memcpy(&header, data, sizeof(header));
+    if ((std::memcmp(header.magic, scenarioFileMagic, sizeof(header.magic)) != 0) ||
+        (header.version != scenarioFileVersion) || (header.recordsOffset > size)) {
+        close();
+        return false;
+    }
+    size_t position = sizeof(ScenarioFileHeader);
+    for (uint32_t t = 0; t < header.nbThreads; t++) {
+        uint16_t length = 0;
+        if (position + sizeof(length) > header.recordsOffset) {
+            close();
+            return false;
+        }
+        std::memcpy(&length, data + position, sizeof(length));
+        position += sizeof(length);
+        if (position + length > header.recordsOffset) {
+            close();
+            return false;
+        }
+        threadIds.emplace_back(data + position, length);
+        position += length;
+    }
+    threads.assign(threadIds.size(), nullptr);
+    offset = header.recordsOffset;
+    nbRead = 0;
+    nbSkipped = 0;
+    return true;
+}
+
+void FileScenarioBuilderIter::init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth)
+{
+    std::vector<ObservableThread *> pointers;
+    for (const auto &thread : threads) {
+        pointers.push_back(thread.get());
+    }
+    initSubset(pointers, depth);
+}
+
+bool FileScenarioBuilderIter::initSubset(const std::vector<ObservableThread *> &threads, int /*depth*/)
+{
+    this->threads.assign(threadIds.size(), nullptr);
+    for (size_t t = 0; t < threadIds.size(); t++) {
+        for (auto thread : threads) {
+            if (thread->getId() == threadIds[t]) {
+                this->threads[t] = thread;
+            }
+        }
+    }
+    offset = header.recordsOffset;
+    nbRead = 0;
+    nbSkipped = 0;
+    return true;
+}
+
+Scenario FileScenarioBuilderIter::getNext()
+{
+    while ((data != nullptr) && (nbRead < header.nbScenarios) && (offset + sizeof(uint32_t) <= size)) {
+        uint32_t length = 0;
+        std::memcpy(&length, data + offset, sizeof(length));
+        auto points = reinterpret_cast<const ScenarioFilePoint *>(data + offset + sizeof(length));
+        size_t next = offset + sizeof(length) + static_cast<size_t>(length) * sizeof(ScenarioFilePoint);
+        if (next > size) {
+            // Truncated file
+            break;
+        }
+        offset = next;
+        nbRead++;
+
+        Scenario scenario;
+        scenario.reserve(length);
+        for (uint32_t i = 0; i < length; i++) {
+            if ((points[i].thread >= threads.size()) || (threads[points[i].thread] == nullptr)) {
+                scenario.clear();
+                break;
+            }
+            scenario.push_back(ScenarioPoint{threads[points[i].thread], points[i].number});
+        }
+        if (!scenario.empty()) {
+            return scenario;
+        }
+        nbSkipped++;
+    }
+    return Scenario();
+}
+
+size_t FileScenarioBuilderIter::getMaxScenariosNb()
+{
+    return (data == nullptr) ? 0 : header.nbScenarios;
+}
+
+size_t FileScenarioBuilderIter::getRemainingScenariosNb()
+{
+    return getMaxScenariosNb() - nbRead;
+}
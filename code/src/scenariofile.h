@@ -0,0 +1,225 @@
+#ifndef SCENARIOFILE_H
+#define SCENARIOFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "scenariobuilder.h"
+
+///
+/// \brief Header of a scenario file
+///
+/// A scenario file is made of, in native byte order:
+///
+/// - this header;
+/// - the thread table: for each thread, the length of its id on 16 bits and
+///   the characters of the id;
+/// - padding up to recordsOffset, a multiple of 4;
+/// - the scenarios, each one being its number of points on 32 bits followed
+///   by its points, as ScenarioFilePoint.
+///
+/// The points refer to the threads by their index in the table, so that a
+/// file can be replayed by any model whose threads have the same ids.
+///
+typedef struct {
+    /// "PCOSCEN" and a null character
+    char magic[8];
+    /// Version of the format
+    uint32_t version;
+    /// Number of threads in the thread table
+    uint32_t nbThreads;
+    /// Number of scenarios
+    uint64_t nbScenarios;
+    /// Offset of the first scenario from the start of the file
+    uint64_t recordsOffset;
+} ScenarioFileHeader;
+
+///
+/// \brief A scenario point in a scenario file
+///
+typedef struct {
+    /// Index of the thread in the thread table
+    uint16_t thread;
+    /// Unused, 0
+    uint16_t reserved;
+    /// Section number
+    int32_t number;
+} ScenarioFilePoint;
+
+/// Magic string of the scenario files
+constexpr char scenarioFileMagic[8] = "PCOSCEN";
+
+/// Current version of the scenario file format
+constexpr uint32_t scenarioFileVersion = 1;
+
+///
+/// \brief The ScenarioFileWriter class
+///
+/// Writes scenarios to a scenario file, as they come. The number of
+/// scenarios is written in the header by finish().
+///
+/// Typical use, to export all the scenarios of a builder:
+///
+/// \code{cpp}
+/// ScenarioFileWriter writer;
+/// writer.open("corpus.scn", threads);
+/// writer.writeAll(builder);
+/// writer.finish();
+/// \endcode
+///
+class ScenarioFileWriter
+{
+public:
+
+    ///
+    /// \brief Creates the file and writes the thread table
+    /// \param fileName The name of the file
+    /// \param threads The threads the scenarios may refer to
+    /// \return true if the file could be created, false else
+    ///
+    bool open(const std::string &fileName, const std::vector<ObservableThread *> &threads);
+
+    ///
+    /// \brief Creates the file and writes the thread table, without threads to refer to
+    /// \param fileName The name of the file
+    /// \param threadIds The ids of the threads of the table
+    /// \return true if the file could be created, false else
+    ///
+    /// Only writePoints() can then be used, for instance by a tool copying
+    /// scenarios stored with the same thread table.
+    ///
+    bool open(const std::string &fileName, const std::vector<std::string> &threadIds);
+
+    ///
+    /// \brief Writes a scenario
+    /// \param scenario The scenario
+    /// \return false if a point refers to a thread not given to open(), true else
+    ///
+    bool write(const Scenario &scenario);
+
+    ///
+    /// \brief Writes a scenario given as points of the file format
+    /// \param points The points, referring to the threads by their index in the table
+    /// \param nbPoints The number of points
+    ///
+    void writePoints(const ScenarioFilePoint *points, uint32_t nbPoints);
+
+    ///
+    /// \brief Writes all the remaining scenarios of a builder
+    /// \param builder The initialized builder
+    /// \return The number of scenarios written
+    ///
+    size_t writeAll(ScenarioBuilderInterface *builder);
+
+    ///
+    /// \brief Writes the number of scenarios in the header and closes the file
+    ///
+    void finish();
+
+    /// Gets the number of scenarios written
+    [[nodiscard]] uint64_t getNbScenarios() const { return nbScenarios; }
+
+private:
+
+    /// The file
+    std::ofstream file;
+
+    /// The threads, in the order of the table
+    std::vector<ObservableThread *> threads;
+
+    /// The number of scenarios written
+    uint64_t nbScenarios{0};
+
+    /// The points of the scenario being written
+    std::vector<ScenarioFilePoint> points;
+};
+
+
+///
+/// \brief The FileScenarioBuilderIter class
+///
+/// Builder playing the scenarios of a scenario file. The file is mapped in
+/// memory and the scenarios are read in place, so opening a file takes the
+/// same time whatever its size. The threads of the file are matched with
+/// the threads of the model by their id, in init().
+///
+/// Typical use, in PcoModel::build():
+///
+/// \code{cpp}
+/// auto builder = std::make_unique<FileScenarioBuilderIter>();
+/// builder->open("corpus.scn");
+/// builder->init(threads, 0);
+/// scenarioBuilder = std::move(builder);
+/// \endcode
+///
+class FileScenarioBuilderIter : public ScenarioBuilderInterface
+{
+public:
+
+    FileScenarioBuilderIter() = default;
+    ~FileScenarioBuilderIter() override;
+
+    FileScenarioBuilderIter(const FileScenarioBuilderIter &) = delete;
+    FileScenarioBuilderIter &operator=(const FileScenarioBuilderIter &) = delete;
+
+    ///
+    /// \brief Maps a scenario file
+    /// \param fileName The name of the file
+    /// \return true if the file is a scenario file of a supported version, false else
+    ///
+    bool open(const std::string &fileName);
+
+    ///
+    /// \brief Matches the threads of the file with the threads of the model
+    /// \param threads The threads of the model
+    ///
+    /// The depth is not used. The scenarios referring to a thread of the file
+    /// that is not in threads are skipped.
+    ///
+    void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override;
+
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override;
+
+    Scenario getNext() override;
+    size_t getMaxScenariosNb() override;
+    size_t getRemainingScenariosNb() override;
+
+    /// Gets the number of scenarios skipped because of an unknown thread
+    [[nodiscard]] size_t getNbSkipped() const { return nbSkipped; }
+
+    /// Gets the ids of the threads of the file
+    [[nodiscard]] const std::vector<std::string> &getThreadIds() const { return threadIds; }
+
+private:
+
+    /// Unmaps the file
+    void close();
+
+    /// The mapped file
+    const char *data{nullptr};
+
+    /// The size of the mapped file
+    size_t size{0};
+
+    /// The header of the file
+    ScenarioFileHeader header{};
+
+    /// The ids of the threads of the file
+    std::vector<std::string> threadIds;
+
+    /// The model thread of each thread of the file, nullptr if none
+    std::vector<ObservableThread *> threads;
+
+    /// Offset of the next scenario
+    size_t offset{0};
+
+    /// Number of scenarios already read
+    size_t nbRead{0};
+
+    /// Number of scenarios skipped
+    size_t nbSkipped{0};
+};
+
+#endif // SCENARIOFILE_H
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "scenariographrecorder.h"
+
+
+void ScenarioGraphRecorder::record(const ObservableThread *thread, const std::vector<int> &sections)
+{
+    auto &record = records[thread];
+    record.sequences.insert(sections);
+    record.nbRecordings++;
+}
+
+std::vector<ScenarioGraphNode *> ScenarioGraphRecorder::createChildren(std::set<std::vector<int> >::const_iterator begin,
+                                                                      std::set<std::vector<int> >::const_iterator end,
+                                                                      size_t length, const ObservableThread *thread,
+                                                                      ScenarioGraph &graph, NodeRegistry &registry)
+{
+    // The sequences are sorted, so the ones sharing the next section are
+    // contiguous, the one ending with it first
+    std::vector<ScenarioGraphNode *> children;
+    auto it = begin;
+    while (it != end) {
+        int section = (*it)[length];
+        auto groupEnd = it;
+        while ((groupEnd != end) && ((*groupEnd)[length] == section)) {
+            groupEnd++;
+        }
+        auto longer = it;
+        if (longer->size() == length + 1) {
+            // The thread may end after this section
+            longer++;
+        }
+        std::vector<ScenarioGraphNode *> next;
+        if (longer != groupEnd) {
+            next = createChildren(longer, groupEnd, length + 1, thread, graph, registry);
+        }
+        // A single node, that may also end the thread, rather than a leaf
+        // twin: the builders would generate the same scenario from both
+        bool mayEnd = (longer != it) && !next.empty();
+        auto &node = registry[{section, mayEnd, next}];
+        if (!node) {
+            node = graph.createNode(thread, section);
+            node->next = next;
+            node->mayEnd = mayEnd;
+        }
+        children.push_back(node);
+        it = groupEnd;
+    }
+    return children;
+}
+
+std::unique_ptr<ScenarioGraph> ScenarioGraphRecorder::createGraph(const ObservableThread *thread) const
+{
+    auto graph = std::make_unique<ScenarioGraph>();
+    auto first = graph->createNode(thread, -1);
+    graph->setInitialNode(first);
+
+    auto it = records.find(thread);
+    if (it == records.end()) {
+        return graph;
+    }
+
+    // The initial node never ends the thread, as an empty scenario means that
+    // there is none, so a thread that may play no section at all is only
+    // represented if it never plays any
+    auto begin = it->second.sequences.begin();
+    if ((begin != it->second.sequences.end()) && begin->empty()) {
+        begin++;
+    }
+    NodeRegistry registry;
+    first->next = createChildren(begin, it->second.sequences.end(), 0, thread, *graph, registry);
+    return graph;
+}
+
+size_t ScenarioGraphRecorder::getNbRecordings(const ObservableThread *thread) const
+{
+    auto it = records.find(thread);
+    return (it == records.end()) ? 0 : it->second.nbRecordings;
+}
+
+size_t ScenarioGraphRecorder::getNbDistinctSequences(const ObservableThread *thread) const
+{
+    auto it = records.find(thread);
+    return (it == records.end()) ? 0 : it->second.sequences.size();
+}
+
+size_t ScenarioGraphRecorder::getMaxLength(const ObservableThread *thread) const
+{
+    auto it = records.find(thread);
+    size_t result = 0;
+    if (it != records.end()) {
+        for (const auto &sequence : it->second.sequences) {
+            result = std::max(result, sequence.size());
+        }
+    }
+    return result;
+}
+
+size_t ScenarioGraphRecorder::getNbSections(const ObservableThread *thread) const
+{
+    auto it = records.find(thread);
+    if (it == records.end()) {
+        return 0;
+    }
+    std::set<int> sections;
+    for (const auto &sequence : it->second.sequences) {
+        sections.insert(sequence.begin(), sequence.end());
+    }
+    return sections.size();
+}
@@ -0,0 +1,121 @@
+#ifndef SCENARIOGRAPHRECORDER_H
+#define SCENARIOGRAPHRECORDER_H
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "scenario.h"
+
+///
+/// \brief The ScenarioGraphRecorder class
+///
+/// This class infers the scenario graph of threads from the sequences of
+/// sections they played, for instance recorded by a RecordingAnalyzer.
+/// The distinct sequences of a thread are stored in a prefix tree, whose
+/// equivalent suffixes are then merged, as in a minimal acyclic automaton:
+/// two nodes are merged when they have the same section number, the same
+/// children and may both end the thread or not. The graph accepts exactly the recorded sequences, and has no
+/// cycle, even if the thread runs a loop.
+///
+/// A thread that may either end after a section or play other sections
+/// gets a single node for this section, with the following sections as
+/// children and ScenarioGraphNode::mayEnd set. A section can still have
+/// several nodes, followed by different sections, and ScenarioGraph::findNode()
+/// only returns one of them.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ScenarioGraphRecorder recorder;
+/// recorder.record(thread, {1, 2, 3});
+/// recorder.record(thread, {1, 3});
+/// thread->setScenarioGraph(recorder.createGraph(thread));
+/// \endcode
+///
+class ScenarioGraphRecorder
+{
+public:
+
+    ///
+    /// \brief Records a sequence of sections played by a thread
+    /// \param thread The thread
+    /// \param sections The section numbers, in the order they were started
+    ///
+    void record(const ObservableThread *thread, const std::vector<int> &sections);
+
+    ///
+    /// \brief Creates the graph inferred for a thread
+    /// \param thread The thread
+    /// \return The graph, with an initial node numbered -1
+    ///
+    /// The children of each node are sorted by section number, so that the
+    /// graph does not depend on the order of the recordings.
+    ///
+    std::unique_ptr<ScenarioGraph> createGraph(const ObservableThread *thread) const;
+
+    ///
+    /// \brief Gets the number of sequences recorded for a thread
+    /// \param thread The thread
+    /// \return The number of calls to record() for the thread
+    ///
+    [[nodiscard]] size_t getNbRecordings(const ObservableThread *thread) const;
+
+    ///
+    /// \brief Gets the number of distinct sequences recorded for a thread
+    /// \param thread The thread
+    /// \return The number of distinct sequences
+    ///
+    [[nodiscard]] size_t getNbDistinctSequences(const ObservableThread *thread) const;
+
+    ///
+    /// \brief Gets the length of the longest sequence recorded for a thread
+    /// \param thread The thread
+    /// \return The number of sections of the longest sequence
+    ///
+    [[nodiscard]] size_t getMaxLength(const ObservableThread *thread) const;
+
+    ///
+    /// \brief Gets the number of distinct sections recorded for a thread
+    /// \param thread The thread
+    /// \return The number of distinct section numbers of the sequences
+    ///
+    [[nodiscard]] size_t getNbSections(const ObservableThread *thread) const;
+
+private:
+
+    /// The graph nodes merged so far, by section number, possible end of the thread and children
+    typedef std::map<std::tuple<int, bool, std::vector<ScenarioGraphNode *> >, ScenarioGraphNode *> NodeRegistry;
+
+    ///
+    /// \brief Creates the nodes following a common prefix of sequences
+    /// \param begin The first sequence having the prefix
+    /// \param end The end of the sequences having the prefix
+    /// \param length The length of the prefix
+    /// \param thread The thread
+    /// \param graph The graph owning the nodes
+    /// \param registry The nodes already created, to be shared
+    /// \return The children of the last node of the prefix, sorted
+    ///
+    /// The sequences shall be sorted and distinct, and all be longer than the prefix.
+    ///
+    static std::vector<ScenarioGraphNode *> createChildren(std::set<std::vector<int> >::const_iterator begin,
+                                                           std::set<std::vector<int> >::const_iterator end,
+                                                           size_t length, const ObservableThread *thread,
+                                                           ScenarioGraph &graph, NodeRegistry &registry);
+
+    /// What is recorded for a thread
+    typedef struct {
+        /// The distinct sequences
+        std::set<std::vector<int> > sequences;
+        /// The number of sequences recorded
+        size_t nbRecordings{0};
+    } ThreadRecord;
+
+    /// The recordings of each thread
+    std::map<const ObservableThread *, ThreadRecord> records;
+};
+
+#endif // SCENARIOGRAPHRECORDER_H
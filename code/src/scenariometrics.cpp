@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+#include "scenariometrics.h"
+
+
+int LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < subBuckets) {
+        return static_cast<int>(value);
+    }
+    // Position of the highest bit, at least 4
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - 4;
+    return subBuckets * shift + static_cast<int>(value >> shift);
+}
+
+uint64_t LatencyHistogram::highestOf(int bucket)
+{
+    if (bucket < subBuckets) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int shift = bucket / subBuckets - 1;
+    uint64_t top = static_cast<uint64_t>(bucket % subBuckets + subBuckets);
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    buckets[bucketOf(value)]++;
+    count++;
+    sum += value;
+    if (value < min) {
+        min = value;
+    }
+    if (value > max) {
+        max = value;
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    for (int i = 0; i < nbBuckets; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.min < min) {
+        min = other.min;
+    }
+    if (other.max > max) {
+        max = other.max;
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count) + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t cumulated = 0;
+    for (int i = 0; i < nbBuckets; i++) {
+        cumulated += buckets[i];
+        if (cumulated >= rank) {
+            return std::min(highestOf(i), max);
+        }
+    }
+    return max;
+}
+
+
+void ScenarioMetrics::record(PcoConcurrencyAnalyzer::EndingStatus status, const ScenarioTimings &timings)
+{
+    auto &metrics = histograms[status];
+    metrics[static_cast<size_t>(Metric::Start)].record(timings.startNs);
+    metrics[static_cast<size_t>(Metric::Wait)].record(timings.waitNs);
+    metrics[static_cast<size_t>(Metric::Handoffs)].record(timings.handoffs);
+    metrics[static_cast<size_t>(Metric::Teardown)].record(timings.teardownNs);
+    metrics[static_cast<size_t>(Metric::Wall)].record(timings.wallNs);
+}
+
+const LatencyHistogram &ScenarioMetrics::getHistogram(PcoConcurrencyAnalyzer::EndingStatus status, Metric metric) const
+{
+    static const LatencyHistogram empty;
+    auto it = histograms.find(status);
+    if (it == histograms.end()) {
+        return empty;
+    }
+    return it->second[static_cast<size_t>(metric)];
+}
+
+void ScenarioMetrics::clear()
+{
+    histograms.clear();
+}
+
+void ScenarioMetrics::print() const
+{
+    static const char *metricNames[] = {"start (ns)", "wait (ns)", "handoffs", "teardown (ns)", "wall (ns)"};
+    for (const auto &status : histograms) {
+        std::cout << "Metrics : " << PcoConcurrencyAnalyzer::toString(status.first) << " : "
+                  << status.second[0].getCount() << " scenarios" << std::endl;
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-14s %12s %12s %12s %12s %12s", "", "mean", "p50", "p90", "p99", "max");
+        std::cout << line << std::endl;
+        for (size_t m = 0; m < nbMetrics; m++) {
+            const auto &histogram = status.second[m];
+            std::snprintf(line, sizeof(line), "  %-14s %12.0f %12llu %12llu %12llu %12llu", metricNames[m],
+                          histogram.getMean(), static_cast<unsigned long long>(histogram.percentile(50)),
+                          static_cast<unsigned long long>(histogram.percentile(90)),
+                          static_cast<unsigned long long>(histogram.percentile(99)),
+                          static_cast<unsigned long long>(histogram.getMax()));
+            std::cout << line << std::endl;
+        }
+    }
+}
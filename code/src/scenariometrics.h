@@ -0,0 +1,158 @@
+#ifndef SCENARIOMETRICS_H
+#define SCENARIOMETRICS_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief The LatencyHistogram class
+///
+/// Histogram of non-negative integer values with a bounded relative error, in
+/// the manner of HdrHistogram: each power of two is split in 16 buckets, so a
+/// value is known within 1/16 of itself, from 0 up to 2^64 - 1, in a fixed
+/// array of counters. Recording a value is a few integer operations.
+///
+class LatencyHistogram
+{
+public:
+
+    ///
+    /// \brief Records a value
+    /// \param value The value
+    ///
+    void record(uint64_t value);
+
+    ///
+    /// \brief Adds the values of another histogram
+    /// \param other The other histogram
+    ///
+    void merge(const LatencyHistogram &other);
+
+    ///
+    /// \brief Gets a percentile of the recorded values
+    /// \param p The percentile, between 0 and 100
+    /// \return The highest value of the bucket holding the percentile, 0 if there is no value
+    ///
+    [[nodiscard]] uint64_t percentile(double p) const;
+
+    /// Gets the number of values recorded
+    [[nodiscard]] uint64_t getCount() const { return count; }
+
+    /// Gets the smallest value recorded, 0 if there is no value
+    [[nodiscard]] uint64_t getMin() const { return (count == 0) ? 0 : min; }
+
+    /// Gets the largest value recorded
+    [[nodiscard]] uint64_t getMax() const { return max; }
+
+    /// Gets the mean of the values recorded
+    [[nodiscard]] double getMean() const { return (count == 0) ? 0.0 : static_cast<double>(sum) / static_cast<double>(count); }
+
+private:
+
+    /// Number of buckets per power of two
+    static constexpr int subBuckets = 16;
+
+    /// Number of buckets, enough for any 64-bit value
+    static constexpr int nbBuckets = subBuckets * 61;
+
+    /// Gets the bucket of a value
+    static int bucketOf(uint64_t value);
+
+    /// Gets the highest value of a bucket
+    static uint64_t highestOf(int bucket);
+
+    /// The counters
+    std::array<uint64_t, nbBuckets> buckets{};
+
+    /// Number of values
+    uint64_t count{0};
+
+    /// Sum of the values
+    uint64_t sum{0};
+
+    /// Smallest value
+    uint64_t min{UINT64_MAX};
+
+    /// Largest value
+    uint64_t max{0};
+};
+
+///
+/// \brief Timings of a scenario run
+///
+typedef struct {
+    /// Time to start the threads, in nanoseconds
+    uint64_t startNs;
+    /// Time spent by the threads waiting for their turn in the analyzer, in nanoseconds
+    uint64_t waitNs;
+    /// Number of handoffs, that is of scenario points played
+    uint64_t handoffs;
+    /// Time between the end of the scenario in the analyzer and the last join, in nanoseconds
+    uint64_t teardownNs;
+    /// Time to run the scenario, from the creation of the analyzer to the end of postRun(), in nanoseconds
+    uint64_t wallNs;
+} ScenarioTimings;
+
+///
+/// \brief The ScenarioMetrics class
+///
+/// Aggregates the ScenarioTimings of the scenarios in one LatencyHistogram
+/// per metric and per ending status, so that the cost of the scenarios that
+/// end with a DeadEnd can be told apart from the others.
+///
+/// It is filled by the PcoModelChecker when enabled with
+/// PcoModelChecker::setMetrics(), and printed at the end of the run.
+///
+class ScenarioMetrics
+{
+public:
+
+    ///
+    /// \brief The measured metrics
+    ///
+    enum class Metric {
+        Start,
+        Wait,
+        Handoffs,
+        Teardown,
+        Wall
+    };
+
+    ///
+    /// \brief Records the timings of a scenario
+    /// \param status The ending status of the scenario
+    /// \param timings The timings
+    ///
+    void record(PcoConcurrencyAnalyzer::EndingStatus status, const ScenarioTimings &timings);
+
+    ///
+    /// \brief Gets the histogram of a metric
+    /// \param status The ending status
+    /// \param metric The metric
+    /// \return The histogram, empty if no scenario ended with status
+    ///
+    [[nodiscard]] const LatencyHistogram &getHistogram(PcoConcurrencyAnalyzer::EndingStatus status, Metric metric) const;
+
+    ///
+    /// \brief Forgets all the recorded scenarios
+    ///
+    void clear();
+
+    ///
+    /// \brief Prints count, mean, percentiles and max of every metric, per ending status
+    ///
+    void print() const;
+
+private:
+
+    /// Number of metrics
+    static constexpr size_t nbMetrics = 5;
+
+    /// The histograms of each ending status
+    std::map<PcoConcurrencyAnalyzer::EndingStatus, std::array<LatencyHistogram, nbMetrics> > histograms;
+};
+
+#endif // SCENARIOMETRICS_H
@@ -0,0 +1,65 @@
+#include <cmath>
+
+#include "scenariospaceestimator.h"
+
+
+ScenarioSpaceEstimator::ScenarioSpaceEstimator(const std::vector<ScenarioGraphNode *> &firstNodes) :
+    graph(firstNodes)
+{
+}
+
+double ScenarioSpaceEstimator::probe(int depth, std::mt19937_64 &generator) const
+{
+    std::vector<FlatScenarioGraph::NodeIndex> current = graph.getRoots();
+    int length = (depth > 0) ? depth : maxProbeLength;
+    double result = 1.0;
+    for (int step = 0; step < length; step++) {
+        uint32_t nbMoves = 0;
+        for (auto node : current) {
+            nbMoves += graph.nbChildren(node);
+        }
+        if (nbMoves == 0) {
+            break;
+        }
+        // When all the threads can end here, stopping is one more branch
+        uint32_t nbBranches = nbMoves + (graph.canStop(current) ? 1 : 0);
+        result *= nbBranches;
+        uint32_t move = std::uniform_int_distribution<uint32_t>(0, nbBranches - 1)(generator);
+        if (move == nbMoves) {
+            break;
+        }
+        for (auto &node : current) {
+            if (move < graph.nbChildren(node)) {
+                node = graph.getChild(node, move);
+                break;
+            }
+            move -= graph.nbChildren(node);
+        }
+    }
+    return result;
+}
+
+ScenarioSpaceEstimate ScenarioSpaceEstimator::estimate(int depth, size_t nbProbes, unsigned int seed) const
+{
+    ScenarioSpaceEstimate result{0.0, 0.0, 0.0, nbProbes, 0.0, 0.0};
+    if (nbProbes == 0) {
+        return result;
+    }
+    std::mt19937_64 generator(seed);
+    // Welford's online mean and variance
+    double mean = 0.0;
+    double m2 = 0.0;
+    for (size_t i = 1; i <= nbProbes; i++) {
+        double value = probe(depth, generator);
+        double delta = value - mean;
+        mean += delta / static_cast<double>(i);
+        m2 += delta * (value - mean);
+    }
+    result.nbScenarios = mean;
+    if (nbProbes > 1) {
+        // Variance of the mean of the probes
+        result.variance = m2 / static_cast<double>(nbProbes - 1) / static_cast<double>(nbProbes);
+    }
+    result.standardError = std::sqrt(result.variance);
+    return result;
+}
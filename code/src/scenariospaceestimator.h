@@ -0,0 +1,86 @@
+#ifndef SCENARIOSPACEESTIMATOR_H
+#define SCENARIOSPACEESTIMATOR_H
+
+#include <random>
+#include <vector>
+
+#include "flatscenariograph.h"
+
+///
+/// \brief Estimation of the size of a scenario space and of the time to run it
+///
+typedef struct {
+    /// Estimated number of scenarios
+    double nbScenarios;
+    /// Variance of the estimation
+    double variance;
+    /// Standard error of the estimation, the square root of the variance
+    double standardError;
+    /// Number of random probes
+    size_t nbProbes;
+    /// Measured mean duration of a scenario, in seconds, 0 if not calibrated
+    double secondsPerScenario;
+    /// Estimated duration of the whole run, in seconds, 0 if not calibrated
+    double eta;
+} ScenarioSpaceEstimate;
+
+///
+/// \brief The ScenarioSpaceEstimator class
+///
+/// This class estimates the number of scenarios the builders would generate
+/// from the scenario graphs of several threads, without enumerating them,
+/// with Knuth's random probe estimator. A probe follows a random path in the
+/// product of the graphs: at each step, it counts the possible moves, that
+/// is the children of the current node of every thread, and picks one at
+/// random. The product of the counts along the path is an unbiased
+/// estimation of the number of scenarios, and the mean over the probes
+/// converges to it.
+///
+/// As for the builders, a scenario stops at the depth, or earlier when no
+/// thread can advance. A SemaphoreFilter is not taken into account, so the
+/// estimation is an upper bound for a filtering builder.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ScenarioSpaceEstimator estimator(firstNodes);
+/// ScenarioSpaceEstimate estimate = estimator.estimate(12, 10000);
+/// \endcode
+///
+class ScenarioSpaceEstimator
+{
+public:
+
+    ///
+    /// \brief ScenarioSpaceEstimator constructor
+    /// \param firstNodes The initial node of each thread graph
+    ///
+    explicit ScenarioSpaceEstimator(const std::vector<ScenarioGraphNode *> &firstNodes);
+
+    ///
+    /// \brief Estimates the number of scenarios
+    /// \param depth The depth of the scenarios, 0 for no bound
+    /// \param nbProbes The number of random probes
+    /// \param seed The seed of the random generator
+    /// \return The estimation, not calibrated
+    ///
+    [[nodiscard]] ScenarioSpaceEstimate estimate(int depth, size_t nbProbes, unsigned int seed = 0) const;
+
+private:
+
+    ///
+    /// \brief Follows a random path
+    /// \param depth The depth of the scenarios, 0 for no bound
+    /// \param generator The random generator
+    /// \return The product of the number of possible moves along the path
+    ///
+    double probe(int depth, std::mt19937_64 &generator) const;
+
+    /// Maximum length of a probe when the depth is not bounded, in case the graphs have cycles
+    static constexpr int maxProbeLength = 1 << 16;
+
+    /// The graphs of the threads
+    FlatScenarioGraph graph;
+};
+
+#endif // SCENARIOSPACEESTIMATOR_H
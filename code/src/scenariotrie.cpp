@@ -0,0 +1,135 @@
+#include <algorithm>
+
+#include "scenariotrie.h"
+
+
+ScenarioTrie::ScenarioTrie()
+{
+    clear();
+}
+
+void ScenarioTrie::clear()
+{
+    nodes.clear();
+    nodes.push_back(TrieNode{0, 0, 0, -1, noThread, false});
+    threads.clear();
+    nbScenarios = 0;
+}
+
+uint16_t ScenarioTrie::findThread(const ObservableThread *thread) const
+{
+    for (size_t i = 0; i < threads.size(); i++) {
+        if (threads[i] == thread) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    return noThread;
+}
+
+uint32_t ScenarioTrie::findChild(uint32_t node, const ScenarioPoint &point) const
+{
+    uint16_t thread = findThread(point.thread);
+    if (thread == noThread) {
+        return 0;
+    }
+    for (uint32_t child = nodes[node].firstChild; child != 0; child = nodes[child].nextSibling) {
+        if ((nodes[child].thread == thread) && (nodes[child].number == point.number)) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+bool ScenarioTrie::insert(const Scenario &scenario)
+{
+    uint32_t node = 0;
+    for (const auto &point : scenario) {
+        uint16_t thread = findThread(point.thread);
+        if (thread == noThread) {
+            thread = static_cast<uint16_t>(threads.size());
+            threads.push_back(point.thread);
+        }
+        uint32_t last = 0;
+        uint32_t child = nodes[node].firstChild;
+        while ((child != 0) && ((nodes[child].thread != thread) || (nodes[child].number != point.number))) {
+            last = child;
+            child = nodes[child].nextSibling;
+        }
+        if (child == 0) {
+            child = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(TrieNode{node, 0, 0, point.number, thread, false});
+            // Appended, so that the children stay in insertion order
+            if (last == 0) {
+                nodes[node].firstChild = child;
+            }
+            else {
+                nodes[last].nextSibling = child;
+            }
+        }
+        node = child;
+    }
+    if (nodes[node].terminal) {
+        return false;
+    }
+    nodes[node].terminal = true;
+    nbScenarios++;
+    return true;
+}
+
+bool ScenarioTrie::hasPrefixOf(const Scenario &scenario) const
+{
+    uint32_t node = 0;
+    if (nodes[node].terminal) {
+        return true;
+    }
+    for (const auto &point : scenario) {
+        node = findChild(node, point);
+        if (node == 0) {
+            return false;
+        }
+        if (nodes[node].terminal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint32_t> ScenarioTrie::getTerminals() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(nbScenarios);
+    uint32_t node = 0;
+    while (true) {
+        if (nodes[node].terminal) {
+            result.push_back(node);
+        }
+        if (nodes[node].firstChild != 0) {
+            node = nodes[node].firstChild;
+            continue;
+        }
+        // Back up to the first ancestor having a next sibling
+        while ((node != 0) && (nodes[node].nextSibling == 0)) {
+            node = nodes[node].parent;
+        }
+        if (node == 0) {
+            break;
+        }
+        node = nodes[node].nextSibling;
+    }
+    return result;
+}
+
+Scenario ScenarioTrie::getScenario(uint32_t node) const
+{
+    Scenario result;
+    for (; node != 0; node = nodes[node].parent) {
+        result.push_back(ScenarioPoint{threads[nodes[node].thread], nodes[node].number});
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+size_t ScenarioTrie::memoryUsage() const
+{
+    return nodes.capacity() * sizeof(TrieNode) + threads.capacity() * sizeof(const ObservableThread *);
+}
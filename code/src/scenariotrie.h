@@ -0,0 +1,135 @@
+#ifndef SCENARIOTRIE_H
+#define SCENARIOTRIE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "scenario.h"
+
+///
+/// \brief The ScenarioTrie class
+///
+/// This class stores a set of scenarios as a prefix tree: the points shared
+/// by several scenarios are stored only once. Each node of the trie is a
+/// scenario point, and a node is terminal if a stored scenario ends there.
+///
+/// The nodes are stored contiguously, in 20 bytes each: the thread is an
+/// index in a table of the threads met, and the children of a node form a
+/// linked list, in insertion order, through indices.
+///
+/// The scenarios can be enumerated in depth-first order, in which
+/// consecutive scenarios share the longest possible prefixes:
+///
+/// \code{cpp}
+/// for (auto terminal : trie.getTerminals()) {
+///     Scenario scenario = trie.getScenario(terminal);
+/// }
+/// \endcode
+///
+class ScenarioTrie
+{
+public:
+
+    /// Default constructor, creates an empty trie
+    ScenarioTrie();
+
+    ///
+    /// \brief Inserts a scenario
+    /// \param scenario The scenario to insert
+    /// \return true if the scenario was not already stored, false else
+    ///
+    bool insert(const Scenario &scenario);
+
+    ///
+    /// \brief Checks whether a stored scenario is a prefix of a scenario
+    /// \param scenario The scenario to check
+    /// \return true if a stored scenario is a prefix of the scenario, or the scenario itself
+    ///
+    [[nodiscard]] bool hasPrefixOf(const Scenario &scenario) const;
+
+    ///
+    /// \brief Gets the number of stored scenarios
+    /// \return The number of distinct scenarios inserted
+    ///
+    [[nodiscard]] size_t size() const { return nbScenarios; }
+
+    ///
+    /// \brief Gets the number of points stored
+    /// \return The number of nodes, without the root
+    ///
+    [[nodiscard]] size_t nbPoints() const { return nodes.size() - 1; }
+
+    ///
+    /// \brief Gets the terminal nodes in depth-first order
+    /// \return The indices of the nodes where a stored scenario ends
+    ///
+    /// A scenario comes before its extensions, and the children of a node
+    /// are visited in insertion order.
+    ///
+    [[nodiscard]] std::vector<uint32_t> getTerminals() const;
+
+    ///
+    /// \brief Gets the scenario ending at a node
+    /// \param node The index of the node, for instance given by getTerminals()
+    /// \return The points from the root to the node
+    ///
+    [[nodiscard]] Scenario getScenario(uint32_t node) const;
+
+    ///
+    /// \brief Gets the memory used by the trie
+    /// \return The number of bytes allocated for the nodes and the thread table
+    ///
+    [[nodiscard]] size_t memoryUsage() const;
+
+    ///
+    /// \brief Removes all the scenarios
+    ///
+    void clear();
+
+protected:
+
+    /// A node of the trie
+    typedef struct {
+        /// Index of the parent node
+        uint32_t parent;
+        /// Index of the first child, 0 if none
+        uint32_t firstChild;
+        /// Index of the next child of the parent, 0 if none
+        uint32_t nextSibling;
+        /// The section number of the point
+        int number;
+        /// The index of the thread of the point in threads
+        uint16_t thread;
+        /// Whether a stored scenario ends at this node
+        bool terminal;
+    } TrieNode;
+
+    /// Thread index of the points of no thread met
+    static constexpr uint16_t noThread = 0xffff;
+
+    ///
+    /// \brief Finds the child of a node corresponding to a point
+    /// \param node The index of the parent node
+    /// \param point The scenario point
+    /// \return The index of the child, or 0 if there is none (0 is the root)
+    ///
+    [[nodiscard]] uint32_t findChild(uint32_t node, const ScenarioPoint &point) const;
+
+    ///
+    /// \brief Gets the index of a thread in threads
+    /// \param thread The thread
+    /// \return Its index, or noThread if it was never met
+    ///
+    [[nodiscard]] uint16_t findThread(const ObservableThread *thread) const;
+
+    /// The nodes, the root being at index 0
+    std::vector<TrieNode> nodes;
+
+    /// The threads met in the points
+    std::vector<const ObservableThread *> threads;
+
+    /// The number of stored scenarios
+    size_t nbScenarios{0};
+};
+
+#endif // SCENARIOTRIE_H
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "sectionprofiler.h"
+
+
+void SectionProfiler::addThread(const ObservableThread *thread)
+{
+    for (const auto &section : thread->getSectionCosts()) {
+        auto &cost = costs[std::make_pair(thread->getId(), section.first)];
+        cost.nbRuns += section.second.nbRuns;
+        cost.wallNs += section.second.wallNs;
+        cost.blockedNs += section.second.blockedNs;
+    }
+}
+
+void SectionProfiler::clear()
+{
+    costs.clear();
+}
+
+void SectionProfiler::printHotSpots(size_t nbRows) const
+{
+    typedef std::pair<const std::pair<std::string, int>, SectionCost> Entry;
+    std::vector<const Entry *> sorted;
+    uint64_t total = 0;
+    for (const auto &entry : costs) {
+        sorted.push_back(&entry);
+        total += entry.second.wallNs + entry.second.blockedNs;
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+        return a->second.wallNs + a->second.blockedNs > b->second.wallNs + b->second.blockedNs;
+    });
+    if ((nbRows != 0) && (sorted.size() > nbRows)) {
+        sorted.resize(nbRows);
+    }
+
+    char line[160];
+    std::cout << "Section hot spots :" << std::endl;
+    std::snprintf(line, sizeof(line), "  %-16s %8s %10s %12s %12s %12s %7s", "Thread", "Section", "Runs", "Wall (ms)",
+                  "Mean (us)", "Blocked (ms)", "Share");
+    std::cout << line << std::endl;
+    for (auto entry : sorted) {
+        const auto &cost = entry->second;
+        double share = (total > 0) ? 100.0 * static_cast<double>(cost.wallNs + cost.blockedNs) / static_cast<double>(total) : 0.0;
+        double mean = (cost.nbRuns > 0) ? static_cast<double>(cost.wallNs) / static_cast<double>(cost.nbRuns) / 1e3 : 0.0;
+        std::snprintf(line, sizeof(line), "  %-16s %8d %10llu %12.3f %12.3f %12.3f %6.1f%%", entry->first.first.c_str(),
+                      entry->first.second, static_cast<unsigned long long>(cost.nbRuns),
+                      static_cast<double>(cost.wallNs) / 1e6, mean, static_cast<double>(cost.blockedNs) / 1e6, share);
+        std::cout << line << std::endl;
+    }
+}
+
+bool SectionProfiler::writeFoldedStacks(const std::string &fileName) const
+{
+    std::ofstream file(fileName, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    for (const auto &entry : costs) {
+        // The frames are separated by ';', so it shall not appear in the thread id
+        std::string thread = entry.first.first;
+        std::replace(thread.begin(), thread.end(), ';', '_');
+        std::string frames = thread + ";section " + std::to_string(entry.first.second);
+        if (entry.second.wallNs > 0) {
+            file << frames << ";run " << entry.second.wallNs << "\n";
+        }
+        if (entry.second.blockedNs > 0) {
+            file << frames << ";blocked " << entry.second.blockedNs << "\n";
+        }
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,75 @@
+#ifndef SECTIONPROFILER_H
+#define SECTIONPROFILER_H
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "observablethread.h"
+
+///
+/// \brief The SectionProfiler class
+///
+/// Aggregates the costs measured by the threads with
+/// ObservableThread::setProfiling(), by thread id and section number, to
+/// find the sections worth coarsening or stubbing. They can be printed as a
+/// hot-spot table, sorted by total time, or written as folded stacks, the
+/// input of flame graph tools such as flamegraph.pl or speedscope:
+///
+/// \code{txt}
+/// thread;section 3;run 1250000
+/// thread;section 3;blocked 830000
+/// \endcode
+///
+/// The values of the folded stacks are in nanoseconds.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ObservableThread::setProfiling(true);
+/// // Run the scenarios
+/// SectionProfiler profiler;
+/// for (auto &thread : threads)
+///     profiler.addThread(thread.get());
+/// profiler.printHotSpots();
+/// profiler.writeFoldedStacks("sections.folded");
+/// \endcode
+///
+class SectionProfiler
+{
+public:
+
+    ///
+    /// \brief Adds the costs measured by a thread
+    /// \param thread The thread, not running
+    ///
+    void addThread(const ObservableThread *thread);
+
+    ///
+    /// \brief Forgets all the costs
+    ///
+    void clear();
+
+    /// Gets the costs, by thread id and section number
+    [[nodiscard]] const std::map<std::pair<std::string, int>, SectionCost> &getCosts() const { return costs; }
+
+    ///
+    /// \brief Prints the sections sorted by decreasing total time, wall and blocked
+    /// \param nbRows The maximum number of sections printed, 0 for all
+    ///
+    void printHotSpots(size_t nbRows = 20) const;
+
+    ///
+    /// \brief Writes the costs as folded stacks
+    /// \param fileName The name of the file
+    /// \return true if the file could be written, false else
+    ///
+    bool writeFoldedStacks(const std::string &fileName) const;
+
+private:
+
+    /// The costs, by thread id and section number
+    std::map<std::pair<std::string, int>, SectionCost> costs;
+};
+
+#endif // SECTIONPROFILER_H
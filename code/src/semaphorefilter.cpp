@@ -0,0 +1,54 @@
+#include "semaphorefilter.h"
+
+
+int SemaphoreFilter::addCounter(const std::string &name, int initialValue)
+{
+    names.push_back(name);
+    initialValues.push_back(initialValue);
+    values.push_back(initialValue);
+    return static_cast<int>(names.size()) - 1;
+}
+
+const std::string &SemaphoreFilter::getCounterName(int counter) const
+{
+    return names[counter];
+}
+
+std::shared_ptr<SemaphoreFilter> SemaphoreFilter::clone() const
+{
+    auto filter = std::make_shared<SemaphoreFilter>();
+    filter->names = names;
+    filter->initialValues = initialValues;
+    filter->values = initialValues;
+    filter->nbRejectedTotal = nbRejectedTotal;
+    return filter;
+}
+
+void SemaphoreFilter::reset()
+{
+    values = initialValues;
+}
+
+bool SemaphoreFilter::enter(const ScenarioGraphNode *node)
+{
+    for (size_t i = 0; i < node->effects.size(); i++) {
+        const auto &effect = node->effects[i];
+        if ((effect.delta < 0) && (values[effect.counter] + effect.delta < 0)) {
+            // The section would block, so undo what has been done so far
+            while (i > 0) {
+                i--;
+                values[node->effects[i].counter] -= node->effects[i].delta;
+            }
+            return false;
+        }
+        values[effect.counter] += effect.delta;
+    }
+    return true;
+}
+
+void SemaphoreFilter::leave(const ScenarioGraphNode *node)
+{
+    for (auto it = node->effects.rbegin(); it != node->effects.rend(); it++) {
+        values[it->counter] -= it->delta;
+    }
+}
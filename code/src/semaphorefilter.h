@@ -0,0 +1,137 @@
+#ifndef SEMAPHOREFILTER_H
+#define SEMAPHOREFILTER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+
+///
+/// \brief The SemaphoreFilter class
+///
+/// This class runs a symbolic pre-simulation of counting semaphores while
+/// scenarios are generated. Each section of a ScenarioGraph can be annotated
+/// with abstract acquire/release effects on named counters. When a section
+/// would block on one of these counters while other threads still have
+/// sections to play, the interleaving can only end up in a DeadEnd, and the
+/// builder can drop it, and all its extensions, without running it.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// auto filter = std::make_shared<SemaphoreFilter>();
+/// int full = filter->addCounter("waitFull", 0);
+/// threads[0]->getScenarioGraph()->findNode(2)->release(full);
+/// threads[1]->getScenarioGraph()->findNode(5)->acquire(full);
+///
+/// auto builder = std::make_unique<ScenarioBuilderBuffer>();
+/// builder->setSemaphoreFilter(filter);
+/// builder->init(threads, 6);
+/// \endcode
+///
+/// The current values of the counters follow the prefix being generated, so
+/// a builder works on its own copy, created by clone() when its generation
+/// starts: several builders may generate at the same time with the same
+/// declarations, and the counters added before the start are taken into account.
+///
+class SemaphoreFilter
+{
+public:
+
+    /// Default constructor
+    SemaphoreFilter() = default;
+
+    ///
+    /// \brief Declares a new abstract counter
+    /// \param name The name of the counter, for printing purpose
+    /// \param initialValue The initial value of the counter
+    /// \return The identifier of the counter, to be used in SectionEffect
+    ///
+    int addCounter(const std::string &name, int initialValue);
+
+    ///
+    /// \brief Gets the name of a counter
+    /// \param counter The counter identifier
+    /// \return The name given to addCounter()
+    ///
+    [[nodiscard]] const std::string &getCounterName(int counter) const;
+
+    ///
+    /// \brief Creates a filter with the same counters, for another builder
+    /// \return The new filter, with the counters at their initial value
+    ///
+    /// The prefixes it rejects are also counted by getNbRejectedTotal() of
+    /// this filter.
+    ///
+    [[nodiscard]] std::shared_ptr<SemaphoreFilter> clone() const;
+
+    ///
+    /// \brief Resets all counters to their initial value
+    ///
+    /// This function shall be called before a new generation starts.
+    ///
+    void reset();
+
+    ///
+    /// \brief Simulates the start of a section
+    /// \param node The node of the section
+    /// \return true if the section can run without blocking, false else
+    ///
+    /// If the section would block, the counters are left untouched.
+    ///
+    bool enter(const ScenarioGraphNode *node);
+
+    ///
+    /// \brief Undoes the effects of a section previously entered
+    /// \param node The node of the section
+    ///
+    /// It shall only be called for a node for which enter() returned true,
+    /// in the reverse order of the enter() calls.
+    ///
+    void leave(const ScenarioGraphNode *node);
+
+    ///
+    /// \brief Records that a prefix has been rejected
+    ///
+    void reject()
+    {
+        nbRejected.fetch_add(1, std::memory_order_relaxed);
+        nbRejectedTotal->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief Gets the number of rejected prefixes
+    /// \return The number of prefixes dropped by this filter since its creation
+    ///
+    /// It can be read by another thread than the generating one.
+    ///
+    [[nodiscard]] size_t getNbRejected() const { return nbRejected.load(std::memory_order_relaxed); }
+
+    ///
+    /// \brief Gets the number of rejected prefixes, clones included
+    /// \return The number of prefixes dropped by this filter, the filter it
+    ///         was cloned from and all their clones
+    ///
+    [[nodiscard]] size_t getNbRejectedTotal() const { return nbRejectedTotal->load(std::memory_order_relaxed); }
+
+private:
+
+    /// Names of the counters
+    std::vector<std::string> names;
+
+    /// Initial values of the counters
+    std::vector<int> initialValues;
+
+    /// Current values of the counters
+    std::vector<int> values;
+
+    /// Number of prefixes rejected
+    std::atomic<size_t> nbRejected{0};
+
+    /// Number of prefixes rejected, shared with the clones
+    std::shared_ptr<std::atomic<size_t> > nbRejectedTotal{std::make_shared<std::atomic<size_t> >(0)};
+};
+
+#endif // SEMAPHOREFILTER_H
@@ -0,0 +1,256 @@
+#include <algorithm>
+
+#include "observablethread.h"
+#include "statespacewriter.h"
+
+
+bool StateSpaceWriter::open(const std::string &fileName, Format format, const std::vector<ObservableThread *> &threads,
+                            size_t maxEdges)
+{
+    this->format = format;
+    this->threads = threads;
+    this->maxEdges = maxEdges;
+    nbStates = 0;
+    initialNodes.clear();
+    for (auto thread : threads) {
+        initialNodes.push_back(thread->getScenarioGraph() ? thread->getScenarioGraph()->getFirstNode() : nullptr);
+    }
+    positions.clear();
+    counts.clear();
+    table.assign(1024, 0);
+    firstEdges.clear();
+    edges.clear();
+    nbDroppedEdges = 0;
+
+    file.open(fileName);
+    if (!file) {
+        return false;
+    }
+    if (format == Format::Dot) {
+        file << "digraph statespace {\n";
+        file << "rankdir=\"LR\";\n";
+    }
+    else {
+        file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+        file << "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n";
+        file << "  <key id=\"position\" for=\"node\" attr.name=\"position\" attr.type=\"string\"/>\n";
+        file << "  <key id=\"depth\" for=\"node\" attr.name=\"depth\" attr.type=\"int\"/>\n";
+        file << "  <key id=\"deadlock\" for=\"node\" attr.name=\"deadlock\" attr.type=\"int\"/>\n";
+        file << "  <key id=\"allscenario\" for=\"node\" attr.name=\"allscenario\" attr.type=\"int\"/>\n";
+        file << "  <key id=\"deadend\" for=\"node\" attr.name=\"deadend\" attr.type=\"int\"/>\n";
+        file << "  <key id=\"thread\" for=\"edge\" attr.name=\"thread\" attr.type=\"string\"/>\n";
+        file << "  <key id=\"section\" for=\"edge\" attr.name=\"section\" attr.type=\"int\"/>\n";
+        file << "  <graph id=\"statespace\" edgedefault=\"directed\">\n";
+    }
+    // The initial state, where no thread started a section
+    findOrInsert(initialNodes);
+    return true;
+}
+
+void StateSpaceWriter::addScenario(const Scenario &scenario, size_t length, PcoConcurrencyAnalyzer::EndingStatus status)
+{
+    if (!file.is_open()) {
+        return;
+    }
+    std::vector<const ScenarioGraphNode *> state = initialNodes;
+    uint32_t current = 0;
+    for (size_t i = 0; (i < length) && (i < scenario.size()); i++) {
+        size_t thread = 0;
+        while ((thread < threads.size()) && (threads[thread] != scenario[i].thread)) {
+            thread++;
+        }
+        if (thread == threads.size()) {
+            // Not a thread of the state space
+            break;
+        }
+        const ScenarioGraphNode *node = nullptr;
+        if (state[thread] != nullptr) {
+            for (auto child : state[thread]->next) {
+                if (child->number == scenario[i].number) {
+                    node = child;
+                    break;
+                }
+            }
+        }
+        if (node == nullptr) {
+            // Not a section of the thread graph
+            break;
+        }
+        state[thread] = node;
+        uint32_t next = findOrInsert(state);
+        if (addEdge(current, next)) {
+            writeEdge(current, next, thread, scenario[i].number);
+        }
+        current = next;
+    }
+    counts[current * nbStatus + static_cast<size_t>(status)]++;
+}
+
+void StateSpaceWriter::finish()
+{
+    if (!file.is_open()) {
+        return;
+    }
+    for (uint32_t state = 0; state < nbStates; state++) {
+        writeState(state);
+    }
+    if (format == Format::Dot) {
+        file << "}\n";
+    }
+    else {
+        file << "  </graph>\n";
+        file << "</graphml>\n";
+    }
+    file.close();
+}
+
+size_t StateSpaceWriter::memoryUsage() const
+{
+    return positions.capacity() * sizeof(const ScenarioGraphNode *) + counts.capacity() * sizeof(uint32_t) +
+           table.capacity() * sizeof(uint32_t) + firstEdges.capacity() * sizeof(uint32_t) +
+           edges.capacity() * sizeof(Edge);
+}
+
+uint64_t StateSpaceWriter::hash(const ScenarioGraphNode *const *state) const
+{
+    // FNV-1a over the addresses of the nodes
+    uint64_t result = 14695981039346656037ULL;
+    for (size_t t = 0; t < threads.size(); t++) {
+        result ^= static_cast<uint64_t>(reinterpret_cast<uintptr_t>(state[t]));
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+uint32_t StateSpaceWriter::findOrInsert(const std::vector<const ScenarioGraphNode *> &state)
+{
+    size_t mask = table.size() - 1;
+    size_t slot = hash(state.data()) & mask;
+    while (table[slot] != 0) {
+        uint32_t candidate = table[slot] - 1;
+        if (std::equal(state.begin(), state.end(), positions.begin() + candidate * threads.size())) {
+            return candidate;
+        }
+        slot = (slot + 1) & mask;
+    }
+    auto index = static_cast<uint32_t>(nbStates++);
+    table[slot] = index + 1;
+    positions.insert(positions.end(), state.begin(), state.end());
+    counts.resize(counts.size() + nbStatus, 0);
+    firstEdges.push_back(0);
+    if (nbStates * 2 > table.size()) {
+        grow();
+    }
+    return index;
+}
+
+void StateSpaceWriter::grow()
+{
+    table.assign(table.size() * 2, 0);
+    size_t mask = table.size() - 1;
+    for (uint32_t index = 0; index < nbStates; index++) {
+        size_t slot = hash(positions.data() + index * threads.size()) & mask;
+        while (table[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = index + 1;
+    }
+}
+
+bool StateSpaceWriter::addEdge(uint32_t from, uint32_t to)
+{
+    // A state has at most one edge per thread and child section, so the list is short
+    for (uint32_t edge = firstEdges[from]; edge != 0; edge = edges[edge - 1].next) {
+        if (edges[edge - 1].to == to) {
+            return false;
+        }
+    }
+    if (edges.size() >= maxEdges) {
+        nbDroppedEdges++;
+        return false;
+    }
+    edges.push_back(Edge{to, firstEdges[from]});
+    firstEdges[from] = static_cast<uint32_t>(edges.size());
+    return true;
+}
+
+void StateSpaceWriter::writeEdge(uint32_t from, uint32_t to, size_t thread, int section)
+{
+    std::string id = escape(threads[thread]->getId());
+    if (format == Format::Dot) {
+        file << "n" << from << " -> n" << to << " [label=\"" << id << ":" << section << "\"];\n";
+    }
+    else {
+        file << "    <edge source=\"n" << from << "\" target=\"n" << to << "\">"
+             << "<data key=\"thread\">" << id << "</data>"
+             << "<data key=\"section\">" << section << "</data></edge>\n";
+    }
+}
+
+void StateSpaceWriter::writeState(uint32_t state)
+{
+    std::string position = "(";
+    for (size_t t = 0; t < threads.size(); t++) {
+        const ScenarioGraphNode *node = positions[state * threads.size() + t];
+        position += (t == 0 ? "" : ",") + std::to_string(node ? node->number : -1);
+    }
+    position += ")";
+    const uint32_t *count = counts.data() + state * nbStatus;
+    using Status = PcoConcurrencyAnalyzer::EndingStatus;
+    uint32_t depth = count[static_cast<size_t>(Status::Depth)];
+    uint32_t deadlock = count[static_cast<size_t>(Status::Deadlock)];
+    uint32_t allScenario = count[static_cast<size_t>(Status::EndAllScenario)];
+    uint32_t deadEnd = count[static_cast<size_t>(Status::DeadEnd)];
+
+    if (format == Format::Dot) {
+        file << "n" << state << " [label=\"" << position;
+        if (depth != 0) {
+            file << "\\nDepth: " << depth;
+        }
+        if (deadlock != 0) {
+            file << "\\nDeadlock: " << deadlock;
+        }
+        if (allScenario != 0) {
+            file << "\\nAllScenario: " << allScenario;
+        }
+        if (deadEnd != 0) {
+            file << "\\nDeadEnd: " << deadEnd;
+        }
+        file << "\"";
+        if ((deadlock != 0) || (deadEnd != 0)) {
+            file << ", color=red";
+        }
+        file << "];\n";
+    }
+    else {
+        file << "    <node id=\"n" << state << "\">"
+             << "<data key=\"position\">" << position << "</data>"
+             << "<data key=\"depth\">" << depth << "</data>"
+             << "<data key=\"deadlock\">" << deadlock << "</data>"
+             << "<data key=\"allscenario\">" << allScenario << "</data>"
+             << "<data key=\"deadend\">" << deadEnd << "</data></node>\n";
+    }
+}
+
+std::string StateSpaceWriter::escape(const std::string &text) const
+{
+    std::string result;
+    for (char c : text) {
+        if (format == Format::Dot) {
+            if ((c == '"') || (c == '\\')) {
+                result += '\\';
+            }
+            result += c;
+        }
+        else {
+            switch (c) {
+            case '&': result += "&amp;"; break;
+            case '<': result += "&lt;"; break;
+            case '>': result += "&gt;"; break;
+            case '"': result += "&quot;"; break;
+            default: result += c;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,187 @@
+#ifndef STATESPACEWRITER_H
+#define STATESPACEWRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief The StateSpaceWriter class
+///
+/// This class writes the global state space explored by the model checker,
+/// that is the product of the thread scenario graphs restricted to the
+/// scenarios actually played. A state is the vector of the positions of the
+/// threads, the position of a thread being the node of its scenario graph of
+/// the last section it started, its initial node before the first one. Two
+/// nodes with the same section number, as the copies made by unrolling a
+/// loop, are thus different positions. The positions are labeled by their
+/// section number. An edge is labeled by the thread and the section it starts.
+///
+/// The edges are streamed to the file as they are discovered. The states are
+/// kept in memory in a compact open addressing table: the positions of all
+/// states in a single array, and the number of scenarios that ended in each
+/// state, per ending status. The states are written with these counts by
+/// finish(). Both DOT and GraphML accept nodes declared after the edges
+/// referring to them.
+///
+/// A state can be reached again by another interleaving at any time, so the
+/// edges written are also kept, to write each one once: a list of targets per
+/// source state, 8 bytes per edge. The memory used grows linearly with the
+/// number of states and edges, see memoryUsage(). The number of edges kept is
+/// bounded by open(): beyond it, the new edges are neither kept nor written,
+/// their traversals are only counted, see getNbDroppedEdges().
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// StateSpaceWriter writer;
+/// writer.open("statespace.graphml", StateSpaceWriter::Format::GraphML, threads);
+/// writer.addScenario(scenario, nbPlayed, endingStatus);
+/// writer.finish();
+/// \endcode
+///
+/// The DOT output can be rendered with:
+///
+/// dot -Tsvg statespace.gv -o statespace.svg
+///
+class StateSpaceWriter
+{
+public:
+
+    /// The output format
+    enum class Format {
+        /// https://graphviz.org/doc/info/lang.html
+        Dot,
+        /// http://graphml.graphdrawing.org/
+        GraphML
+    };
+
+    ///
+    /// \brief Opens the output file and writes its header
+    /// \param fileName The name of the file
+    /// \param format The output format
+    /// \param threads The threads of the scenarios, in the order of the positions
+    /// \param maxEdges The maximum number of edges kept and written
+    /// \return true if the file could be opened, false else
+    ///
+    bool open(const std::string &fileName, Format format, const std::vector<ObservableThread *> &threads,
+              size_t maxEdges = defaultMaxEdges);
+
+    ///
+    /// \brief Adds the states and edges of a played scenario
+    /// \param scenario The scenario
+    /// \param length The number of scenario points actually played
+    /// \param status The ending status of the scenario, counted in the last state
+    ///
+    void addScenario(const Scenario &scenario, size_t length, PcoConcurrencyAnalyzer::EndingStatus status);
+
+    ///
+    /// \brief Writes the states and the footer, and closes the file
+    ///
+    void finish();
+
+    /// Gets the number of states discovered
+    [[nodiscard]] size_t getNbStates() const { return nbStates; }
+
+    /// Gets the number of edges written
+    [[nodiscard]] size_t getNbEdges() const { return edges.size(); }
+
+    ///
+    /// \brief Gets the number of traversals of edges not kept, as the maximum number of edges was reached
+    /// \return The number of traversals dropped, an edge not kept being counted each time it is traversed
+    ///
+    [[nodiscard]] size_t getNbDroppedEdges() const { return nbDroppedEdges; }
+
+    /// Default maximum number of edges, 128 MB of edge lists
+    static constexpr size_t defaultMaxEdges = 1 << 24;
+
+    ///
+    /// \brief Gets the memory used by the state table
+    /// \return The number of bytes allocated for the states and the edges
+    ///
+    [[nodiscard]] size_t memoryUsage() const;
+
+private:
+
+    /// Number of ending status counted per state
+    static constexpr size_t nbStatus = 5;
+
+    ///
+    /// \brief Finds a state, inserting it if needed
+    /// \param state The positions of the threads
+    /// \return The index of the state
+    ///
+    uint32_t findOrInsert(const std::vector<const ScenarioGraphNode *> &state);
+
+    /// Doubles the size of the hash table
+    void grow();
+
+    /// Hash of the positions of a state
+    [[nodiscard]] uint64_t hash(const ScenarioGraphNode *const *state) const;
+
+    ///
+    /// \brief Records an edge
+    /// \param from The source state
+    /// \param to The target state
+    /// \return true if the edge is new and kept, false if it was already written or is dropped
+    ///
+    bool addEdge(uint32_t from, uint32_t to);
+
+    /// Writes an edge
+    void writeEdge(uint32_t from, uint32_t to, size_t thread, int section);
+
+    /// Writes a state, with its counts
+    void writeState(uint32_t state);
+
+    /// Escapes a string for DOT or GraphML
+    [[nodiscard]] std::string escape(const std::string &text) const;
+
+    /// The output file
+    std::ofstream file;
+
+    /// The output format
+    Format format{Format::Dot};
+
+    /// The threads, in the order of the positions
+    std::vector<ObservableThread *> threads;
+
+    /// The number of states
+    size_t nbStates{0};
+
+    /// The initial node of each thread, nullptr for a thread without scenario graph
+    std::vector<const ScenarioGraphNode *> initialNodes;
+
+    /// The positions of all states, threads.size() per state
+    std::vector<const ScenarioGraphNode *> positions;
+
+    /// The number of scenarios ending in each state, nbStatus per state
+    std::vector<uint32_t> counts;
+
+    /// Open addressing table of state indices plus one, 0 being an empty slot
+    std::vector<uint32_t> table;
+
+    /// An edge written, in the list of its source state
+    typedef struct {
+        /// The target state
+        uint32_t to;
+        /// The next edge of the same source, plus one, 0 for the last one
+        uint32_t next;
+    } Edge;
+
+    /// The first edge of each state, plus one, 0 for a state without edge
+    std::vector<uint32_t> firstEdges;
+
+    /// The edges written
+    std::vector<Edge> edges;
+
+    /// Maximum number of edges kept
+    size_t maxEdges{defaultMaxEdges};
+
+    /// Number of traversals of edges not kept, beyond maxEdges
+    size_t nbDroppedEdges{0};
+};
+
+#endif // STATESPACEWRITER_H
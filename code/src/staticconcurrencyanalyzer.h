@@ -0,0 +1,382 @@
+#ifndef STATICCONCURRENCYANALYZER_H
+#define STATICCONCURRENCYANALYZER_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+#include <pcosynchro/pcomanager.h>
+#include <pcosynchro/pcothread.h>
+
+#include "observablethread.h"
+#include "pcoconcurrencyanalyzer.h"
+
+///
+/// \brief Invariant policy that never checks the invariants
+///
+struct NoInvariants
+{
+    static constexpr bool enabled = false;
+    static bool check(PcoModel */*model*/) { return true; }
+};
+
+///
+/// \brief Invariant policy calling PcoModel::checkInvariants(), as PcoConcurrencyAnalyzer does
+///
+struct ModelInvariants
+{
+    static constexpr bool enabled = true;
+    static bool check(PcoModel *model) { return (model == nullptr) || model->checkInvariants(); }
+};
+
+///
+/// \brief Tracing policy that traces nothing
+///
+struct NoTracing
+{
+    static constexpr bool enabled = false;
+    static void trace(const ObservableThread */*thread*/, const char */*event*/, int /*section*/) {}
+};
+
+///
+/// \brief Tracing policy printing every section boundary on std::cout
+///
+struct CoutTracing
+{
+    static constexpr bool enabled = true;
+    static void trace(const ObservableThread *thread, const char *event, int section)
+    {
+        std::cout << "Thread " << thread->getId() << " " << event << " ( " << section << " ) " << std::endl;
+    }
+};
+
+///
+/// \brief The StaticConcurrencyAnalyzer class template
+/// \tparam NbThreads The number of threads of the scenarios
+/// \tparam InvariantPolicy NoInvariants or ModelInvariants
+/// \tparam TracingPolicy NoTracing or CoutTracing
+///
+/// Concurrency analyzer with the same protocol and ending statuses as
+/// PcoConcurrencyAnalyzer, specialized at compile time:
+///
+/// - no virtual function, the threads call it through ObservableThread::bindAnalyzer();
+/// - the disabled policies compile to nothing;
+/// - the per-thread state lives in fixed-size arrays, and each thread waits
+///   on its own condition variable, so that a handoff only wakes up the
+///   thread expected next instead of all the waiting threads;
+/// - the thread of each scenario point is resolved to a slot once, in
+///   setScenario(), and the scenario is accessed without bounds checks.
+///
+/// As with PcoConcurrencyAnalyzer, checkedBlocked() has to be called
+/// whenever a thread blocks on a synchronization primitive, for instance by
+/// a PcoWatchDog.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// StaticConcurrencyAnalyzer<3, NoInvariants> analyzer;
+/// analyzer.setScenario(scenario, {t1, t2, t3});
+/// for (auto thread : {t1, t2, t3}) {
+///     thread->bindAnalyzer(&analyzer);
+/// }
+/// \endcode
+///
+template<size_t NbThreads, typename InvariantPolicy = ModelInvariants, typename TracingPolicy = NoTracing>
+class StaticConcurrencyAnalyzer
+{
+public:
+
+    /// The ending status, shared with PcoConcurrencyAnalyzer
+    using EndingStatus = PcoConcurrencyAnalyzer::EndingStatus;
+
+    StaticConcurrencyAnalyzer()
+    {
+        PcoManager::getInstance()->setNormalMode();
+    }
+
+    ///
+    /// \brief Sets the scenario to be played
+    /// \param s Scenario to be played
+    /// \param threads The threads participating in the play
+    ///
+    /// Every thread of the scenario shall be in threads. The calls of the
+    /// other threads are ignored, and a point of the scenario referring to
+    /// one of them can not be played, so the scenario ends with a DeadEnd.
+    ///
+    void setScenario(Scenario s, const std::array<ObservableThread *, NbThreads> &threads)
+    {
+        scenario = std::move(s);
+        this->threads = threads;
+        slots.resize(scenario.size());
+        for (size_t i = 0; i < scenario.size(); i++) {
+            slots[i] = slotOf(scenario[i].thread);
+        }
+        start();
+    }
+
+    ///
+    /// \brief Restarts the analysis of the current scenario
+    ///
+    void start()
+    {
+        std::lock_guard lock(mutex);
+        currentSlot = noSlot;
+        index = 0;
+        aborting = false;
+        nbRunningThreads = NbThreads;
+        nbWaiting = 0;
+        waiting.fill(false);
+        endingStatus = EndingStatus::Unknown;
+        PcoManager::getInstance()->setNormalMode();
+    }
+
+    /// See PcoConcurrencyAnalyzer::startSection()
+    void startSection(ObservableThread *thread, int sectionNumber)
+    {
+        if constexpr (TracingPolicy::enabled) {
+            TracingPolicy::trace(thread, "in  startSection", sectionNumber);
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        uint8_t slot = slotOf(thread);
+        if (slot == noSlot) {
+            // Not a thread of the play, it is not scheduled
+            return;
+        }
+        if (aborting) {
+            ending();
+            return;
+        }
+        if (currentSlot == slot) {
+            index++;
+            currentSlot = noSlot;
+        }
+        if (index == scenario.size()) {
+            abort(EndingStatus::Depth);
+            ending();
+            return;
+        }
+        wakeExpected();
+
+        while ((slots[index] != slot) || (scenario[index].number != sectionNumber)) {
+            if (nbWaiting + PcoManager::getInstance()->nbBlockedThreads() == nbRunningThreads - 1) {
+                abort(EndingStatus::DeadEnd);
+                ending();
+                return;
+            }
+            waiting[slot] = true;
+            nbWaiting++;
+            conditions[slot].wait(lock, [this, slot] { return !waiting[slot]; });
+            if (aborting) {
+                ending();
+                return;
+            }
+        }
+        currentSlot = slot;
+
+        checkInvariants();
+        if constexpr (TracingPolicy::enabled) {
+            TracingPolicy::trace(thread, "out startSection", sectionNumber);
+        }
+    }
+
+    /// See PcoConcurrencyAnalyzer::endSection()
+    void endSection(ObservableThread *thread)
+    {
+        if constexpr (TracingPolicy::enabled) {
+            TracingPolicy::trace(thread, "endSection", -1);
+        }
+        std::lock_guard lock(mutex);
+        uint8_t slot = slotOf(thread);
+        if (slot == noSlot) {
+            return;
+        }
+        if (currentSlot == slot) {
+            index++;
+            currentSlot = noSlot;
+            if (index == scenario.size()) {
+                abort(EndingStatus::Depth);
+                ending();
+                return;
+            }
+            wakeExpected();
+        }
+        checkInvariants();
+    }
+
+    /// See PcoConcurrencyAnalyzer::endScenario()
+    void endScenario(ObservableThread *thread)
+    {
+        if constexpr (TracingPolicy::enabled) {
+            TracingPolicy::trace(thread, "endScenario", -1);
+        }
+        std::lock_guard lock(mutex);
+        uint8_t slot = slotOf(thread);
+        if (slot == noSlot) {
+            return;
+        }
+        nbRunningThreads--;
+        if (!aborting) {
+            if (nbRunningThreads == 0) {
+                endingStatus = EndingStatus::EndAllScenario;
+            }
+            else if (currentSlot == slot) {
+                index++;
+                currentSlot = noSlot;
+                if (index == scenario.size()) {
+                    abort(EndingStatus::Depth);
+                    ending();
+                    return;
+                }
+                // One less running thread: the waiting ones re-check for a dead end
+                wakeAll();
+            }
+        }
+        checkInvariants();
+    }
+
+    /// See PcoConcurrencyAnalyzer::checkedBlocked()
+    void checkedBlocked(int /*nbBlocked*/)
+    {
+        std::lock_guard lock(mutex);
+        wakeAll();
+        if ((!aborting) && (endingStatus == EndingStatus::Unknown)) {
+            if ((PcoManager::getInstance()->nbBlockedThreads() == nbRunningThreads) && (nbRunningThreads != 0)) {
+                endingStatus = EndingStatus::Deadlock;
+                PcoManager::getInstance()->setFreeMode();
+                aborting = true;
+                currentSlot = noSlot;
+            }
+        }
+    }
+
+    /// See PcoConcurrencyAnalyzer::aborted()
+    bool aborted()
+    {
+        std::lock_guard lock(mutex);
+        return aborting;
+    }
+
+    /// Returns the ending status of the analyzer
+    EndingStatus getEndingStatus()
+    {
+        std::lock_guard lock(mutex);
+        return endingStatus;
+    }
+
+    /// See PcoConcurrencyAnalyzer::getIndex()
+    size_t getIndex()
+    {
+        std::lock_guard lock(mutex);
+        return index;
+    }
+
+    /// Sets the model whose invariants are checked
+    void setModel(PcoModel *model) { this->model = model; }
+
+    /// Gets the scenario being played
+    const Scenario &getScenario() const { return scenario; }
+
+private:
+
+    /// Slot of no thread
+    static constexpr uint8_t noSlot = 0xff;
+
+    static_assert(NbThreads < noSlot, "Too many threads for a StaticConcurrencyAnalyzer");
+
+    /// Gets the slot of a thread
+    uint8_t slotOf(const ObservableThread *thread) const
+    {
+        for (size_t t = 0; t < NbThreads; t++) {
+            if (threads[t] == thread) {
+                return static_cast<uint8_t>(t);
+            }
+        }
+        return noSlot;
+    }
+
+    /// Wakes up the thread expected at the current index, if it is waiting
+    void wakeExpected()
+    {
+        uint8_t slot = slots[index];
+        if ((slot != noSlot) && waiting[slot]) {
+            waiting[slot] = false;
+            nbWaiting--;
+            conditions[slot].notify_one();
+        }
+    }
+
+    /// Wakes up all the waiting threads
+    void wakeAll()
+    {
+        for (size_t t = 0; t < NbThreads; t++) {
+            if (waiting[t]) {
+                waiting[t] = false;
+                conditions[t].notify_one();
+            }
+        }
+        nbWaiting = 0;
+    }
+
+    /// Ends the scenario with a status, releasing all the threads
+    void abort(EndingStatus status)
+    {
+        endingStatus = status;
+        PcoManager::getInstance()->setFreeMode();
+        aborting = true;
+        wakeAll();
+    }
+
+    /// Terminates the calling thread, as the scenario is over
+    void ending()
+    {
+        nbRunningThreads--;
+        PcoThread::exitThread();
+    }
+
+    /// Checks the invariants, if enabled by the policy
+    void checkInvariants()
+    {
+        if constexpr (InvariantPolicy::enabled) {
+            if (!InvariantPolicy::check(model)) {
+                std::cout << "****************************************************" << std::endl;
+                std::cout << "Detected an error" << std::endl;
+                std::cout << ScenarioPrint::toString(scenario) << std::endl;
+                std::cout << "****************************************************" << std::endl;
+            }
+        }
+    }
+
+    /// The scenario that has to be played
+    Scenario scenario;
+
+    /// The slot of the thread of each scenario point
+    std::vector<uint8_t> slots;
+
+    /// The threads, by slot
+    std::array<ObservableThread *, NbThreads> threads{};
+
+    /// The condition variable of each thread
+    std::array<std::condition_variable, NbThreads> conditions;
+
+    /// Whether each thread waits on its condition variable
+    std::array<bool, NbThreads> waiting{};
+
+    /// The ending status
+    EndingStatus endingStatus{EndingStatus::Unknown};
+
+    /// The slot of the thread playing the current section
+    uint8_t currentSlot{noSlot};
+
+    /// The number of scenario points completely played
+    size_t index{0};
+
+    std::mutex mutex;
+    int nbWaiting{0};
+    bool aborting{false};
+    int nbRunningThreads{NbThreads};
+    PcoModel *model{nullptr};
+};
+
+#endif // STATICCONCURRENCYANALYZER_H
@@ -0,0 +1,321 @@
+#ifndef STATICSCENARIO_H
+#define STATICSCENARIO_H
+
+#include <array>
+#include <cstdint>
+
+#include "scenariobuilder.h"
+
+///
+/// \brief The SectionChain class template
+///
+/// Compile-time declaration of a linear scenario graph: the thread plays the
+/// sections in the order of the template parameters.
+///
+/// Typical use, in the constructor of an ObservableThread:
+///
+/// \code{cpp}
+/// using Sections = SectionChain<1, 2, 3>;
+///
+/// explicit ThreadA(std::string id) : ObservableThread(std::move(id))
+/// {
+///     scenarioGraph = Sections::createGraph(this);
+/// }
+/// \endcode
+///
+template<int... Sections>
+class SectionChain
+{
+public:
+
+    /// Number of sections of the chain
+    static constexpr size_t size = sizeof...(Sections);
+
+    /// The section numbers, in order
+    static constexpr std::array<int, size> sections{Sections...};
+
+    ///
+    /// \brief Creates the equivalent run-time scenario graph
+    /// \param thread The thread owning the graph
+    /// \return The graph, starting with a node numbered -1
+    ///
+    static std::unique_ptr<ScenarioGraph> createGraph(const ObservableThread *thread)
+    {
+        auto graph = std::make_unique<ScenarioGraph>();
+        auto node = graph->createNode(thread, -1);
+        graph->setInitialNode(node);
+        for (int number : sections) {
+            auto next = graph->createNode(thread, number);
+            node->next.push_back(next);
+            node = next;
+        }
+        return graph;
+    }
+};
+
+
+///
+/// \brief The ChainInterleavings class template
+///
+/// Generator of all the interleavings of a fixed number of SectionChain, up
+/// to a depth, specialized on their shape. The whole state lives in small
+/// fixed-size arrays and the loops over the threads have a compile-time bound,
+/// so the enumeration does not allocate. The interleavings are generated in
+/// the same order as the ScenarioBranchBuilder does.
+///
+/// Typical use:
+///
+/// \code{cpp}
+/// ChainInterleavings<SectionChain<1, 2>, SectionChain<3, 4>> generator({t1, t2}, 4);
+/// while (generator.next()) {
+///     const auto &points = generator.getPoints();
+///     // points[0] to points[generator.getLength() - 1]
+/// }
+/// \endcode
+///
+template<typename... Chains>
+class ChainInterleavings
+{
+public:
+
+    /// Number of threads
+    static constexpr size_t nbThreads = sizeof...(Chains);
+    static_assert(nbThreads <= 255, "The thread of each level is stored as an uint8_t");
+
+    /// Total number of sections, that is the maximum depth
+    static constexpr size_t maxDepth = (Chains::size + ...);
+
+    ///
+    /// \brief ChainInterleavings constructor
+    /// \param threads The thread of each chain
+    /// \param depth The depth of the interleavings, bounded by maxDepth. 0 means no bound,
+    ///              as for the ScenarioBranchBuilder
+    ///
+    ChainInterleavings(const std::array<const ObservableThread *, nbThreads> &threads, int depth) :
+        threads(threads),
+        length(((depth > 0) && (static_cast<size_t>(depth) < maxDepth)) ? static_cast<size_t>(depth) : maxDepth)
+    {}
+
+    ///
+    /// \brief Moves to the next interleaving
+    /// \return true if there is one, false if all have been generated
+    ///
+    bool next()
+    {
+        if (!started) {
+            started = true;
+            return fill(0);
+        }
+        for (size_t level = length; level > 0; level--) {
+            size_t t = order[level - 1];
+            positions[t]--;
+            for (size_t u = t + 1; u < nbThreads; u++) {
+                if (positions[u] < lengths[u]) {
+                    setPoint(level - 1, u);
+                    return fill(level);
+                }
+            }
+        }
+        return false;
+    }
+
+    /// Gets the points of the current interleaving
+    const std::array<ScenarioPoint, maxDepth> &getPoints() const { return points; }
+
+    /// Gets the length of the interleavings
+    [[nodiscard]] size_t getLength() const { return length; }
+
+    ///
+    /// \brief Counts the interleavings
+    /// \return The number of interleavings of the chains, up to the depth
+    ///
+    [[nodiscard]] size_t count() const
+    {
+        // ways[j]: number of sequences of length j of the first threads
+        std::array<size_t, maxDepth + 1> ways{};
+        ways[0] = 1;
+        size_t total = 0;
+        for (size_t t = 0; t < nbThreads; t++) {
+            std::array<size_t, maxDepth + 1> updated{};
+            for (size_t j = 0; j <= total; j++) {
+                size_t choose = 1;
+                for (size_t k = 0; k <= lengths[t]; k++) {
+                    // choose is C(j + k, k)
+                    updated[j + k] += ways[j] * choose;
+                    choose = choose * (j + k + 1) / (k + 1);
+                }
+            }
+            total += lengths[t];
+            ways = updated;
+        }
+        return ways[length];
+    }
+
+private:
+
+    ///
+    /// \brief Fills the points from a level on with the smallest possible threads
+    /// \param level The first level to fill
+    /// \return true
+    ///
+    bool fill(size_t level)
+    {
+        for (; level < length; level++) {
+            for (size_t t = 0; t < nbThreads; t++) {
+                if (positions[t] < lengths[t]) {
+                    setPoint(level, t);
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    /// Sets the point of a level, playing the next section of a thread
+    void setPoint(size_t level, size_t thread)
+    {
+        order[level] = static_cast<uint8_t>(thread);
+        points[level] = ScenarioPoint{threads[thread], sections[offsets[thread] + positions[thread]]};
+        positions[thread]++;
+    }
+
+    /// Builds the array of all sections, chain after chain
+    static constexpr std::array<int, maxDepth> allSections()
+    {
+        std::array<int, maxDepth> result{};
+        size_t i = 0;
+        ((appendSections<Chains>(result, i)), ...);
+        return result;
+    }
+
+    /// Appends the sections of a chain to an array
+    template<typename Chain>
+    static constexpr void appendSections(std::array<int, maxDepth> &result, size_t &i)
+    {
+        for (size_t k = 0; k < Chain::size; k++) {
+            result[i++] = Chain::sections[k];
+        }
+    }
+
+    /// Builds the offset of each chain in the array of all sections
+    static constexpr std::array<size_t, nbThreads> chainOffsets()
+    {
+        std::array<size_t, nbThreads> result{};
+        size_t offset = 0;
+        for (size_t t = 0; t < nbThreads; t++) {
+            result[t] = offset;
+            offset += lengths[t];
+        }
+        return result;
+    }
+
+    /// Number of sections of each chain
+    static constexpr std::array<size_t, nbThreads> lengths{Chains::size...};
+
+    /// All sections, chain after chain
+    static constexpr std::array<int, maxDepth> sections = allSections();
+
+    /// Offset of each chain in sections
+    static constexpr std::array<size_t, nbThreads> offsets = chainOffsets();
+
+    /// The thread of each chain
+    std::array<const ObservableThread *, nbThreads> threads;
+
+    /// Length of the interleavings
+    size_t length;
+
+    /// Whether next() has already been called
+    bool started{false};
+
+    /// Number of sections already played by each thread
+    std::array<size_t, nbThreads> positions{};
+
+    /// Thread of each point of the current interleaving
+    std::array<uint8_t, maxDepth> order{};
+
+    /// Points of the current interleaving
+    std::array<ScenarioPoint, maxDepth> points{};
+};
+
+
+///
+/// \brief The StaticChainScenarioBuilder class template
+///
+/// Scenario builder for models whose threads all follow a SectionChain. It
+/// enumerates the interleavings with a ChainInterleavings, and only allocates
+/// the Scenario returned by getNext().
+///
+/// Typical use, in PcoModel::build():
+///
+/// \code{cpp}
+/// scenarioBuilder = std::make_unique<StaticChainScenarioBuilder<ThreadA::Sections, ThreadB::Sections>>();
+/// scenarioBuilder->init(threads, 6);
+/// \endcode
+///
+template<typename... Chains>
+class StaticChainScenarioBuilder : public ScenarioBuilderInterface
+{
+public:
+
+    /// The generator type
+    using Generator = ChainInterleavings<Chains...>;
+
+    void init(const std::vector<std::unique_ptr<ObservableThread> > &threads, int depth) override
+    {
+        std::vector<ObservableThread *> pointers;
+        for (const auto &thread : threads) {
+            pointers.push_back(thread.get());
+        }
+        initSubset(pointers, depth);
+    }
+
+    ///
+    /// \brief Initialize the builder
+    /// \param threads The threads, in the order of the chains
+    /// \param depth The depth of scenarios to generate
+    ///
+    /// If the number of threads does not match the number of chains, no scenario is generated.
+    ///
+    bool initSubset(const std::vector<ObservableThread *> &threads, int depth) override
+    {
+        std::array<const ObservableThread *, Generator::nbThreads> array{};
+        for (size_t t = 0; t < Generator::nbThreads && t < threads.size(); t++) {
+            array[t] = threads[t];
+        }
+        generator = std::make_unique<Generator>(array, depth);
+        valid = (threads.size() == Generator::nbThreads);
+        nbScenarios = valid ? generator->count() : 0;
+        nbReturned = 0;
+        return true;
+    }
+
+    Scenario getNext() override
+    {
+        if (!valid || !generator->next()) {
+            return {};
+        }
+        nbReturned++;
+        const auto &points = generator->getPoints();
+        return Scenario(points.begin(), points.begin() + generator->getLength());
+    }
+
+    size_t getMaxScenariosNb() override { return nbScenarios; }
+
+    size_t getRemainingScenariosNb() override { return nbScenarios - nbReturned; }
+
+private:
+
+    /// The generator
+    std::unique_ptr<Generator> generator{nullptr};
+
+    /// Whether the threads match the chains
+    bool valid{false};
+
+    /// Number of scenarios
+    size_t nbScenarios{0};
+
+    /// Number of scenarios already returned
+    size_t nbReturned{0};
+};
+
+#endif // STATICSCENARIO_H
@@ -0,0 +1,3 @@
+#include "verbosity.h"
+
+std::atomic<VerbosityLevel> Verbosity::currentLevel{VerbosityLevel::Progress};
@@ -0,0 +1,65 @@
+#ifndef VERBOSITY_H
+#define VERBOSITY_H
+
+#include <atomic>
+
+///
+/// \brief The amount of output of a run
+///
+/// Each level includes the previous ones.
+///
+enum class VerbosityLevel {
+    /// Only the statistics and the reports at the end of the run
+    Quiet,
+    /// A progress line updated at a fixed rate during the run
+    Progress,
+    /// Something for every scenario: the ending status, the scenario dumps of the models
+    Scenarios
+};
+
+///
+/// \brief The Verbosity class
+///
+/// Holds the verbosity level of the process, read by the model checker, the
+/// builders and the models to decide what they print. Printing for every
+/// scenario easily dominates the duration of a large run, so it is only done
+/// at the Scenarios level. The enters and leaves of the sections are printed
+/// independently, with ObservableThread::setVerbosity().
+///
+/// Typical use in a model:
+///
+/// \code{cpp}
+/// void postRun(Scenario &scenario) override {
+///     if (Verbosity::isAtLeast(VerbosityLevel::Scenarios)) {
+///         ScenarioPrint::printScenario(scenario);
+///     }
+/// }
+/// \endcode
+///
+class Verbosity
+{
+public:
+
+    ///
+    /// \brief Sets the verbosity level
+    /// \param level The new level, Progress by default
+    ///
+    static void setLevel(VerbosityLevel level) { currentLevel.store(level, std::memory_order_relaxed); }
+
+    /// Gets the verbosity level
+    static VerbosityLevel getLevel() { return currentLevel.load(std::memory_order_relaxed); }
+
+    ///
+    /// \brief Indicates whether something of a level shall be printed
+    /// \param level The level of what would be printed
+    /// \return true if the current level is level or above
+    ///
+    static bool isAtLeast(VerbosityLevel level) { return getLevel() >= level; }
+
+private:
+
+    /// The verbosity level
+    static std::atomic<VerbosityLevel> currentLevel;
+};
+
+#endif // VERBOSITY_H
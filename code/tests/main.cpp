@@ -1,10 +1,134 @@
 
 #include "modeltemplate.h"
 #include "modelnumbers.h"
+#include "modelloop.h"
 #include "pcomodelchecker.h"
+#include "resultstore.h"
+#include "scenariofile.h"
+
+#include <algorithm>
+#include <cstdio>
 
 #include <pcosynchro/pcomanager.h>
 
+///
+/// \brief Reads back all the scenarios of a scenario file
+/// \param fileName The name of the file
+/// \param threads The threads of the model
+/// \return The scenarios, in the order of the file
+///
+static std::vector<Scenario> readScenarioFile(const std::string &fileName,
+                                              const std::vector<std::unique_ptr<ObservableThread> > &threads)
+{
+    std::vector<Scenario> result;
+    FileScenarioBuilderIter reader;
+    if (!reader.open(fileName)) {
+        return result;
+    }
+    reader.init(threads, 0);
+    for (Scenario scenario = reader.getNext(); !scenario.empty(); scenario = reader.getNext()) {
+        result.push_back(scenario);
+    }
+    return result;
+}
+
+///
+/// \brief Compares two lists of scenarios, point by point
+///
+static bool sameScenarios(const std::vector<Scenario> &a, const std::vector<Scenario> &b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Scenario &s1, const Scenario &s2) {
+        return std::equal(s1.begin(), s1.end(), s2.begin(), s2.end(), [](const ScenarioPoint &p1, const ScenarioPoint &p2) {
+            return (p1.thread == p2.thread) && (p1.number == p2.number);
+        });
+    });
+}
+
+///
+/// \brief Writes the scenarios of a model to the file formats and reads them back
+/// \return true if every format gave back the scenarios written
+///
+/// It checks a PCOSCEN scenario file, a PCORSLT result store, and the export
+/// of the rows of a result store to a scenario file, as result_query --export does.
+///
+static bool checkFileRoundTrips()
+{
+    BufferModel model;
+    model.build();
+    const auto &threads = model.getThreads();
+    std::vector<ObservableThread *> pointers;
+    for (const auto &thread : threads) {
+        pointers.push_back(thread.get());
+    }
+    std::vector<Scenario> scenarios;
+    auto builder = model.createScenarioBuilder();
+    builder->init(threads, 9);
+    for (Scenario scenario = builder->getNext(); !scenario.empty(); scenario = builder->getNext()) {
+        scenarios.push_back(scenario);
+    }
+    bool ok = true;
+
+    // Scenario file
+    {
+        ScenarioFileWriter writer;
+        writer.open("roundtrip.scn", pointers);
+        for (const auto &scenario : scenarios) {
+            writer.write(scenario);
+        }
+        writer.finish();
+        bool same = sameScenarios(readScenarioFile("roundtrip.scn", threads), scenarios);
+        std::cout << "Round trip PCOSCEN : " << (same ? "OK" : "FAILED") << std::endl;
+        ok = ok && same;
+        std::remove("roundtrip.scn");
+    }
+
+    // Result store, in chunks of 3 scenarios so that several chunks are read
+    {
+        ResultStoreWriter writer;
+        writer.open("roundtrip.pcor", pointers, 3);
+        for (size_t i = 0; i < scenarios.size(); i++) {
+            auto status = (i % 2 == 0) ? PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario
+                                       : PcoConcurrencyAnalyzer::EndingStatus::DeadEnd;
+            writer.add(i, scenarios[i], status, static_cast<uint32_t>(scenarios[i].size()),
+                       (i % 3 == 0) ? ResultFlag::InvariantFailure : 0, "key" + std::to_string(i));
+        }
+        writer.finish();
+
+        ResultStoreReader reader;
+        bool same = reader.open("roundtrip.pcor") && (reader.getNbScenarios() == scenarios.size());
+        for (size_t i = 0; same && (i < scenarios.size()); i++) {
+            ResultRow row = reader.getRow(i);
+            auto status = (i % 2 == 0) ? PcoConcurrencyAnalyzer::EndingStatus::EndAllScenario
+                                       : PcoConcurrencyAnalyzer::EndingStatus::DeadEnd;
+            same = (row.index == i) && (row.status == static_cast<uint8_t>(status)) &&
+                   (row.flags == ((i % 3 == 0) ? ResultFlag::InvariantFailure : 0)) &&
+                   (row.nbPlayed == scenarios[i].size()) && (row.nbPoints == scenarios[i].size()) &&
+                   (std::string(row.key, row.keyLength) == "key" + std::to_string(i));
+            for (uint32_t p = 0; same && (p < row.nbPoints); p++) {
+                same = (reader.getThreadIds()[row.points[p].thread] == scenarios[i][p].thread->getId()) &&
+                       (row.points[p].number == scenarios[i][p].number);
+            }
+        }
+        std::cout << "Round trip PCORSLT : " << (same ? "OK" : "FAILED") << std::endl;
+        ok = ok && same;
+
+        // Export of all the rows, as result_query --export
+        ScenarioFileWriter exporter;
+        exporter.open("roundtrip_export.scn", reader.getThreadIds());
+        for (auto r : reader.select(-1, 0)) {
+            ResultRow row = reader.getRow(r);
+            exporter.writePoints(row.points, row.nbPoints);
+        }
+        exporter.finish();
+        same = sameScenarios(readScenarioFile("roundtrip_export.scn", threads), scenarios);
+        std::cout << "Round trip export : " << (same ? "OK" : "FAILED") << std::endl;
+        ok = ok && same;
+        std::remove("roundtrip.pcor");
+        std::remove("roundtrip_export.scn");
+    }
+    return ok;
+}
+
 int main(int /*argc*/, char */*argv*/[])
 {
     // Uncommenting the following line allows to easily observe the PcoManager in the debugger
@@ -23,7 +147,26 @@ int main(int /*argc*/, char */*argv*/[])
         checker.setModel(&model);
         checker.run();
     }
+    // Same model, with the local sections coarsened
+    {
+        BufferModel model(true);
+        PcoModelChecker checker;
+        checker.setModel(&model);
+        checker.run();
+    }
+
+    // Model with an unrolled loop, without and with coarsening
+    for (bool coarsen : {false, true}) {
+        LoopModel model(coarsen);
+        PcoModelChecker checker;
+        checker.setModel(&model);
+        checker.run();
+    }
 
+    // Formats of the scenario and result files
+    if (!checkFileRoundTrips()) {
+        return 1;
+    }
 
     return 0;
 }
@@ -0,0 +1,190 @@
+#ifndef MODELLOOP_H
+#define MODELLOOP_H
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <set>
+
+#include "pcomodel.h"
+#include "scenariobuilder.h"
+#include "staticscenario.h"
+#include "verbosity.h"
+
+///
+/// \brief A thread polling a flag until another thread sets it
+///
+/// Sections:
+/// - 10: preparation, local
+/// - 11: reads the flag, started again while the flag is not set
+/// - 12: end, local
+///
+/// The graph declares the polling loop with ScenarioGraphNode::addLoop(),
+/// and is unrolled by the model: each poll is a different node numbered 11.
+///
+class PollingThread : public ObservableThread
+{
+public:
+    PollingThread(std::shared_ptr<std::atomic<bool> > flag, std::shared_ptr<std::atomic<int> > nbPolls,
+                  int maxRetries, std::string id = "") :
+        ObservableThread(std::move(id)), flag(std::move(flag)), nbPolls(std::move(nbPolls))
+    {
+        scenarioGraph = std::make_unique<ScenarioGraph>();
+        auto first = scenarioGraph->createNode(this, -1);
+        auto prepare = scenarioGraph->createNode(this, 10);
+        auto poll = scenarioGraph->createNode(this, 11);
+        auto done = scenarioGraph->createNode(this, 12);
+        first->next.push_back(prepare);
+        prepare->next.push_back(poll);
+        poll->next.push_back(done);
+        poll->addLoop(poll, maxRetries);
+        scenarioGraph->setInitialNode(first);
+    }
+
+private:
+    void run() override
+    {
+        startSection(10);
+        bool seen = false;
+        endSection();
+
+        do {
+            startSection(11);
+            seen = flag->load();
+            nbPolls->fetch_add(1);
+            endSection();
+        } while (!seen);
+
+        startSection(12);
+        endScenario();
+    }
+
+    std::shared_ptr<std::atomic<bool> > flag;
+    std::shared_ptr<std::atomic<int> > nbPolls;
+};
+
+///
+/// \brief A thread setting the flag polled by a PollingThread
+///
+/// Sections 1 and 3 are local, section 2 sets the flag.
+///
+class SettingThread : public ObservableThread
+{
+public:
+    using Sections = SectionChain<1, 2, 3>;
+
+    SettingThread(std::shared_ptr<std::atomic<bool> > flag, std::string id = "") :
+        ObservableThread(std::move(id)), flag(std::move(flag))
+    {
+        scenarioGraph = Sections::createGraph(this);
+    }
+
+private:
+    void run() override
+    {
+        startSection(1);
+        endSection();
+
+        startSection(2);
+        flag->store(true);
+        endSection();
+
+        startSection(3);
+        endScenario();
+    }
+
+    std::shared_ptr<std::atomic<bool> > flag;
+};
+
+///
+/// \brief A model whose scenario graph has a loop
+///
+/// The polling loop is unrolled by ScenarioGraph::unrollLoops(), so several
+/// nodes share the section number 11. The interleavings in which the poller
+/// would poll again after seeing the flag, or give up before, cannot be
+/// played and end up in a DeadEnd.
+///
+/// With coarsening, the local section 10 absorbs the first poll only: the
+/// other polls, numbered 11 as well, remain scheduling points.
+///
+class LoopModel : public PcoModel
+{
+public:
+
+    ///
+    /// \param coarsen true to merge the local sections before generating the scenarios
+    ///
+    explicit LoopModel(bool coarsen = false) : coarsen(coarsen) {}
+
+    void build() override
+    {
+        threads.emplace_back(std::make_unique<PollingThread>(flag, nbPolls, maxRetries, "Poller"));
+        threads.emplace_back(std::make_unique<SettingThread>(flag, "Setter"));
+
+        if (coarsen) {
+            // Copied by unrollLoops() to every copy of the nodes
+            threads[0]->getScenarioGraph()->findNode(10)->local = true;
+            threads[0]->getScenarioGraph()->findNode(12)->local = true;
+            threads[1]->getScenarioGraph()->findNode(1)->local = true;
+            threads[1]->getScenarioGraph()->findNode(3)->local = true;
+        }
+        size_t nbNodes = threads[0]->getScenarioGraph()->unrollLoops();
+        if (Verbosity::isAtLeast(VerbosityLevel::Progress)) {
+            std::cout << "Unrolled polling graph : " << nbNodes << " nodes" << std::endl;
+        }
+
+        // The longest scenario: all the polls and all the sections
+        int depth = 1 + (maxRetries + 1) + 1 + 3;
+        if (coarsen) {
+            coarsenScenarioGraphs(depth);
+        }
+
+        scenarioBuilder = createScenarioBuilder();
+        scenarioBuilder->init(threads, depth);
+    }
+
+    void preRun(Scenario &/*scenario*/) override
+    {
+        flag->store(false);
+        nbPolls->store(0);
+    }
+
+    void postRun(Scenario &scenario) override
+    {
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios)) {
+            std::cout << "Scenario : ";
+            ScenarioPrint::printScenario(scenario);
+            std::cout << "Polls = " << nbPolls->load() << std::endl;
+        }
+        possiblePolls.insert(nbPolls->load());
+    }
+
+    void finalReport() override
+    {
+        std::cout << "---------------------------------------" << std::endl;
+        std::cout << "Possible numbers of polls : ";
+        for (int value : possiblePolls) {
+            std::cout << value << ", ";
+        }
+        std::cout << std::endl;
+    }
+
+private:
+
+    /// The maximum number of polls after the first one
+    static constexpr int maxRetries = 2;
+
+    /// The flag set by the SettingThread
+    std::shared_ptr<std::atomic<bool> > flag{std::make_shared<std::atomic<bool> >(false)};
+
+    /// The number of polls of the current scenario
+    std::shared_ptr<std::atomic<int> > nbPolls{std::make_shared<std::atomic<int> >(0)};
+
+    /// The numbers of polls observed
+    std::set<int> possiblePolls;
+
+    /// Merge of the local sections before the generation
+    bool coarsen;
+};
+
+#endif // MODELLOOP_H
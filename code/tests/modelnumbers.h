@@ -5,6 +5,8 @@
 
 #include "pcomodel.h"
 #include "scenariobuilder.h"
+#include "staticscenario.h"
+#include "verbosity.h"
 
 // The shared variable
 static int number = 0;
@@ -17,18 +19,12 @@ int getNumber()
 class ThreadA : public ObservableThread
 {
 public:
+    using Sections = SectionChain<1, 2, 3>;
+
     explicit ThreadA(std::string id = "") :
         ObservableThread(std::move(id))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-        auto scenario = scenarioGraph->createNode(this, -1);
-        auto p1 = scenarioGraph->createNode(this, 1);
-        auto p2 = scenarioGraph->createNode(this, 2);
-        auto p3 = scenarioGraph->createNode(this, 3);
-        scenario->next.push_back(p1);
-        p1->next.push_back(p2);
-        p2->next.push_back(p3);
-        scenarioGraph->setInitialNode(scenario);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -48,18 +44,12 @@ private:
 class ThreadB : public ObservableThread
 {
 public:
+    using Sections = SectionChain<4, 5, 6>;
+
     explicit ThreadB(std::string id = "") :
         ObservableThread(std::move(id))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-        auto scenario = scenarioGraph->createNode(this, -1);
-        auto p1 = scenarioGraph->createNode(this, 4);
-        auto p2 = scenarioGraph->createNode(this, 5);
-        auto p3 = scenarioGraph->createNode(this, 6);
-        scenario->next.push_back(p1);
-        p1->next.push_back(p2);
-        p2->next.push_back(p3);
-        scenarioGraph->setInitialNode(scenario);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -78,18 +68,12 @@ private:
 class ThreadC : public ObservableThread
 {
 public:
+    using Sections = SectionChain<7, 8, 9>;
+
     explicit ThreadC(std::string id = "") :
         ObservableThread(std::move(id))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-        auto scenario = scenarioGraph->createNode(this, -1);
-        auto p1 = scenarioGraph->createNode(this, 7);
-        auto p2 = scenarioGraph->createNode(this, 8);
-        auto p3 = scenarioGraph->createNode(this, 9);
-        scenario->next.push_back(p1);
-        p1->next.push_back(p2);
-        p2->next.push_back(p3);
-        scenarioGraph->setInitialNode(scenario);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -137,7 +121,8 @@ public:
         threads.emplace_back(std::make_unique<ThreadB>("2"));
         threads.emplace_back(std::make_unique<ThreadC>("3"));
 
-        scenarioBuilder = std::make_unique<ScenarioBuilderBuffer>();
+        scenarioBuilder = std::make_unique<StaticChainScenarioBuilder<ThreadA::Sections, ThreadB::Sections,
+                                                                      ThreadC::Sections>>();
         scenarioBuilder->init(threads, 9);
 
 #endif // PREDEFINED_SCENARIOS
@@ -148,13 +133,19 @@ public:
     }
 
     void postRun(Scenario &scenario) override {
-        std::cout << "---------------------------------------" << std::endl;
-        std::cout << "Scenario : ";
-        ScenarioPrint::printScenario(scenario);
-        std::cout << "Number = " << getNumber() << std::endl;
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios)) {
+            std::cout << "---------------------------------------" << std::endl;
+            std::cout << "Scenario : ";
+            ScenarioPrint::printScenario(scenario);
+            std::cout << "Number = " << getNumber() << std::endl;
+        }
         possibleNumber.insert(getNumber());
     }
 
+    std::string getObservationKey() override {
+        return std::to_string(getNumber());
+    }
+
     std::set<int> possibleNumber;
 
     void finalReport() override {
@@ -6,6 +6,8 @@
 
 #include "pcomodel.h"
 #include "pcoconcurrencyanalyzer.h"
+#include "staticscenario.h"
+#include "verbosity.h"
 #include "pcosynchro/pcosemaphore.h"
 
 /**
@@ -78,21 +80,13 @@ public:
 class ProducerThread : public ObservableThread
 {
 public:
+    using Sections = SectionChain<1, 2, 3>;
+
     ProducerThread(std::shared_ptr<AbstractBuffer<int>> buffer, std::string id = "")
         : ObservableThread(std::move(id)),
           buffer(std::move(buffer))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-
-        auto firstNode = scenarioGraph->createNode(this, -1);
-        auto s1 = scenarioGraph->createNode(this, 1);
-        auto s2 = scenarioGraph->createNode(this, 2);
-        auto s3 = scenarioGraph->createNode(this, 3);
-
-        firstNode->next.push_back(s1);
-        s1->next.push_back(s2);
-        s2->next.push_back(s3);
-        scenarioGraph->setInitialNode(firstNode);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -129,21 +123,13 @@ private:
 class ConsumerThread1 : public ObservableThread
 {
 public:
+    using Sections = SectionChain<4, 5, 6>;
+
     ConsumerThread1(std::shared_ptr<AbstractBuffer<int>> buffer, std::string id = "")
         : ObservableThread(std::move(id)),
           buffer(std::move(buffer))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-
-        auto firstNode = scenarioGraph->createNode(this, -1);
-        auto s4 = scenarioGraph->createNode(this, 4);
-        auto s5 = scenarioGraph->createNode(this, 5);
-        auto s6 = scenarioGraph->createNode(this, 6);
-
-        firstNode->next.push_back(s4);
-        s4->next.push_back(s5);
-        s5->next.push_back(s6);
-        scenarioGraph->setInitialNode(firstNode);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -177,21 +163,13 @@ private:
 class ConsumerThread2 : public ObservableThread
 {
 public:
+    using Sections = SectionChain<7, 8, 9>;
+
     ConsumerThread2(std::shared_ptr<AbstractBuffer<int>> buffer, std::string id = "")
         : ObservableThread(std::move(id)),
           buffer(std::move(buffer))
     {
-        scenarioGraph = std::make_unique<ScenarioGraph>();
-
-        auto firstNode = scenarioGraph->createNode(this, -1);
-        auto s7 = scenarioGraph->createNode(this, 7);
-        auto s8 = scenarioGraph->createNode(this, 8);
-        auto s9 = scenarioGraph->createNode(this, 9);
-
-        firstNode->next.push_back(s7);
-        s7->next.push_back(s8);
-        s8->next.push_back(s9);
-        scenarioGraph->setInitialNode(firstNode);
+        scenarioGraph = Sections::createGraph(this);
     }
 
 private:
@@ -230,6 +208,12 @@ class BufferModel : public PcoModel
 {
 public:
 
+    /**
+     * @param coarsen true pour fusionner les sections n'accédant à aucune
+     *                donnée partagée avant de générer les scénarios
+     */
+    explicit BufferModel(bool coarsen = false) : coarsen(coarsen) {}
+
     bool checkInvariants() override
     {
         return true;
@@ -247,34 +231,90 @@ public:
         threads.emplace_back(std::make_unique<ConsumerThread1>(buffer, "Consumer1"));
         threads.emplace_back(std::make_unique<ConsumerThread2>(buffer, "Consumer2"));
 
+        // Effets abstraits des sections sur les sémaphores du buffer, ce qui
+        // permet d'écarter les scénarios où une section bloquerait (DeadEnd)
+        filter = std::make_shared<SemaphoreFilter>();
+        int mutex = filter->addCounter("mutex", 1);
+        int waitFull = filter->addCounter("waitFull", 0);
+        int waitEmpty = filter->addCounter("waitEmpty", 2);
+
+        // put()
+        auto put = threads[0]->getScenarioGraph()->findNode(2);
+        put->acquire(mutex);
+        put->acquire(waitEmpty, 2);
+        put->release(mutex);
+        put->release(waitFull, 2);
+
+        // get() des 2 consommateurs
+        for (auto get : {threads[1]->getScenarioGraph()->findNode(5),
+                         threads[2]->getScenarioGraph()->findNode(8)}) {
+            get->acquire(waitFull);
+            get->release(waitEmpty);
+        }
+
         // 3 threads * 3 sections = 9 possible outcome
         int depth = 9;
-        scenarioBuilder = std::make_unique<ScenarioBuilderBuffer>();
+
+        // Les sections 1, 3, 4, 6, 7 et 9 n'accèdent à aucune donnée partagée,
+        // elles peuvent donc être fusionnées avec leur voisine
+        if (coarsen) {
+            for (const auto &thread : threads) {
+                for (int number : {1, 3, 4, 6, 7, 9}) {
+                    if (auto node = thread->getScenarioGraph()->findNode(number)) {
+                        node->local = true;
+                    }
+                }
+            }
+            coarsenScenarioGraphs(depth);
+        }
+
+        scenarioBuilder = createScenarioBuilder();
         scenarioBuilder->init(threads, depth);
     }
 
+    std::unique_ptr<ScenarioBuilderInterface> createScenarioBuilder() override
+    {
+        auto builder = std::make_unique<ScenarioBuilderBuffer>();
+        builder->setSemaphoreFilter(filter);
+        return builder;
+    }
+
     void preRun(Scenario &scenario) override
     {
-        std::cout << "\n===== Nouveau scénario =====\n";
-        ScenarioPrint::printScenario(scenario);
+        // Afficher chaque scénario ralentit fortement les longues exécutions
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios)) {
+            std::cout << "\n===== Nouveau scénario =====\n";
+            ScenarioPrint::printScenario(scenario);
+        }
 
     }
 
     void postRun(Scenario &scenario) override
     {
-        std::cout << "\n==== Fin de ce scénario ====\n";
-        ScenarioPrint::printScenario(scenario);
-        std::cout << std::endl;
+        if (Verbosity::isAtLeast(VerbosityLevel::Scenarios)) {
+            std::cout << "\n==== Fin de ce scénario ====\n";
+            ScenarioPrint::printScenario(scenario);
+            std::cout << std::endl;
+        }
     }
 
     void finalReport() override
     {
         std::cout << "\n======================================\n";
         std::cout << "Tous les scénarios ont été joués.";
+        std::cout << "\nPréfixes écartés par le filtre : " << filter->getNbRejectedTotal();
         std::cout << "\n======================================\n";
         std::cout << std::endl;
 
     }
+
+private:
+
+    /// Simulation abstraite des sémaphores du buffer
+    std::shared_ptr<SemaphoreFilter> filter;
+
+    /// Fusion des sections locales avant la génération
+    bool coarsen;
 };
 
 #endif // MODELTEMPLATE_H
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "eventlog.h"
+
+// Turns an event log written by EventLog back into the lines printed by the
+// ObservableThread in verbose mode, ordered by time, each one prefixed by the
+// time in microseconds since the first event.
+//
+// Usage: eventlog_decode file
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        std::cout << "Usage: " << argv[0] << " file" << std::endl;
+        return 1;
+    }
+    std::ifstream file(argv[1], std::ios::binary);
+    EventLogHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        (std::memcmp(header.magic, eventLogMagic, sizeof(header.magic)) != 0)) {
+        std::cout << argv[1] << " is not an event log" << std::endl;
+        return 1;
+    }
+    if ((header.version != eventLogVersion) || (header.recordSize != sizeof(EventLogRecord))) {
+        std::cout << argv[1] << " : unsupported version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::map<uint32_t, std::string> names;
+    std::map<uint32_t, uint64_t> drops;
+    std::vector<EventLogRecord> records;
+    EventLogBlock block{};
+    while (file.read(reinterpret_cast<char *>(&block), sizeof(block))) {
+        switch (static_cast<EventLogBlockType>(block.type)) {
+        case EventLogBlockType::Name: {
+            std::string name(block.count, '\0');
+            file.read(name.data(), block.count);
+            names[block.value] = name;
+            break;
+        }
+        case EventLogBlockType::Records: {
+            size_t first = records.size();
+            records.resize(first + block.count);
+            file.read(reinterpret_cast<char *>(records.data() + first),
+                      static_cast<std::streamsize>(block.count * sizeof(EventLogRecord)));
+            break;
+        }
+        case EventLogBlockType::Drops: {
+            uint64_t nb = 0;
+            file.read(reinterpret_cast<char *>(&nb), sizeof(nb));
+            drops[block.value] = nb;
+            break;
+        }
+        default:
+            std::cout << "Unknown block type " << block.type << ", truncated log" << std::endl;
+            file.setstate(std::ios::failbit);
+            break;
+        }
+    }
+
+    // The rings are drained one after the other, so the records are only sorted per thread
+    std::stable_sort(records.begin(), records.end(), [](const EventLogRecord &a, const EventLogRecord &b) {
+        return a.timestamp < b.timestamp;
+    });
+    uint64_t origin = records.empty() ? 0 : records.front().timestamp;
+    for (const auto &record : records) {
+        const char *id = names[record.thread].c_str();
+        double time = static_cast<double>(record.timestamp - origin) / 1000.0;
+        switch (static_cast<EventLogType>(record.type)) {
+        case EventLogType::StartSectionIn:
+            std::printf("%12.3f Thread %s in  startSection ( %d ) \n", time, id, record.section);
+            break;
+        case EventLogType::StartSectionOut:
+            std::printf("%12.3f Thread %s out startSection ( %d ) \n", time, id, record.section);
+            break;
+        case EventLogType::EndSectionIn: std::printf("%12.3f Thread %s in  endSection\n", time, id); break;
+        case EventLogType::EndSectionOut: std::printf("%12.3f Thread %s out endSection\n", time, id); break;
+        case EventLogType::EndScenarioIn: std::printf("%12.3f Thread %s in  endScenario\n", time, id); break;
+        case EventLogType::EndScenarioOut: std::printf("%12.3f Thread %s out endScenario\n", time, id); break;
+        default: std::printf("%12.3f Thread %s unknown event %u\n", time, id, record.type); break;
+        }
+    }
+    std::fflush(stdout);
+    for (const auto &drop : drops) {
+        std::cout << "Thread " << names[drop.first] << " : " << drop.second << " records dropped" << std::endl;
+    }
+    return 0;
+}
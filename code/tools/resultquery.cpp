@@ -0,0 +1,189 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pcoconcurrencyanalyzer.h"
+#include "resultstore.h"
+#include "scenariofile.h"
+
+// Queries a result store written by PcoModelChecker::setResultStore(): prints
+// the number of scenarios of each ending status, and the scenarios matching
+// the filters. The matching scenarios can be exported to a scenario file, to
+// be replayed by a FileScenarioBuilderIter.
+//
+// The prefix is written as ScenarioPrint prints the scenarios, for instance
+// "{Producer,1} {Consumer1,4}".
+//
+// Usage: result_query file [--status Unknown|Depth|Deadlock|AllScenario|DeadEnd]
+//                          [--failures] [--prefix points] [--key key]
+//                          [--limit nb] [--export file]
+
+/// Gets the name of an ending status stored in a row
+static const char *statusName(int status)
+{
+    if ((status < 0) || (status >= PcoConcurrencyAnalyzer::nbEndingStatus)) {
+        status = 0;
+    }
+    return PcoConcurrencyAnalyzer::toString(static_cast<PcoConcurrencyAnalyzer::EndingStatus>(status));
+}
+
+///
+/// \brief Parses a prefix
+/// \param text The points, as "{id,number} {id,number}"
+/// \param threadIds The ids of the threads of the store
+/// \param prefix The points of the prefix
+/// \return false if the text is malformed or refers to an unknown thread
+///
+static bool parsePrefix(const std::string &text, const std::vector<std::string> &threadIds,
+                        std::vector<ScenarioFilePoint> &prefix)
+{
+    size_t position = 0;
+    while ((position = text.find('{', position)) != std::string::npos) {
+        size_t comma = text.find(',', position);
+        size_t end = text.find('}', position);
+        if ((comma == std::string::npos) || (end == std::string::npos) || (comma > end)) {
+            return false;
+        }
+        std::string id = text.substr(position + 1, comma - position - 1);
+        uint16_t thread = 0;
+        while ((thread < threadIds.size()) && (threadIds[thread] != id)) {
+            thread++;
+        }
+        if (thread == threadIds.size()) {
+            std::cout << "Unknown thread " << id << std::endl;
+            return false;
+        }
+        prefix.push_back(ScenarioFilePoint{thread, 0, std::atoi(text.c_str() + comma + 1)});
+        position = end + 1;
+    }
+    return true;
+}
+
+///
+/// \brief Indicates whether a scenario starts with a prefix
+/// \param row The scenario
+/// \param prefix The prefix
+/// \return true if it does
+///
+static bool hasPrefix(const ResultRow &row, const std::vector<ScenarioFilePoint> &prefix)
+{
+    if (row.nbPoints < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); i++) {
+        if ((row.points[i].thread != prefix[i].thread) || (row.points[i].number != prefix[i].number)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " file [--status status] [--failures] [--prefix points] [--key key]"
+                  << " [--limit nb] [--export file]" << std::endl;
+        return 1;
+    }
+    std::string fileName = argv[1];
+    int status = -1;
+    uint8_t flagsMask = 0;
+    std::string prefixText;
+    std::string key;
+    bool filterKey = false;
+    size_t limit = 20;
+    std::string exportFileName;
+    for (int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if ((option == "--status") && hasValue) {
+            std::string name = argv[++i];
+            for (int s = 0; s < PcoConcurrencyAnalyzer::nbEndingStatus; s++) {
+                if (name == statusName(s)) {
+                    status = s;
+                }
+            }
+            if (status < 0) {
+                std::cout << "Unknown status " << name << std::endl;
+                return 1;
+            }
+        }
+        else if (option == "--failures") {
+            flagsMask |= ResultFlag::InvariantFailure;
+        }
+        else if ((option == "--prefix") && hasValue) {
+            prefixText = argv[++i];
+        }
+        else if ((option == "--key") && hasValue) {
+            key = argv[++i];
+            filterKey = true;
+        }
+        else if ((option == "--limit") && hasValue) {
+            limit = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if ((option == "--export") && hasValue) {
+            exportFileName = argv[++i];
+        }
+        else {
+            std::cout << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    ResultStoreReader reader;
+    if (!reader.open(fileName)) {
+        std::cout << fileName << " is not a result store" << std::endl;
+        return 1;
+    }
+    std::vector<ScenarioFilePoint> prefix;
+    if (!parsePrefix(prefixText, reader.getThreadIds(), prefix)) {
+        std::cout << "Malformed prefix " << prefixText << std::endl;
+        return 1;
+    }
+
+    std::cout << fileName << " : " << reader.getNbScenarios() << " scenarios" << std::endl;
+    for (int s = 0; s < PcoConcurrencyAnalyzer::nbEndingStatus; s++) {
+        std::cout << "  " << statusName(s) << " : " << reader.select(s, 0).size() << std::endl;
+    }
+
+    ScenarioFileWriter writer;
+    if (!exportFileName.empty() && !writer.open(exportFileName, reader.getThreadIds())) {
+        std::cout << "Could not open " << exportFileName << std::endl;
+        return 1;
+    }
+    size_t nbMatching = 0;
+    for (auto r : reader.select(status, flagsMask)) {
+        ResultRow row = reader.getRow(r);
+        if (!hasPrefix(row, prefix) || (filterKey && (std::string(row.key, row.keyLength) != key))) {
+            continue;
+        }
+        nbMatching++;
+        if (!exportFileName.empty()) {
+            writer.writePoints(row.points, row.nbPoints);
+        }
+        if ((limit == 0) || (nbMatching <= limit)) {
+            std::cout << "#" << row.index << " " << statusName(row.status) << ", " << row.nbPlayed
+                      << "/" << row.nbPoints << " points played";
+            if (row.flags & ResultFlag::InvariantFailure) {
+                std::cout << ", invariant failure";
+            }
+            if (row.keyLength > 0) {
+                std::cout << ", key " << std::string(row.key, row.keyLength);
+            }
+            std::cout << " : ";
+            for (uint32_t i = 0; i < row.nbPoints; i++) {
+                std::cout << "{" << reader.getThreadIds()[row.points[i].thread] << "," << row.points[i].number << "} ";
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::cout << nbMatching << " matching scenarios" << std::endl;
+    if (!exportFileName.empty()) {
+        writer.finish();
+        std::cout << writer.getNbScenarios() << " scenarios exported to " << exportFileName << std::endl;
+    }
+    return 0;
+}